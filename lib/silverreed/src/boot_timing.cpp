@@ -0,0 +1,32 @@
+#include "boot_timing.h"
+
+#include <Arduino.h>
+
+namespace {
+unsigned long setup_us = 0;
+unsigned long ready_us = 0;
+}  // namespace
+
+void BootTiming::mark_setup_done() {
+  /**
+   * setup() is over: the serial port and the knitting process are
+   * initialised.
+   */
+  if (setup_us == 0) {
+    setup_us = micros();
+  }
+}
+
+void BootTiming::mark_ready() {
+  /**
+   * The knitting process accepts reqStart for the first time since reset.
+   * Later sessions do not change it.
+   */
+  if (ready_us == 0) {
+    ready_us = micros();
+  }
+}
+
+unsigned long BootTiming::get_setup_us() { return setup_us; }
+
+unsigned long BootTiming::get_ready_us() { return ready_us; }
@@ -0,0 +1,22 @@
+/**
+ * @file boot_timing.h
+ * @brief Time from reset to the firmware being ready to knit.
+ */
+#ifndef BOOT_TIMING_H_
+#define BOOT_TIMING_H_
+
+/**
+ * Boot milestones, in micros() since reset. micros() starts with the Arduino
+ * core, so the time spent in the bootloader before it is not included.
+ *
+ * 0 means the milestone was not reached yet.
+ */
+class BootTiming {
+ public:
+  static void mark_setup_done();
+  static void mark_ready();
+  static unsigned long get_setup_us();
+  static unsigned long get_ready_us();
+};
+
+#endif
@@ -10,40 +10,40 @@
 
 #include <Arduino.h>
 
+#include "boot_timing.h"
 #include "config.h"
 #include "debug.h"
 #include "version.h"
 
-Ayab_& Ayab = Ayab.getInstance();
-
-Ayab_& Ayab_::getInstance() {
-  /**
-   * Get the singleton instance of Ayab.
-   */
-  static Ayab_ instance;
-  return instance;
-}
+// Statically allocated: accessed directly, without the guard of a function
+// local static. Nothing is done before init() is called from setup().
+Ayab_ Ayab;
 
 void Ayab_::init() {
   /**
    * Initialize the communications for Ayab communication
    */
-  Serial.begin(SERIAL_BAUDRATE);
-  Serial.setTimeout(1);
-
-  m_packetSerial.begin(SERIAL_BAUDRATE);
-  m_packetSerial.setPacketHandler(Ayab.receive);
+  m_link.get_transport().begin(SERIAL_BAUDRATE);
 };
 
 void Ayab_::receive(const uint8_t* buffer, size_t size) {
+  /**
+   * Process a packet received now.
+   */
+  receive(buffer, size, micros());
+}
+
+void Ayab_::receive(const uint8_t* buffer, size_t size,
+                    unsigned long start_us) {
   /**
    * Receive a packet from the serial port and process it.
    *
-   * This function is called by the PacketSerial library when a full packet
-   * has been received.
+   * This function is called by the SLIP link when a full packet has been
+   * received.
    *
    * @param buffer The buffer containing the packet.
    * @param size The size of the packet.
+   * @param start_us When the first byte of the packet was read (micros()).
    */
   // Ignore empty packets (sliplib in Python emits END bytes at the start of
   // packets)
@@ -63,6 +63,10 @@ void Ayab_::receive(const uint8_t* buffer, size_t size) {
       Ayab.cnfLine(buffer, size);
       break;
 
+    case static_cast<uint8_t>(AYAB_API::cnfLineRef):
+      Ayab.cnfLineRef(buffer, size);
+      break;
+
     case static_cast<uint8_t>(AYAB_API::reqTest):
       Ayab.reqTest(buffer, size);
       break;
@@ -71,6 +75,51 @@ void Ayab_::receive(const uint8_t* buffer, size_t size) {
       Ayab.reqInit(buffer, size);
       break;
 
+    case static_cast<uint8_t>(AYAB_API::reqBaud):
+      Ayab.reqBaud(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqPing):
+      Ayab.reqPing(buffer, size, start_us);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqStats):
+      Ayab.reqStats(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqMotif):
+      Ayab.reqMotif(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqMotifData):
+      Ayab.reqMotifData(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqMotifSave):
+    case static_cast<uint8_t>(AYAB_API::reqMotifLoad):
+      Ayab.reqMotifSlot(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqTransform):
+      Ayab.reqTransform(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqDobTiming):
+      Ayab.reqDobTiming(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqSignalFilter):
+      Ayab.reqSignalFilter(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqResume):
+      Ayab.reqResume(buffer, size);
+      break;
+
+    case static_cast<uint8_t>(AYAB_API::reqReferenceNeedles):
+      Ayab.reqReferenceNeedles(buffer, size);
+      break;
+
     case static_cast<uint8_t>(AYAB_API::helpCmd):
       Ayab.helpCmd(buffer, size);
       break;
@@ -111,7 +160,7 @@ void Ayab_::send(const uint8_t* buffer, size_t size) {
    * @param buffer The buffer containing the packet.
    * @param size The size of the packet.
    */
-  m_packetSerial.send(buffer, size);
+  m_link.send(buffer, size);
 };
 
 void Ayab_::update() {
@@ -120,9 +169,45 @@ void Ayab_::update() {
    *
    * This function should be called to be able to get latest serial data.
    */
-  m_packetSerial.update();
+  poll_serial(UINT8_MAX);
+  check_baudrate_timeout();
 };
 
+void Ayab_::poll_serial(uint8_t max_bytes) {
+  /**
+   * Parse at most `max_bytes` received bytes, handling the messages they
+   * complete, so that a burst of input does not hold the loop for long.
+   */
+  m_link.update(max_bytes, micros());
+}
+
+bool Ayab_::has_serial_input() {
+  return m_link.get_transport().has_input();
+}
+
+void Ayab_::check_baudrate_timeout() {
+  /**
+   * The host did not confirm the negotiated baud rate, it is probably still
+   * talking at the previous one.
+   */
+  if (m_baudrate_pending &&
+      millis() - m_baudrate_switch_time >= BAUD_SWITCH_TIMEOUT_MS) {
+    DEBUG_PRINTLN("reqBaud: not confirmed, falling back");
+    m_baudrate_pending = false;
+    switch_baudrate(SERIAL_BAUDRATE);
+  }
+}
+
+void Ayab_::switch_baudrate(uint32_t baudrate) {
+  /**
+   * Reconfigure the serial port at a new baud rate.
+   * Pending outgoing bytes are sent at the current rate first.
+   */
+  m_link.get_transport().flush();
+  m_link.get_transport().begin(baudrate);
+  m_baudrate = baudrate;
+}
+
 void Ayab_::reqInfo(const uint8_t* buffer, size_t size) {
   // Max. length of suffix string: 16 bytes + \0
   // `payload` will be allocated on stack since length is compile-time constant
@@ -150,12 +235,6 @@ void Ayab_::reqStart(const uint8_t* buffer, size_t size) {
     return;
   }
 
-  uint8_t start_needle = buffer[1];
-  uint8_t stop_needle = buffer[2];
-  auto continuous_reporting_enabled =
-      static_cast<bool>(buffer[3] & CONTINUOUS_REPORTING_FLAG);
-  auto beeper_enabled = static_cast<bool>(buffer[3] & BEEPER_ENABLED_FLAG);
-
   uint8_t crc8 = buffer[4];
   // Check crc on bytes 0-4 of buffer.
   if (crc8 != CRC8(buffer, 4)) {
@@ -165,11 +244,81 @@ void Ayab_::reqStart(const uint8_t* buffer, size_t size) {
 
   // GlobalBeeper::init(beeperEnabled);
   // memset(_b, 0xFF, MAX_LINE_BUFFER_LEN);
-  bool ok = KnittingProcess.start_knitting(
-      start_needle, stop_needle, continuous_reporting_enabled, beeper_enabled);
+  bool ok = start_knitting(buffer[1], buffer[2], buffer[3]);
   send_cnfStart(ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_STATE);
 }
 
+bool Ayab_::start_knitting(uint8_t start_needle, uint8_t end_needle,
+                           uint8_t flags) {
+  /**
+   * Start a knitting session with the needle range and flags of reqStart.
+   */
+  auto continuous_reporting_enabled =
+      static_cast<bool>(flags & CONTINUOUS_REPORTING_FLAG);
+  auto beeper_enabled = static_cast<bool>(flags & BEEPER_ENABLED_FLAG);
+  auto batched_lines = static_cast<bool>(flags & BATCHED_LINES_FLAG);
+  auto standalone = static_cast<bool>(flags & STANDALONE_FLAG);
+  uint8_t colour_passes =
+      ((flags & COLOUR_PASSES_MASK) >> COLOUR_PASSES_SHIFT) + 1;
+  RowCheckReport row_check_report = ROW_CHECK_OFF;
+  if (flags & ROW_CHECK_BITMAP_FLAG) {
+    row_check_report = ROW_CHECK_BITMAP;
+  } else if (flags & ROW_CHECK_FLAG) {
+    row_check_report = ROW_CHECK_COUNT;
+  }
+
+  bool ok = KnittingProcess.start_knitting(start_needle, end_needle,
+                                           continuous_reporting_enabled,
+                                           beeper_enabled, batched_lines,
+                                           standalone, colour_passes,
+                                           row_check_report);
+  if (ok) {
+    m_line_retransmits = 0;
+    m_row_dictionary.clear();
+  }
+  return ok;
+}
+
+void Ayab_::reqResume(const uint8_t* buffer, size_t size) {
+  /**
+   * Report the session kept in the checkpoint and, in RESUME_SESSION mode,
+   * start it again from the first line not completely knitted. Like
+   * reqStart, resuming needs reqInit first (and the transforms of the
+   * session, if any).
+   *
+   * reqResume layout: mode, CRC8.
+   * cnfResume layout: error, start needle, end needle, reqStart flags, line.
+   */
+  uint8_t payload[6] = {static_cast<uint8_t>(AYAB_API::cnfResume)};
+  if (size < 3U) {
+    send_error(AYAB_API::cnfResume, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[2] != CRC8(buffer, 2)) {
+    send_error(AYAB_API::cnfResume, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+
+  CheckpointRecord record;
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  if (!KnittingProcess.load_checkpoint(record)) {
+    error_code = ErrorCode::NO_CHECKPOINT;
+  } else if (buffer[1] == RESUME_SESSION &&
+             !(start_knitting(record.start_needle, record.end_needle,
+                              record.flags) &&
+               KnittingProcess.resume_from_line(record.line))) {
+    error_code = ErrorCode::INVALID_STATE;
+  }
+  if (error_code != ErrorCode::NO_CHECKPOINT) {
+    payload[2] = record.start_needle;
+    payload[3] = record.end_needle;
+    payload[4] = record.flags;
+    payload[5] = record.line;
+  }
+  payload[1] = static_cast<uint8_t>(error_code);
+  send(payload, sizeof(payload));
+}
+
 void Ayab_::send_cnfStart(ErrorCode error_code) {
   uint8_t payload[2];
   payload[0] = static_cast<uint8_t>(AYAB_API::cnfStart);
@@ -183,38 +332,95 @@ void Ayab_::cnfLine(const uint8_t* buffer, size_t size) {
   // Validate message size
   if (size < len_line_buffer + 5U) {
     DEBUG_PRINTLN("cnfLine: message too short");
+    sendReqLineError(ErrorCode::EXPECTED_LONGER_MESSAGE);
     return;
   }
 
   uint8_t line_number = buffer[1];
-  /* uint8_t color = buffer[2];  */  // currently unused
+  uint8_t colour = buffer[2];  // Pass index of the row in multi-colour mode
   uint8_t flags = buffer[3];
   bool flag_last_line = static_cast<bool>(flags & LAST_LINE_FLAG);
 
+  uint8_t crc8 = buffer[len_line_buffer + 4];
+  // Calculate checksum of buffer contents before touching line_buffer, which
+  // may be the row currently knitted.
+  if (crc8 != CRC8(buffer, len_line_buffer + 4)) {
+    DEBUG_PRINTLN("cnfLine: CRC error");
+    sendReqLineError(ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+
+  if (KnittingProcess.is_standalone()) {
+    DEBUG_PRINTLN("cnfLine: ignored in standalone mode");
+    return;
+  }
+
   // Static buffer to persist beyond function scope
   // Pattern class stores pointer to this buffer
   static uint8_t line_buffer[MAX_LINE_BUFFER_LEN];
 
-  // Clear and fill the buffer
-  for (uint8_t i = 0U; i < MAX_LINE_BUFFER_LEN; i++) {
-    line_buffer[i] = 0;
-  }
-
   for (uint8_t i = 0U; i < len_line_buffer; i++) {
     // Values have to be inverted because of needle states
     line_buffer[i] = ~buffer[i + 4];
   }
 
-  uint8_t crc8 = buffer[len_line_buffer + 4];
-  // Calculate checksum of buffer contents
-  if (crc8 != CRC8(buffer, len_line_buffer + 4)) {
-    DEBUG_PRINTLN("cnfLine: CRC error");
-    // Note: In the future, could send a repeat request with error code
+  // A dropped line must not change the dictionary either: the host resends
+  // from the expected line with the same dictionary contents.
+  if (deliver_line(line_number, colour, flag_last_line, line_buffer) &&
+      (flags & STORE_ROW_FLAG)) {
+    m_row_dictionary.store(flags >> STORE_ROW_SLOT_SHIFT, line_buffer);
+  }
+}
+
+void Ayab_::cnfLineRef(const uint8_t* buffer, size_t size) {
+  /**
+   * Knit a row of the dictionary, stored by a previous cnfLine.
+   *
+   * cnfLineRef layout: line number, slot (bits 0-3), colour (bits 4-6) and
+   * last line flag (bit 7), CRC8. An empty slot is negative acknowledged like
+   * a corrupted cnfLine, the host then sends the full row.
+   */
+  if (size < 4U) {
+    sendReqLineError(ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[3] != CRC8(buffer, 3)) {
+    sendReqLineError(ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.is_standalone()) {
     return;
   }
 
-  KnittingProcess.set_next_line(line_number, flag_last_line, line_buffer);
-  return;
+  const uint8_t* row = m_row_dictionary.get(buffer[2] & LINE_REF_SLOT_MASK);
+  if (row == nullptr) {
+    DEBUG_PRINTLN("cnfLineRef: empty dictionary slot");
+    sendReqLineError(ErrorCode::INVALID_ROW_REFERENCE);
+    return;
+  }
+  deliver_line(buffer[1],
+               (buffer[2] & LINE_REF_COLOUR_MASK) >> LINE_REF_COLOUR_SHIFT,
+               static_cast<bool>(buffer[2] & LINE_REF_LAST_LINE_FLAG), row);
+}
+
+bool Ayab_::deliver_line(uint8_t line_number, uint8_t colour, bool last_line,
+                         const uint8_t* line) {
+  /**
+   * Hand a received row over to the knitting process.
+   *
+   * @return false if the row was dropped (batched or multi-colour mode only).
+   */
+  if (KnittingProcess.uses_line_queue()) {
+    // The line is copied into the line queue, the buffer can be reused
+    if (!KnittingProcess.queue_line(line_number, last_line, line, colour)) {
+      DEBUG_PRINTLN("cnfLine: line dropped");
+      return false;
+    }
+    return true;
+  }
+
+  KnittingProcess.set_next_line(line_number, last_line, line);
+  return true;
 }
 
 void Ayab_::sendReqLine(uint8_t line) {
@@ -224,6 +430,71 @@ void Ayab_::sendReqLine(uint8_t line) {
   send(payload, 2);
 }
 
+void Ayab_::sendReqLineError(ErrorCode error_code) {
+  /**
+   * Negative acknowledge of a cnfLine: ask again for the expected line right
+   * away, with the reason appended, instead of letting the host time out.
+   * Hosts reading only the line number simply resend the line. The expected
+   * colour pass follows, for multi-colour knitting.
+   */
+  if (KnittingProcess.get_knitting_state() != Knitting) {
+    return;
+  }
+  if (m_line_retransmits < 0xFFFFU) {
+    m_line_retransmits++;
+  }
+
+  uint8_t payload[4];
+  payload[0] = static_cast<uint8_t>(AYAB_API::reqLine);
+  payload[1] = KnittingProcess.get_expected_line();
+  payload[2] = static_cast<uint8_t>(error_code);
+  payload[3] = KnittingProcess.get_expected_colour();
+  send(payload, 4);
+}
+
+void Ayab_::sendIndLineCredits(uint8_t next_line, uint8_t credits) {
+  /**
+   * Advertise the free row slots of the line queue (batched line transfer).
+   * The host may push `credits` rows, starting at `next_line`, without
+   * waiting for a reqLine.
+   */
+  uint8_t payload[3];
+  payload[0] = static_cast<uint8_t>(AYAB_API::indLineCredits);
+  payload[1] = next_line;
+  payload[2] = credits;
+  send(payload, 3);
+}
+
+void Ayab_::sendIndOverspeed(uint16_t speed) {
+  /**
+   * Warn that the carriage is close to the maximum safe speed.
+   * Both speeds are in needles per second.
+   */
+  uint8_t payload[5];
+  payload[0] = static_cast<uint8_t>(AYAB_API::indOverspeed);
+  uint8_t* cursor = write_uint16(payload + 1, speed);
+  write_uint16(cursor, MAX_SAFE_NEEDLES_PER_SECOND);
+  send(payload, 5);
+}
+
+void Ayab_::sendIndRowCheck(uint8_t line, uint16_t mismatches,
+                            const uint8_t* observed) {
+  /**
+   * Report the needles whose DOB level differed from the row, and the DOB
+   * levels held (row buffer layout) when `observed` is given.
+   */
+  uint8_t payload[4 + MAX_LINE_BUFFER_LEN];
+  payload[0] = static_cast<uint8_t>(AYAB_API::indRowCheck);
+  payload[1] = line;
+  write_uint16(payload + 2, mismatches);
+  if (observed == nullptr) {
+    send(payload, 4);
+    return;
+  }
+  memcpy(payload + 4, observed, MAX_LINE_BUFFER_LEN);
+  send(payload, sizeof(payload));
+}
+
 void Ayab_::reqTest(const uint8_t* buffer, size_t size) {
   // TODO
   return;
@@ -238,8 +509,358 @@ void Ayab_::reqInit(const uint8_t* buffer, size_t size) {
     payload[1] = 1;
   }
   send(payload, 2);
-  delay(INIT_DELAY_MS);
 }
+void Ayab_::reqBaud(const uint8_t* buffer, size_t size) {
+  /**
+   * Negotiate a higher baud rate for the link.
+   *
+   * 1. The host sends reqBaud(index) at the current rate.
+   * 2. The firmware answers cnfBaud at the current rate and switches.
+   * 3. The host switches and sends the same reqBaud at the new rate, which
+   *    is answered at the new rate and confirms the switch.
+   *
+   * Without confirmation within BAUD_SWITCH_TIMEOUT_MS, the firmware falls
+   * back to SERIAL_BAUDRATE (see update()).
+   */
+  if (size < 3U) {
+    send_cnfBaud(ErrorCode::EXPECTED_LONGER_MESSAGE, 0);
+    return;
+  }
+
+  uint8_t baudrate_index = buffer[1];
+  if (buffer[2] != CRC8(buffer, 2)) {
+    send_cnfBaud(ErrorCode::CHECKSUM_ERROR, baudrate_index);
+    return;
+  }
+
+  if (baudrate_index >= SUPPORTED_BAUDRATES_COUNT) {
+    send_cnfBaud(ErrorCode::UNSUPPORTED_BAUDRATE, baudrate_index);
+    return;
+  }
+
+  uint32_t baudrate = SUPPORTED_BAUDRATES[baudrate_index];
+  send_cnfBaud(ErrorCode::SUCCESS, baudrate_index);
+  if (baudrate == m_baudrate) {
+    // Already at this rate: confirmation of a switch, or nothing to do
+    m_baudrate_pending = false;
+    return;
+  }
+
+  switch_baudrate(baudrate);
+  m_baudrate_pending = true;
+  m_baudrate_switch_time = millis();
+}
+
+void Ayab_::send_cnfBaud(ErrorCode error_code, uint8_t baudrate_index) {
+  uint8_t payload[3];
+  payload[0] = static_cast<uint8_t>(AYAB_API::cnfBaud);
+  payload[1] = static_cast<uint8_t>(error_code);
+  payload[2] = baudrate_index;
+  send(payload, 3);
+}
+
+void Ayab_::reqPing(const uint8_t* buffer, size_t size,
+                    unsigned long start_us) {
+  /**
+   * Echo a latency probe with the device timestamps (micros()).
+   *
+   * The receive timestamp is when the first byte of the packet was read, the
+   * send timestamp right before the answer is encoded, so the host can split
+   * the round trip into link time and device time (bytes waiting while the
+   * loop was busy, then processing).
+   */
+  uint8_t sequence = size > 1U ? buffer[1] : 0;
+
+  uint8_t payload[10];
+  payload[0] = static_cast<uint8_t>(AYAB_API::cnfPing);
+  payload[1] = sequence;
+  write_uint32(payload + 2, start_us);
+  write_uint32(payload + 6, micros());
+  send(payload, 10);
+}
+
+void Ayab_::reqStats(const uint8_t* buffer, size_t size) {
+  /**
+   * Report the device statistics of the current (or last) knitting session.
+   *
+   * cnfStats layout (multi-byte values are big endian):
+   *   0      cnfStats
+   *   1-2    number of row turnarounds measured
+   *   3-6    minimum turnaround (us)
+   *   7-10   average turnaround (us)
+   *   11-14  maximum turnaround (us)
+   *   15-16  rows knitted with stale data
+   *   17-32  turnaround histogram (TURNAROUND_HISTOGRAM_BINS x uint16)
+   *   33-34  cnfLine retransmissions requested
+   *   35-40  glitches filtered out on CCP, KSL and HOK (uint16 each)
+   *   41-42  carriage events lost (event queue full)
+   *   43-46  longest carriage edge latency (us)
+   *   47-48  carriage turns inside the pattern section
+   *   49-50  carriage position corrections on the ND1 reference needles
+   *   51-52  rows whose needles selected differ from the row
+   *   53-56  time from reset to the end of setup() (us)
+   *   57-60  time from reset to the first reqInit handled (us)
+   */
+  const TurnaroundStats& stats = KnittingProcess.get_turnaround_stats();
+  uint8_t
+      payload[39 + 2 * TURNAROUND_HISTOGRAM_BINS + 2 * SAMPLED_SIGNAL_COUNT];
+  payload[0] = static_cast<uint8_t>(AYAB_API::cnfStats);
+  uint8_t* cursor = write_uint16(payload + 1, stats.get_count());
+  cursor = write_uint32(cursor, stats.get_min_us());
+  cursor = write_uint32(cursor, stats.get_average_us());
+  cursor = write_uint32(cursor, stats.get_max_us());
+  cursor = write_uint16(cursor, stats.get_stale_rows());
+  for (uint8_t i = 0; i < TURNAROUND_HISTOGRAM_BINS; i++) {
+    cursor = write_uint16(cursor, stats.get_histogram(i));
+  }
+  cursor = write_uint16(cursor, m_line_retransmits);
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    cursor = write_uint16(cursor, CarriageSampler::get_rejected_glitches(
+                                      static_cast<SampledSignal>(signal)));
+  }
+  cursor = write_uint16(cursor, KnittingProcess.get_lost_carriage_events());
+  cursor = write_uint32(cursor, KnittingProcess.get_max_edge_latency_us());
+  cursor = write_uint16(cursor, KnittingProcess.get_reversals());
+  cursor = write_uint16(cursor, KnittingProcess.get_position_corrections());
+  cursor = write_uint16(cursor,
+                        KnittingProcess.get_row_check().get_rows_with_errors());
+  cursor = write_uint32(cursor, BootTiming::get_setup_us());
+  write_uint32(cursor, BootTiming::get_ready_us());
+  send(payload, sizeof(payload));
+}
+
+void Ayab_::reqMotif(const uint8_t* buffer, size_t size) {
+  /**
+   * Configure the motif knitted in standalone mode.
+   *
+   * reqMotif layout: width, height, x offset, y offset, flags, rows (uint16,
+   * 0 to knit until stopped), CRC8. The tile is then uploaded with
+   * reqMotifData.
+   */
+  if (size < 9U) {
+    send_error(AYAB_API::cnfMotif, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[8] != CRC8(buffer, 8)) {
+    send_error(AYAB_API::cnfMotif, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.is_standalone()) {
+    // The motif is being knitted
+    send_error(AYAB_API::cnfMotif, ErrorCode::INVALID_STATE);
+    return;
+  }
+
+  uint16_t rows = (static_cast<uint16_t>(buffer[6]) << 8) | buffer[7];
+  bool ok = KnittingProcess.get_motif().configure(
+      buffer[1], buffer[2], buffer[3], buffer[4], buffer[5], rows);
+  send_error(AYAB_API::cnfMotif,
+             ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_MOTIF);
+}
+
+void Ayab_::reqMotifData(const uint8_t* buffer, size_t size) {
+  /**
+   * Upload a chunk of the motif tile.
+   *
+   * reqMotifData layout: offset, length, `length` bytes of tile, CRC8.
+   */
+  if (size < 4U || size < 4U + buffer[2]) {
+    send_error(AYAB_API::cnfMotifData, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  uint8_t length = buffer[2];
+  if (buffer[3 + length] != CRC8(buffer, 3 + length)) {
+    send_error(AYAB_API::cnfMotifData, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.is_standalone()) {
+    send_error(AYAB_API::cnfMotifData, ErrorCode::INVALID_STATE);
+    return;
+  }
+
+  bool ok = KnittingProcess.get_motif().load(buffer[1], buffer + 3, length);
+  send_error(AYAB_API::cnfMotifData,
+             ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_MOTIF);
+}
+
+void Ayab_::reqMotifSlot(const uint8_t* buffer, size_t size) {
+  /**
+   * Save the uploaded motif to a persistent slot (reqMotifSave) or load a
+   * saved motif (reqMotifLoad), which can then be knitted with a standalone
+   * reqStart.
+   *
+   * Layout: slot, CRC8. The answer carries the error code and the slot.
+   */
+  bool is_save = buffer[0] == static_cast<uint8_t>(AYAB_API::reqMotifSave);
+  uint8_t payload[3];
+  payload[0] = static_cast<uint8_t>(is_save ? AYAB_API::cnfMotifSave
+                                            : AYAB_API::cnfMotifLoad);
+  payload[2] = size > 1U ? buffer[1] : 0;
+
+  ErrorCode error_code = ErrorCode::SUCCESS;
+  if (size < 3U) {
+    error_code = ErrorCode::EXPECTED_LONGER_MESSAGE;
+  } else if (buffer[2] != CRC8(buffer, 2)) {
+    error_code = ErrorCode::CHECKSUM_ERROR;
+  } else if (is_save) {
+    if (!KnittingProcess.save_motif(buffer[1])) {
+      error_code = ErrorCode::INVALID_MOTIF;
+    }
+  } else if (!KnittingProcess.load_motif(buffer[1])) {
+    error_code = ErrorCode::EMPTY_MOTIF_SLOT;
+  }
+
+  payload[1] = static_cast<uint8_t>(error_code);
+  send(payload, 3);
+}
+
+void Ayab_::reqTransform(const uint8_t* buffer, size_t size) {
+  /**
+   * Configure the transform applied to the rows of the knitting session.
+   * Must be sent after reqInit (which clears it) and before reqStart.
+   *
+   * reqTransform layout: flags, row repeat, circular shift, CRC8.
+   */
+  if (size < 5U) {
+    send_error(AYAB_API::cnfTransform, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[4] != CRC8(buffer, 4)) {
+    send_error(AYAB_API::cnfTransform, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.get_knitting_state() == Knitting) {
+    send_error(AYAB_API::cnfTransform, ErrorCode::INVALID_STATE);
+    return;
+  }
+
+  bool ok = KnittingProcess.get_row_transform().configure(buffer[1], buffer[2],
+                                                          buffer[3]);
+  send_error(AYAB_API::cnfTransform,
+             ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_TRANSFORM);
+}
+
+void Ayab_::reqDobTiming(const uint8_t* buffer, size_t size) {
+  /**
+   * Choose between writing DOB when the CCP edge is seen (mode 0) and
+   * scheduling it with a hardware timer (mode 1), ahead of the expected edge
+   * by a calibrated fraction of the CCP period.
+   *
+   * reqDobTiming layout: mode, phase advance (1/256 of a period), CRC8.
+   */
+  if (size < 4U) {
+    send_error(AYAB_API::cnfDobTiming, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[3] != CRC8(buffer, 3)) {
+    send_error(AYAB_API::cnfDobTiming, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+
+  bool ok = buffer[1] <= 1U && KnittingProcess.configure_dob_timing(
+                                   buffer[1] == 1U, buffer[2]);
+  send_error(AYAB_API::cnfDobTiming,
+             ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_STATE);
+}
+
+void Ayab_::reqSignalFilter(const uint8_t* buffer, size_t size) {
+  /**
+   * Configure the glitch filters of the carriage signals.
+   *
+   * reqSignalFilter layout: CCP filter, KSL filter, HOK filter, CRC8. Each
+   * filter byte holds the depth in samples (bits 0-3, 0 for no filtering) and
+   * the majority vote flag (bit 7).
+   */
+  if (size < 5U) {
+    send_error(AYAB_API::cnfSignalFilter, ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[4] != CRC8(buffer, 4)) {
+    send_error(AYAB_API::cnfSignalFilter, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.get_knitting_state() == Knitting) {
+    send_error(AYAB_API::cnfSignalFilter, ErrorCode::INVALID_STATE);
+    return;
+  }
+
+  uint8_t modes[SAMPLED_SIGNAL_COUNT];
+  uint8_t depths[SAMPLED_SIGNAL_COUNT];
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    uint8_t filter = buffer[1 + signal];
+    modes[signal] = (filter & SIGNAL_FILTER_MAJORITY_FLAG) ? FILTER_MAJORITY
+                                                           : FILTER_INTEGRATOR;
+    depths[signal] = filter & SIGNAL_FILTER_DEPTH_MASK;
+    if (!SignalFilter::is_valid(modes[signal], depths[signal])) {
+      // Nothing is changed unless every filter is valid
+      send_error(AYAB_API::cnfSignalFilter, ErrorCode::INVALID_FILTER);
+      return;
+    }
+  }
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    KnittingProcess.configure_signal_filter(static_cast<SampledSignal>(signal),
+                                            modes[signal], depths[signal]);
+  }
+  send_error(AYAB_API::cnfSignalFilter, ErrorCode::SUCCESS);
+}
+
+void Ayab_::reqReferenceNeedles(const uint8_t* buffer, size_t size) {
+  /**
+   * Set the needles ND1 rises on, measured on the machine, so that the needle
+   * count is corrected on them (see ND1_REFERENCE_PERIOD).
+   *
+   * reqReferenceNeedles layout: period (0 to ignore ND1), offset, CRC8.
+   */
+  if (size < 4U) {
+    send_error(AYAB_API::cnfReferenceNeedles,
+               ErrorCode::EXPECTED_LONGER_MESSAGE);
+    return;
+  }
+  if (buffer[3] != CRC8(buffer, 3)) {
+    send_error(AYAB_API::cnfReferenceNeedles, ErrorCode::CHECKSUM_ERROR);
+    return;
+  }
+  if (KnittingProcess.get_knitting_state() == Knitting) {
+    send_error(AYAB_API::cnfReferenceNeedles, ErrorCode::INVALID_STATE);
+    return;
+  }
+
+  bool ok = KnittingProcess.configure_reference_needles(buffer[1], buffer[2]);
+  send_error(AYAB_API::cnfReferenceNeedles,
+             ok ? ErrorCode::SUCCESS : ErrorCode::INVALID_REFERENCE);
+}
+
+void Ayab_::send_error(AYAB_API message, ErrorCode error_code) {
+  /**
+   * Send a confirmation message carrying only an error code.
+   */
+  uint8_t payload[2];
+  payload[0] = static_cast<uint8_t>(message);
+  payload[1] = static_cast<uint8_t>(error_code);
+  send(payload, 2);
+}
+
+uint8_t* Ayab_::write_uint16(uint8_t* payload, uint16_t value) {
+  /**
+   * Write a big endian uint16 in a payload.
+   *
+   * @return The position right after the written value.
+   */
+  payload[0] = highByte(value);
+  payload[1] = lowByte(value);
+  return payload + 2;
+}
+
+uint8_t* Ayab_::write_uint32(uint8_t* payload, uint32_t value) {
+  /**
+   * Write a big endian uint32 in a payload.
+   *
+   * @return The position right after the written value.
+   */
+  write_uint16(payload, static_cast<uint16_t>(value >> 16));
+  return write_uint16(payload + 2, static_cast<uint16_t>(value));
+}
+
 void Ayab_::reqQuit(const uint8_t* buffer, size_t size) {
   // TODO
   return;
@@ -283,8 +904,16 @@ void Ayab_::sendIndState(CarriageDirection direction) {
   // `payload` will be allocated on stack since length is compile-time constant
 
   uint8_t carriage_direction = direction == TO_LEFT ? 0x00 : 0x01;
+  uint16_t speed =
+      KnittingProcess.get_speed_estimator().get_needles_per_second();
+  // Needle number of the carriage, 0 until it is known
+  int position = KnittingProcess.get_carriage_position();
+  uint8_t carriage_position = 0;
+  if (position != CARRIAGE_POSITION_UNKNOWN) {
+    carriage_position = static_cast<uint8_t>(position);
+  }
 
-  uint8_t payload[10] = {
+  uint8_t payload[12] = {
       static_cast<uint8_t>(AYAB_API::indState),
       static_cast<uint8_t>(0x00),  // O for ready, other valure otherwise
       static_cast<uint8_t>(
@@ -294,28 +923,14 @@ void Ayab_::sendIndState(CarriageDirection direction) {
       highByte(right_hall_value),
       lowByte(right_hall_value),
       static_cast<uint8_t>(0x00),  // Only Knit carriage supported for now
-      0x00,                        // carriage position (needle number) TODO
+      carriage_position,           // carriage position (needle number)
       carriage_direction,          // 1 left, 2 right
+      highByte(speed),             // Carriage speed (needles per second)
+      lowByte(speed),
   };
-  send(static_cast<uint8_t*>(payload), 10);
+  send(static_cast<uint8_t*>(payload), 12);
 }
 
 uint8_t Ayab_::CRC8(const uint8_t* buffer, size_t len) const {
-  uint8_t crc = 0x00U;
-
-  while (len--) {
-    uint8_t extract = *buffer;
-    buffer++;
-
-    for (uint8_t tempi = BITS_PER_BYTE; tempi; tempi--) {
-      uint8_t sum = (crc ^ extract) & 0x01U;
-      crc >>= 1U;
-
-      if (sum) {
-        crc ^= CRC8_POLYNOMIAL;
-      }
-      extract >>= 1U;
-    }
-  }
-  return crc;
+  return crc8(buffer, len);
 }
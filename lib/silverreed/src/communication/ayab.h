@@ -1,28 +1,62 @@
 #ifndef AYAB_H_
 #define AYAB_H_
 
-#include <PacketSerial.h>
 #include <stdint.h>
 
-#include "com.h"
+#include "config.h"
+#include "crc.h"
+#include "knitting.h"
 #include "machine/carriage.h"
+#include "row_dictionary.h"
+#include "slip_link.h"
+#include "transport.h"
 
 using namespace std;
 
-constexpr uint8_t API_VERSION = 6U;
+constexpr uint8_t API_VERSION = 7U;  // 7: carriage speed in indState
 
 constexpr uint32_t SERIAL_BAUDRATE = 115200U;
 
-constexpr uint8_t MAX_LINE_BUFFER_LEN = 25U;
-constexpr uint8_t MAX_MSG_BUFFER_LEN = 64U;
+// Baud rates the host can negotiate with reqBaud, indexed by the request.
+// At 16 MHz with U2X on the ATmega328P (UBRR0 = 16, 7, 3, 1), 115200 runs at
+// 117647 baud (+2.1%); 250000, 500000 and 1000000 are exact.
+// The Uno R4 uses the same table, its faster rates are not offered.
+constexpr uint32_t SUPPORTED_BAUDRATES[] = {SERIAL_BAUDRATE, 250000U, 500000U,
+                                            1000000U};
+constexpr uint8_t SUPPORTED_BAUDRATES_COUNT =
+    sizeof(SUPPORTED_BAUDRATES) / sizeof(SUPPORTED_BAUDRATES[0]);
+constexpr unsigned long BAUD_SWITCH_TIMEOUT_MS =
+    500;  // Fall back to SERIAL_BAUDRATE if the host does not confirm
 
 // Protocol constants
 constexpr uint8_t CONTINUOUS_REPORTING_FLAG = 0x01;  // Bit 0 in flags byte
 constexpr uint8_t BEEPER_ENABLED_FLAG = 0x02;        // Bit 1 in flags byte
-constexpr uint8_t LAST_LINE_FLAG = 0x01;             // Bit 0 in flags byte
-constexpr uint8_t CRC8_POLYNOMIAL = 0x8C;  // CRC-8 polynomial for checksums
-constexpr unsigned long INIT_DELAY_MS =
-    500;  // Delay after initialization response
+constexpr uint8_t BATCHED_LINES_FLAG = 0x04;         // Bit 2 in flags byte
+constexpr uint8_t STANDALONE_FLAG = 0x08;            // Bit 3 in flags byte
+constexpr uint8_t COLOUR_PASSES_MASK = 0x30;         // Bits 4-5: passes - 1
+constexpr uint8_t COLOUR_PASSES_SHIFT = 4U;
+constexpr uint8_t ROW_CHECK_FLAG = 0x40;         // Bit 6 in flags byte
+constexpr uint8_t ROW_CHECK_BITMAP_FLAG = 0x80;  // Bit 7 in flags byte
+constexpr uint8_t LAST_LINE_FLAG = 0x01;  // Bit 0 in flags byte
+
+// Row dictionary: cnfLine flags bit 1 stores the row in the slot given by bits
+// 4-7, cnfLineRef carries the slot in bits 0-3, the colour in bits 4-6 and the
+// last line flag in bit 7
+constexpr uint8_t STORE_ROW_FLAG = 0x02;
+constexpr uint8_t STORE_ROW_SLOT_SHIFT = 4U;
+constexpr uint8_t LINE_REF_SLOT_MASK = 0x0F;
+constexpr uint8_t LINE_REF_COLOUR_MASK = 0x70;
+constexpr uint8_t LINE_REF_COLOUR_SHIFT = 4U;
+constexpr uint8_t LINE_REF_LAST_LINE_FLAG = 0x80;
+
+// reqSignalFilter: one byte per signal, the depth in bits 0-3 and the majority
+// vote flag in bit 7 (integrator otherwise)
+constexpr uint8_t SIGNAL_FILTER_DEPTH_MASK = 0x0F;
+constexpr uint8_t SIGNAL_FILTER_MAJORITY_FLAG = 0x80;
+
+// reqResume modes
+constexpr uint8_t RESUME_QUERY = 0x00;    // Only report the checkpoint
+constexpr uint8_t RESUME_SESSION = 0x01;  // Start the session again from it
 
 // Error codes for AYAB protocol
 enum class ErrorCode : uint8_t {
@@ -30,7 +64,15 @@ enum class ErrorCode : uint8_t {
   CHECKSUM_ERROR = 0x01,
   EXPECTED_LONGER_MESSAGE = 0x02,
   INVALID_STATE = 0x03,
-  INVALID_NEEDLE_RANGE = 0x04
+  INVALID_NEEDLE_RANGE = 0x04,
+  UNSUPPORTED_BAUDRATE = 0x05,
+  INVALID_MOTIF = 0x06,
+  EMPTY_MOTIF_SLOT = 0x07,
+  INVALID_TRANSFORM = 0x08,
+  INVALID_ROW_REFERENCE = 0x09,
+  INVALID_FILTER = 0x0A,
+  NO_CHECKPOINT = 0x0B,
+  INVALID_REFERENCE = 0x0C
 };
 
 enum class AYAB_API : unsigned char {
@@ -43,6 +85,9 @@ enum class AYAB_API : unsigned char {
   reqTest = 0x04,
   cnfTest = 0xC4,
   indState = 0x84,
+  indLineCredits = 0x86,
+  indOverspeed = 0x87,
+  indRowCheck = 0x88,
   helpCmd = 0x25,
   sendCmd = 0x26,
   beepCmd = 0x27,
@@ -56,6 +101,31 @@ enum class AYAB_API : unsigned char {
   quitCmd = 0x2F,
   reqInit = 0x05,
   cnfInit = 0xC5,
+  reqBaud = 0x07,
+  cnfBaud = 0xC7,
+  reqPing = 0x08,
+  cnfPing = 0xC8,
+  reqStats = 0x09,
+  cnfStats = 0xC9,
+  reqMotif = 0x0A,
+  cnfMotif = 0xCA,
+  reqMotifData = 0x0B,
+  cnfMotifData = 0xCB,
+  reqMotifSave = 0x0C,
+  cnfMotifSave = 0xCC,
+  reqMotifLoad = 0x0D,
+  cnfMotifLoad = 0xCD,
+  reqTransform = 0x0E,
+  cnfTransform = 0xCE,
+  reqDobTiming = 0x0F,
+  cnfDobTiming = 0xCF,
+  reqSignalFilter = 0x10,
+  cnfSignalFilter = 0xD0,
+  reqResume = 0x11,
+  cnfResume = 0xD1,
+  cnfLineRef = 0xD2,
+  reqReferenceNeedles = 0x13,
+  cnfReferenceNeedles = 0xD3,
   testRes = 0xEE,
   debug = 0x9F
 };
@@ -63,33 +133,75 @@ using AYAB_API_t = enum AYAB_API;
 
 #pragma once
 
-class Ayab_ : public Communicator {
+class Ayab_ {
  public:
-  static Ayab_& getInstance();
-
+  // The only instance is Ayab, set up by init(). Constant-initialised: no
+  // constructor code runs before main().
+  constexpr Ayab_() = default;
   Ayab_(const Ayab_&) = delete;
   Ayab_& operator=(const Ayab_&) = delete;
 
   void init();
   static void receive(const uint8_t* buffer, size_t size);
+  static void receive(const uint8_t* buffer, size_t size,
+                      unsigned long start_us);
   void send(const uint8_t* buffer, size_t size);
   void update();
+  void poll_serial(uint8_t max_bytes);
+  void check_baudrate_timeout();
+  bool has_serial_input();
 
   void sendIndState(CarriageDirection direction);
   void sendReqLine(uint8_t line);
+  void sendReqLineError(ErrorCode error_code);
+  void sendIndLineCredits(uint8_t next_line, uint8_t credits);
+  void sendIndOverspeed(uint16_t speed);
+  void sendIndRowCheck(uint8_t line, uint16_t mismatches,
+                       const uint8_t* observed);
   uint8_t CRC8(const uint8_t* buffer, size_t len) const;
+  uint32_t get_baudrate() const { return m_baudrate; }
+  bool is_baudrate_pending() const { return m_baudrate_pending; }
+  uint16_t get_line_retransmits() const { return m_line_retransmits; }
+  AyabTransport& get_transport() { return m_link.get_transport(); }
 
  private:
-  Ayab_() = default;
+  // SLIP packets on the transport selected at build time (transport.h)
+  SlipLink<AyabTransport, MAX_MSG_BUFFER_LEN, Ayab_::receive> m_link;
+
+  // Baud rate negotiation
+  uint32_t m_baudrate = SERIAL_BAUDRATE;
+  bool m_baudrate_pending = false;
+  unsigned long m_baudrate_switch_time = 0;
+  void switch_baudrate(uint32_t baudrate);
+
+  // cnfLine negative acknowledges sent in the current knitting session
+  uint16_t m_line_retransmits = 0;
 
-  PacketSerial_<SLIP, SLIP::END, MAX_MSG_BUFFER_LEN> m_packetSerial;
+  // Rows the host can reference with cnfLineRef, cleared by reqStart
+  RowDictionary m_row_dictionary;
 
   // Different calls
   void reqInfo(const uint8_t* buffer, size_t size);
   void reqStart(const uint8_t* buffer, size_t size);
+  bool start_knitting(uint8_t start_needle, uint8_t end_needle,
+                      uint8_t flags);
+  void reqResume(const uint8_t* buffer, size_t size);
   void cnfLine(const uint8_t* buffer, size_t size);
+  void cnfLineRef(const uint8_t* buffer, size_t size);
+  bool deliver_line(uint8_t line_number, uint8_t colour, bool last_line,
+                    const uint8_t* line);
   void reqTest(const uint8_t* buffer, size_t size);
   void reqInit(const uint8_t* buffer, size_t size);
+  void reqBaud(const uint8_t* buffer, size_t size);
+  void reqPing(const uint8_t* buffer, size_t size, unsigned long start_us);
+  void reqStats(const uint8_t* buffer, size_t size);
+  void reqMotif(const uint8_t* buffer, size_t size);
+  void reqMotifData(const uint8_t* buffer, size_t size);
+  void reqMotifSlot(const uint8_t* buffer, size_t size);
+  void reqTransform(const uint8_t* buffer, size_t size);
+  void reqDobTiming(const uint8_t* buffer, size_t size);
+  void reqSignalFilter(const uint8_t* buffer, size_t size);
+  void reqReferenceNeedles(const uint8_t* buffer, size_t size);
   void reqQuit(const uint8_t* buffer, size_t size);
   void helpCmd(const uint8_t* buffer, size_t size);
   void sendCmd(const uint8_t* buffer, size_t size);
@@ -99,9 +211,13 @@ class Ayab_ : public Communicator {
   void testCmd(const uint8_t* buffer, size_t size);
   void quitCmd(const uint8_t* buffer, size_t size);
   void setCmd(const uint8_t* buffer, size_t size);
+  static uint8_t* write_uint16(uint8_t* payload, uint16_t value);
+  static uint8_t* write_uint32(uint8_t* payload, uint32_t value);
   void send_cnfStart(ErrorCode error_code);
+  void send_cnfBaud(ErrorCode error_code, uint8_t baudrate_index);
+  void send_error(AYAB_API message, ErrorCode error_code);
 };
 
-extern Ayab_& Ayab;
+extern Ayab_ Ayab;
 
 #endif
@@ -0,0 +1,120 @@
+/**
+ * @file slip_link.h
+ * @brief SLIP framing (RFC 1055) of packets over a transport.
+ */
+#ifndef SLIP_LINK_H_
+#define SLIP_LINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Slip {
+const uint8_t END = 0xC0;
+const uint8_t ESC = 0xDB;
+const uint8_t ESC_END = 0xDC;
+const uint8_t ESC_ESC = 0xDD;
+}  // namespace Slip
+
+// start_us: time given to the update() call that read the first byte
+typedef void (*PacketHandler)(const uint8_t* buffer, size_t size,
+                              unsigned long start_us);
+
+/**
+ * Sends and receives SLIP packets on a transport. The transport and the
+ * packet handler are template arguments, so the framing is compiled for each
+ * transport with the handler called directly.
+ *
+ * Packets are decoded as their bytes arrive. A packet longer than BufferSize
+ * is truncated (the handler rejects it by its size or CRC), and an END with
+ * no data before it is passed on as an empty packet. The handler also gets
+ * the time its first byte was read, so that the time a packet waited for the
+ * rest of its bytes (loop busy between reads) can be told apart.
+ */
+template <typename TransportType, size_t BufferSize, PacketHandler handler>
+class SlipLink {
+ private:
+  TransportType transport;
+  uint8_t buffer[BufferSize] = {};
+  size_t size = 0;
+  bool is_escaped = false;
+  bool is_started = false;  // A byte of the packet was read
+  unsigned long start_us = 0;
+
+  void receive(uint8_t byte, unsigned long now_us) {
+    if (byte == Slip::END) {
+      handler(this->buffer, this->size, this->is_started ? this->start_us
+                                                         : now_us);
+      this->size = 0;
+      this->is_escaped = false;
+      this->is_started = false;
+      return;
+    }
+    if (!this->is_started) {
+      this->is_started = true;
+      this->start_us = now_us;
+    }
+    if (this->is_escaped) {
+      this->is_escaped = false;
+      if (byte == Slip::ESC_END) {
+        byte = Slip::END;
+      } else if (byte == Slip::ESC_ESC) {
+        byte = Slip::ESC;
+      }
+    } else if (byte == Slip::ESC) {
+      this->is_escaped = true;
+      return;
+    }
+    if (this->size < BufferSize) {
+      this->buffer[this->size++] = byte;
+    }
+  }
+
+  void write_escaped(uint8_t byte) {
+    if (byte == Slip::END) {
+      this->transport.write(Slip::ESC);
+      this->transport.write(Slip::ESC_END);
+    } else if (byte == Slip::ESC) {
+      this->transport.write(Slip::ESC);
+      this->transport.write(Slip::ESC_ESC);
+    } else {
+      this->transport.write(byte);
+    }
+  }
+
+ public:
+  TransportType& get_transport() { return this->transport; }
+
+  void update(uint8_t max_bytes, unsigned long now_us) {
+    /**
+     * Decode at most `max_bytes` received bytes, handling the packets they
+     * complete.
+     *
+     * @param now_us Current time (micros() on the board), kept for the
+     * packets starting in this call.
+     */
+    for (; max_bytes > 0; max_bytes--) {
+      int byte = this->transport.read();
+      if (byte < 0) {
+        return;
+      }
+      this->receive(static_cast<uint8_t>(byte), now_us);
+    }
+  }
+
+  void send(const uint8_t* packet, size_t length) {
+    /**
+     * Send a packet, framed by END on both sides so that line noise before
+     * it is discarded by the receiver.
+     */
+    if (packet == nullptr || length == 0) {
+      return;
+    }
+    this->transport.write(Slip::END);
+    for (size_t i = 0; i < length; i++) {
+      this->write_escaped(packet[i]);
+    }
+    this->transport.write(Slip::END);
+  }
+};
+
+#endif
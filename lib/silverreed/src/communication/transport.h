@@ -0,0 +1,139 @@
+/**
+ * @file transport.h
+ * @brief Byte transports the AYAB protocol can run on, chosen at compile time.
+ */
+#ifndef TRANSPORT_H_
+#define TRANSPORT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Base of the transports (CRTP). A backend provides begin(baudrate),
+ * available(), read() (-1 when there is no byte), write(byte) and flush();
+ * the base adds what is built on them. Every call is resolved at compile
+ * time, there is no virtual function.
+ */
+template <typename Backend>
+class Transport {
+ public:
+  bool has_input() { return this->backend().available() > 0; }
+
+  void write(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      this->backend().write(buffer[i]);
+    }
+  }
+
+ private:
+  Backend& backend() { return static_cast<Backend&>(*this); }
+};
+
+#if defined(ARDUINO)
+/**
+ * A UART of the board (Serial, Serial1, ...). The port is a template
+ * argument, so the compiler knows its type and calls it directly.
+ */
+template <typename Port, Port* port>
+class UartTransport : public Transport<UartTransport<Port, port>> {
+ public:
+  using Transport<UartTransport<Port, port>>::write;
+
+  void begin(uint32_t baudrate) { port->begin(baudrate); }
+  int available() { return port->available(); }
+  int read() { return port->read(); }
+  void write(uint8_t byte) { port->write(byte); }
+  void flush() { port->flush(); }
+};
+
+typedef UartTransport<decltype(Serial), &Serial> SerialTransport;
+
+#if defined(AYAB_TRANSPORT_SERIAL1)
+#if defined(__AVR__) && !defined(HAVE_HWSERIAL1)
+#error "AYAB_TRANSPORT_SERIAL1: this board has no second UART"
+#endif
+// Second UART, e.g. a Bluetooth or RS-485 module, Serial staying free for
+// debugging
+typedef UartTransport<decltype(Serial1), &Serial1> Serial1Transport;
+#endif
+
+#else
+/**
+ * Native builds: the protocol runs on a file descriptor, a pseudo terminal
+ * opened by begin() (the host software connects to its slave side) or one
+ * end of a socketpair given to attach(), for tests. The baud rate does not
+ * apply.
+ */
+class PtyTransport : public Transport<PtyTransport> {
+ private:
+  int fd = -1;
+
+ public:
+  using Transport<PtyTransport>::write;
+
+  void attach(int descriptor) {
+    this->fd = descriptor;
+    fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) | O_NONBLOCK);
+  }
+  void begin(uint32_t baudrate) {
+    if (this->fd >= 0) {
+      return;
+    }
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master >= 0 && grantpt(master) == 0 && unlockpt(master) == 0) {
+      this->attach(master);
+    }
+  }
+  const char* get_pty_name() const {
+    return this->fd >= 0 ? ptsname(this->fd) : nullptr;
+  }
+  int available() {
+    int bytes = 0;
+    if (this->fd < 0 || ioctl(this->fd, FIONREAD, &bytes) != 0) {
+      return 0;
+    }
+    return bytes;
+  }
+  int read() {
+    uint8_t byte;
+    return this->fd >= 0 && ::read(this->fd, &byte, 1) == 1 ? byte : -1;
+  }
+  void write(uint8_t byte) {
+    if (this->fd >= 0 && ::write(this->fd, &byte, 1) != 1) {
+      return;  // Nobody connected, the byte is dropped like on a UART
+    }
+  }
+  void flush() {}
+};
+#endif
+
+// Transport of the AYAB protocol
+#if !defined(ARDUINO)
+typedef PtyTransport AyabLinkTransport;
+#elif defined(AYAB_TRANSPORT_SERIAL1)
+typedef Serial1Transport AyabLinkTransport;
+#else
+typedef SerialTransport AyabLinkTransport;
+#endif
+
+#if defined(AYAB_TRANSPORT_CAPTURE)
+// Unit tests: the packets sent are also decoded for the tests to check, see
+// test/test_embedded/capture_transport.h (set by scripts/test_transport_env.py)
+#include "capture_transport.h"
+typedef CaptureTransport<AyabLinkTransport, MAX_MSG_BUFFER_LEN> AyabTransport;
+#else
+typedef AyabLinkTransport AyabTransport;
+#endif
+
+#endif
@@ -19,7 +19,8 @@
 namespace PinsCorrespondance {
 /**
  * ND1 (Needle Detection 1) - Pattern position sensor
- * Currently not used in this implementation.
+ * Rises at fixed needles of the bed (see ND1_REFERENCE_PERIOD), used as an
+ * absolute reference for the needle count.
  */
 const int ND1 = 2;
 
@@ -56,6 +57,13 @@ const int HOK = 6;
  * to prevent overheating and reduce power consumption.
  */
 const int SOLENOID_POWER = 7;
+
+/**
+ * BEEPER - Optional piezo buzzer
+ * Same pin as on the AYAB shields. Used for the warnings when the beeper is
+ * enabled by reqStart; nothing happens if no buzzer is fitted.
+ */
+const int BEEPER = 9;
 }  // namespace PinsCorrespondance
 
 // Solenoid power management
@@ -65,6 +73,103 @@ const unsigned long SOLENOID_INACTIVITY_TIMEOUT_MS =
 // Pattern and needle configuration
 const uint8_t DEFAULT_MAX_NEEDLES = 200;  // Default maximum needle count
 const int CARRIAGE_OFF_PATTERN = -1;  // Sentinel value: carriage not on pattern
+const int CARRIAGE_POSITION_UNKNOWN = -1;  // Before the first row or reference
+const uint8_t MAX_LINE_BUFFER_LEN = 25;  // Bytes per row (200 needles / 8)
+const uint8_t MAX_MSG_BUFFER_LEN = 64;   // Longest protocol packet
+
+// Absolute needle reference
+// ND1 rises on the needles n of the bed with n % ND1_REFERENCE_PERIOD equal to
+// ND1_REFERENCE_OFFSET (calibration of the machine). The needle count is moved
+// to the nearest reference, so up to half a period of missed edges is
+// corrected. 0 ignores ND1: the reference needles have not been measured yet,
+// and a wrong calibration would move correct rows. The host sets the measured
+// values with reqReferenceNeedles.
+const uint8_t ND1_REFERENCE_PERIOD = 0;
+const uint8_t ND1_REFERENCE_OFFSET = 0;
+
+// Batched line transfer
+// Number of row slots in the line queue, including the row being knitted.
+// The host may push (LINE_QUEUE_SLOTS - used slots) rows ahead of the carriage.
+const uint8_t LINE_QUEUE_SLOTS = 4;
+
+// Row dictionary
+// Rows kept on the device so that the host can reference them (cnfLineRef)
+// instead of sending them again.
+const uint8_t ROW_DICTIONARY_SLOTS = 4;
+
+// Standalone knitting
+// Largest motif tile kept in SRAM, in bytes (e.g. 24 needles x 32 rows)
+const uint8_t MOTIF_MAX_BYTES = 96;
+
+// Motif store (EEPROM)
+// Motifs are kept in MOTIF_STORE_SLOTS slots, spread over MOTIF_STORE_RECORDS
+// physical records (more records than slots for wear levelling).
+const uint16_t MOTIF_STORE_ADDRESS = 0;  // First EEPROM byte of the store
+const uint8_t MOTIF_STORE_SLOTS = 4;
+const uint8_t MOTIF_STORE_RECORDS = 7;  // 7 x 108 bytes = 756 bytes
+
+// Session checkpoint (EEPROM), after the motif store
+// The knitting progress is written at each row boundary to the next of
+// CHECKPOINT_RECORDS records (wear levelling), one byte per housekeeping tick.
+const uint16_t CHECKPOINT_ADDRESS = 756;  // First EEPROM byte of the records
+const uint8_t CHECKPOINT_RECORDS = 32;    // 32 x 7 bytes = 224 bytes
+
+// Row turnaround statistics
+// Log2 millisecond bins: <1 ms, 1-2 ms, 2-4 ms, ... 32-64 ms, >=64 ms
+const uint8_t TURNAROUND_HISTOGRAM_BINS = 8;
+
+// Carriage speed
+// DOB is written at the CCP edge of a needle (or phase advance before it, see
+// reqDobTiming), and its level must be held at the next CCP edge, half a
+// needle period later (RowCheck). The solenoid needs SOLENOID_SETTLE_US in
+// between, so the half needle period may not get shorter than that.
+// PLACEHOLDER: 2 ms is an estimate, not measured yet. Find the real limit on
+// the machine (speed in indState when needles start to be missed) and replace
+// it.
+const unsigned long SOLENOID_SETTLE_US = 2000;
+// Highest carriage speed at which the solenoids still select every needle, in
+// needles per second: 250 with a settle time of 2 ms.
+const uint16_t MAX_SAFE_NEEDLES_PER_SECOND =
+    1000000UL / (2 * SOLENOID_SETTLE_US);
+// The overspeed warning is sent from this percentage of the safe speed, before
+// stitches are actually missed.
+const uint8_t OVERSPEED_WARNING_PERCENT = 90;
+const uint8_t SPEED_AVERAGE_SHIFT = 3;  // Moving average over ~8 needles
+const uint8_t SPEED_PERIOD_FRACTION_BITS = 4;
+// A longer CCP period means the carriage stopped (estimate restarted)
+const unsigned long SPEED_STOPPED_PERIOD_US = 200000;
+
+// Carriage events
+// Signal changes queued by the pin interrupts until the loop processes them
+// (5 bytes each, one slot kept empty): 15 edges, 30 ms at full speed.
+const uint8_t CARRIAGE_EVENT_QUEUE_SLOTS = 16;
+
+// Cooperative scheduler (src/main.cpp)
+// Tasks by priority: carriage events, serial input, row requests,
+// housekeeping. The budgets are the expected longest runs; the carriage edge
+// latency is bounded by the longest run of the other tasks.
+const uint8_t SCHEDULER_MAX_TASKS = 4;
+const uint8_t PROTOCOL_RX_CHUNK_BYTES = 16;  // Bytes parsed per protocol run
+const uint16_t CARRIAGE_TASK_BUDGET_US = 300;
+const uint16_t PROTOCOL_TASK_BUDGET_US = 1000;  // A cnfLine is handled in it
+const uint16_t ROW_REQUEST_TASK_BUDGET_US = 300;
+const uint16_t HOUSEKEEPING_TASK_BUDGET_US = 300;
+const uint8_t HOUSEKEEPING_PERIOD_MS = 10;  // Timeouts, checkpoint
+
+// Timer1 (scheduled DOB output, carriage sampler)
+// Prescaler: 4 us ticks at 16 MHz, compares up to 262 ms ahead
+const unsigned long TIMER1_PRESCALER = 64;
+
+// Carriage signal filter
+// CCP, KSL and HOK are sampled every SIGNAL_SAMPLE_PERIOD_US when a filter is
+// configured. A filter adds its depth in samples of latency to each edge:
+// keep depth x period well below the half CCP period at full speed (2 ms).
+const unsigned long SIGNAL_SAMPLE_PERIOD_US = 100;
+const uint8_t SIGNAL_FILTER_MAX_DEPTH = 15;   // Integrator, in samples
+const uint8_t SIGNAL_MAJORITY_MAX_DEPTH = 7;  // Majority vote window
+
+const unsigned int BEEP_FREQUENCY_HZ = 2000;
+const unsigned long OVERSPEED_BEEP_MS = 100;
 
 // Bit manipulation constants
 const uint8_t BITS_PER_BYTE = 8;
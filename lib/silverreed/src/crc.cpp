@@ -0,0 +1,33 @@
+#include "crc.h"
+
+#include "config.h"
+
+uint8_t crc8_update(uint8_t crc, uint8_t data) {
+  /**
+   * Add one byte to a running CRC-8 (Dallas/Maxim, reflected 0x31).
+   * Start from 0x00 for a new checksum.
+   */
+  for (uint8_t tempi = BITS_PER_BYTE; tempi; tempi--) {
+    uint8_t sum = (crc ^ data) & 0x01U;
+    crc >>= 1U;
+
+    if (sum) {
+      crc ^= CRC8_POLYNOMIAL;
+    }
+    data >>= 1U;
+  }
+  return crc;
+}
+
+uint8_t crc8(const uint8_t* buffer, size_t len) {
+  /**
+   * CRC-8 of a buffer.
+   */
+  uint8_t crc = 0x00U;
+
+  while (len--) {
+    crc = crc8_update(crc, *buffer);
+    buffer++;
+  }
+  return crc;
+}
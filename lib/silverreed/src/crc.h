@@ -0,0 +1,16 @@
+/**
+ * @file crc.h
+ * @brief CRC-8 used by the AYAB protocol and the persistent storage.
+ */
+#ifndef CRC_H_
+#define CRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+constexpr uint8_t CRC8_POLYNOMIAL = 0x8C;  // CRC-8 polynomial for checksums
+
+uint8_t crc8_update(uint8_t crc, uint8_t data);
+uint8_t crc8(const uint8_t* buffer, size_t len);
+
+#endif
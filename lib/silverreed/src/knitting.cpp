@@ -1,30 +1,46 @@
 #include "knitting.h"
 
+#include "boot_timing.h"
 #include "communication/ayab.h"
 #include "config.h"
 #include "debug.h"
+#include "machine/carriage_events.h"
+#include "machine/carriage_sampler.h"
+#include "machine/dob_scheduler.h"
 #include "pattern.h"
 
-KnittingProcess_& KnittingProcess = KnittingProcess.getInstance();
-
-KnittingProcess_& KnittingProcess_::getInstance() {
-  static KnittingProcess_ instance;
-  return instance;
-}
+// Statically allocated: accessed directly, without the guard of a function
+// local static. The knitting state is set by reset(), called from setup().
+KnittingProcess_ KnittingProcess;
 
 void KnittingProcess_::reset() {
   /**
    * Reset the knitting process to initial state.
    */
-  this->knitting_state = Idle;
+  this->phase = PHASE_IDLE;
   this->current_row = 0;
   this->current_stitch = 0;
-  this->carriage = Carriage();
+  this->carriage.reset();
   this->pattern = Pattern();
 
   this->current_needle_index = CARRIAGE_OFF_PATTERN;
-  this->carriage.power_solenoid(LOW);
-  this->is_start_out_of_pattern = false;
+  this->is_next_needle_scheduled = false;
+  this->continuous_reporting = false;
+  this->beeper_enabled = false;
+  this->line_queue.clear();
+  this->batched_lines = false;
+  this->is_waiting_line = true;
+  this->expected_line = 0;
+  this->colour_passes = 1;
+  this->expected_colour = 0;
+  this->is_last_pass = false;
+  // The motif itself is kept, it can be knitted again without uploading it
+  this->standalone = false;
+  this->flash_rows = nullptr;
+  this->is_turnaround_pending = false;
+  this->row_repeat_count = 1;
+  this->row_check_report = ROW_CHECK_OFF;
+  CarriageEvents::begin();
   DEBUG_WAIT_START();
 }
 
@@ -37,20 +53,25 @@ bool KnittingProcess_::init() {
    * @return true if initialization succeeded
    */
   // If not in Idle state, reset the knitting process first
-  if (this->knitting_state != Idle) {
+  if (this->get_knitting_state() != Idle) {
     DEBUG_PRINTLN("reqInit received while not Idle, resetting process");
     KnittingProcess.reset();
   }
 
   DEBUG_PRINTLN("Initializing knitting process");
-  this->knitting_state = WaitingStart;
+  this->dispatch(EVENT_INIT);
+  // Transforms only apply to the session they were configured for
+  this->row_transform = RowTransform();
+  BootTiming::mark_ready();
 
   return true;
 }
 
 bool KnittingProcess_::start_knitting(uint8_t start_needle, uint8_t end_needle,
                                       bool continuous_reporting_enabled,
-                                      bool beeper_enabled) {
+                                      bool beeper_enabled, bool batched_lines,
+                                      bool standalone, uint8_t colour_passes,
+                                      RowCheckReport row_check_report) {
   /**
    * Start the knitting process.
    * This function is called when Ayab sends a request to start the knitting
@@ -58,9 +79,13 @@ bool KnittingProcess_::start_knitting(uint8_t start_needle, uint8_t end_needle,
    *
    * @param start_needle The first needle of the pattern.
    * @param end_needle The last needle of the pattern.
-   * @param continuous_reporting_enabled If the continuous reporting is enabled.
-   * TODO UNUSED
-   * @param beeper_enabled If the beeper is enabled. TODO UNUSED
+   * @param continuous_reporting_enabled If indState is sent after each row.
+   * @param beeper_enabled If the warnings also sound the beeper.
+   * @param batched_lines If the host pushes rows ahead using line credits.
+   * @param standalone If the rows are generated from the uploaded motif.
+   * @param colour_passes Number of passes (colours) knitted for each row.
+   * @param row_check_report What is sent to the host after each row about
+   * the needles selected.
    * @return true if knitting started successfully, false if invalid parameters
    */
   // Validate needle range
@@ -74,44 +99,101 @@ bool KnittingProcess_::start_knitting(uint8_t start_needle, uint8_t end_needle,
     return false;
   }
 
+  if (colour_passes == 0 || colour_passes > LINE_QUEUE_SLOTS) {
+    DEBUG_PRINTLN("Invalid number of colour passes");
+    return false;
+  }
+
+  if (standalone && !this->motif.is_loaded()) {
+    DEBUG_PRINTLN("Cannot start standalone: no motif loaded");
+    return false;
+  }
+
   // Only allow starting from WaitingStart state
-  if (this->knitting_state != WaitingStart) {
+  if (this->get_knitting_state() != WaitingStart) {
     DEBUG_PRINTLN("Cannot start: not in WaitingStart state");
     return false;
   }
 
   this->start_needle = start_needle;
   this->end_needle = end_needle;
-  this->knitting_state = Knitting;
+  this->dispatch(EVENT_START);
   this->pattern.set_needle_range(start_needle, end_needle);
+  this->batched_lines = batched_lines && !standalone;
+  this->standalone = standalone;
+  this->colour_passes = standalone ? 1 : colour_passes;
+  this->expected_colour = 0;
+  this->standalone_row = 0;
+  this->flash_rows = nullptr;
+  this->line_queue.clear();
+  this->is_waiting_line = true;
+  this->expected_line = 0;
+  this->turnaround_stats.clear();
+  this->continuous_reporting = continuous_reporting_enabled;
+  this->beeper_enabled = beeper_enabled;
+  this->speed_estimator.clear();
+  this->is_overspeed_reported = false;
+  CarriageSampler::clear_rejected_glitches();
+  this->lost_carriage_events = 0;
+  this->max_edge_latency_us = 0;
+  this->reversals = 0;
+  this->carriage_position = CARRIAGE_POSITION_UNKNOWN;
+  this->position_corrections = 0;
+  this->row_check.clear();
+  this->row_check_report = row_check_report;
+  this->current_row = 0;
+  this->save_checkpoint(0);
+  return true;
+}
+
+bool KnittingProcess_::start_flash_pattern(const uint8_t* rows,
+                                           uint16_t row_count,
+                                           uint8_t start_needle,
+                                           uint8_t end_needle) {
+  /**
+   * Start knitting a pattern stored in program memory (baked-in pattern).
+   * Called at boot by firmwares built with BAKED_PATTERN: the rows are read
+   * in place from flash, without any host.
+   *
+   * @param rows row_count rows of MAX_LINE_BUFFER_LEN bytes, in PROGMEM,
+   * using the cnfLine layout once inverted (see scripts/bake_pattern.py).
+   * @param row_count The number of rows of the pattern.
+   * @param start_needle The first needle of the pattern.
+   * @param end_needle The last needle of the pattern.
+   * @return true if knitting started successfully, false if invalid parameters
+   */
+  if (rows == nullptr || row_count == 0) {
+    DEBUG_PRINTLN("Cannot start flash pattern: empty pattern");
+    return false;
+  }
+
+  this->init();
+  if (!this->start_knitting(start_needle, end_needle, false, false)) {
+    return false;
+  }
+  this->standalone = true;
+  this->flash_rows = rows;
+  this->flash_row_count = row_count;
   return true;
 }
 
-void KnittingProcess_::start_knitting_if_carriage_moves(
-    CarriageState carriage_state) {
+void KnittingProcess_::announce_carriage(CarriageDirection direction) {
   /**
-   * Start the knitting process if the carriage moves.
-   * This function is called when the knitting process is in the WaitingStart
-   * state.
-   * It checks if the carriage moves.
-   * If the carriage moves, it starts the knitting process by requesting the
-   * first row to ayab.
+   * The carriage moved before the first row: tell the host its direction and
+   * power the solenoids.
    *
    * NOTE: With this method, if the carriage first moves in the wrong direction,
    * it can cause issues on Ayab side because it will get a wrong information.
    *
-   * @param carriage_state The current state of the carriage.
+   * @param direction The direction of the carriage.
    */
-  if (carriage_state.is_carriage_moving(this->previousCarriageState) &&
-      carriage_state.is_start_of_needle(this->previousCarriageState)) {
-    DEBUG_PRINTLN("Carriage moving, start knitting");
-    Ayab.getInstance().sendIndState(carriage_state.get_direction());
-    this->carriage.power_solenoid(HIGH);
-  }
+  DEBUG_PRINTLN("Carriage moving, start knitting");
+  Ayab.sendIndState(direction);
+  this->carriage.power_solenoid(HIGH);
 }
 
 void KnittingProcess_::set_next_line(uint8_t line_number, bool last_line_flag,
-                                     uint8_t* line) {
+                                     const uint8_t* line, bool line_in_flash) {
   /**
    * Set the next line of the pattern.
    * This function is called when Ayab sends a line of the pattern (cnfLine).
@@ -119,21 +201,29 @@ void KnittingProcess_::set_next_line(uint8_t line_number, bool last_line_flag,
    * @param line_number The number of the line.
    * @param last_line_flag If the line is the last line of the pattern.
    * @param line The buffer of the line.
+   * @param line_in_flash If the buffer is stored in program memory.
    *
    * @warning This function assumes the knitting process is in a valid state
    * (WaitingStart or Knitting). It should only be called in response to
    * reqLine requests.
    */
-  if (this->knitting_state != WaitingStart &&
-      this->knitting_state != Knitting) {
+  if (this->get_knitting_state() == Idle) {
     DEBUG_PRINTLN("set_next_line: invalid state");
     return;
   }
 
+  if (this->is_turnaround_pending) {
+    this->is_turnaround_pending = false;
+    this->turnaround_stats.record(micros() - this->pattern_exit_time);
+  }
+
   if (last_line_flag) {
     // Ayab sends one row in advance for brother knitting (preparation row)
     // So when we get the last_line_flag, it means the knitting is already
     // finished
+    if (!this->standalone) {
+      this->checkpoint.end_session();
+    }
     this->reset();
   }
 
@@ -143,101 +233,816 @@ void KnittingProcess_::set_next_line(uint8_t line_number, bool last_line_flag,
   }
 
   this->current_row = line_number + 1;
-  this->pattern.set_buffer(line);
+  if (!this->uses_line_queue()) {
+    this->expected_line = this->current_row;
+  }
+  if (!this->row_transform.is_identity()) {
+    this->row_transform.apply(line, line_in_flash, this->start_needle,
+                              this->end_needle, this->transformed_line);
+    this->pattern.set_buffer(this->transformed_line);
+  } else if (line_in_flash) {
+    this->pattern.set_flash_buffer(line);
+  } else {
+    this->pattern.set_buffer(line);
+  }
+  this->row_repeat_count = 1;
   this->is_last_line = last_line_flag;
-  return;
+  this->is_waiting_line = false;
+  this->dispatch(EVENT_ROW_INSTALLED);
+}
+
+bool KnittingProcess_::queue_line(uint8_t line_number, bool last_line_flag,
+                                  const uint8_t* line, uint8_t colour) {
+  /**
+   * Queue a line pushed ahead by the host (batched line transfer, or the
+   * colour passes of a row in multi-colour knitting).
+   * If the carriage is already waiting for a row, the line is installed
+   * immediately, otherwise it is installed when the current row is finished.
+   *
+   * @param line_number The number of the line.
+   * @param last_line_flag If the line is the last line of the pattern.
+   * @param line The buffer of the line, copied into the queue.
+   * @param colour The pass index of the line within its row.
+   * @return false if the line was dropped (invalid state or no credit left).
+   */
+  if (this->get_knitting_state() != Knitting || !this->uses_line_queue()) {
+    DEBUG_PRINTLN("queue_line: invalid state");
+    return false;
+  }
+
+  if (line_number != this->expected_line || colour != this->expected_colour) {
+    // A previous line was lost (e.g. CRC error): drop the following ones
+    // until the host goes back to the expected line.
+    DEBUG_PRINTLN("queue_line: unexpected line number");
+    return false;
+  }
+
+  if (line == nullptr ||
+      !this->line_queue.push(line_number, last_line_flag, line, colour)) {
+    DEBUG_PRINTLN("queue_line: no credit left");
+    return false;
+  }
+  if (++this->expected_colour >= this->colour_passes) {
+    this->expected_colour = 0;
+    this->expected_line = line_number + 1;
+  }
+
+  if (this->is_waiting_line) {
+    this->install_queued_line();
+  }
+  return true;
+}
+
+void KnittingProcess_::install_queued_line() {
+  /**
+   * Install the oldest queued line as the current row of the pattern.
+   * The line stays in its queue slot until the row is finished.
+   *
+   * A line ending the session is not knitted, except a colour pass: the
+   * passes of a row are sent together, so the last pass of the last row
+   * carries the flag and ends the session once knitted (request_next_line).
+   */
+  QueuedLine* next_line = this->line_queue.front();
+  if (next_line == nullptr) {
+    this->is_waiting_line = true;
+    return;
+  }
+  bool last_line = next_line->last_line;
+  if (last_line && this->colour_passes > 1) {
+    this->is_last_pass = true;
+    last_line = false;
+  }
+  this->set_next_line(next_line->line_number, last_line, next_line->data);
+}
+
+uint8_t KnittingProcess_::get_current_colour() {
+  /**
+   * @return The pass index (colour) of the row being knitted.
+   */
+  QueuedLine* current_line = this->line_queue.front();
+  if (!this->uses_line_queue() || current_line == nullptr) {
+    return 0;
+  }
+  return current_line->colour;
+}
+
+void KnittingProcess_::install_standalone_line() {
+  /**
+   * Install the next row generated on the device (standalone mode).
+   */
+  if (this->flash_rows != nullptr) {
+    this->install_flash_line();
+  } else {
+    this->install_motif_line();
+  }
+}
+
+void KnittingProcess_::install_motif_line() {
+  /**
+   * Generate the next row from the motif and install it (standalone mode).
+   * The previous row is overwritten, which is safe since the carriage left
+   * the pattern section.
+   */
+  uint16_t rows = this->motif.get_rows();
+  bool last_line = rows != 0 && this->standalone_row >= rows;
+  this->motif.render_row(this->standalone_row, this->motif_line);
+  this->set_next_line(static_cast<uint8_t>(this->standalone_row), last_line,
+                      this->motif_line);
+  this->standalone_row++;
+}
+
+void KnittingProcess_::install_flash_line() {
+  /**
+   * Install the next row of the pattern baked in flash.
+   * The row is knitted straight from program memory, nothing is copied.
+   */
+  bool last_line = this->standalone_row >= this->flash_row_count;
+  // The last line only ends the knitting, point it at a valid row anyway
+  uint16_t row = last_line ? 0 : this->standalone_row;
+  this->set_next_line(static_cast<uint8_t>(this->standalone_row), last_line,
+                      this->flash_rows + row * MAX_LINE_BUFFER_LEN, true);
+  this->standalone_row++;
+}
+
+bool KnittingProcess_::save_motif(uint8_t slot) {
+  /**
+   * Save the uploaded motif in a persistent slot.
+   * Not allowed while knitting: the EEPROM write blocks for a few hundred ms.
+   *
+   * @return true if the motif was saved.
+   */
+  if (this->get_knitting_state() == Knitting) {
+    DEBUG_PRINTLN("save_motif: not allowed while knitting");
+    return false;
+  }
+  return this->motif_store.save(slot, this->motif);
+}
+
+bool KnittingProcess_::load_motif(uint8_t slot) {
+  /**
+   * Replace the motif by the one saved in a persistent slot, ready to be
+   * knitted with a standalone reqStart.
+   *
+   * @return true if the slot held a valid motif.
+   */
+  if (this->standalone) {
+    DEBUG_PRINTLN("load_motif: motif is being knitted");
+    return false;
+  }
+  return this->motif_store.load(slot, this->motif);
+}
+
+void KnittingProcess_::request_next_line() {
+  /**
+   * Ask the host for the next row once the carriage left the pattern section.
+   *
+   * In batched mode the finished row releases its slot, the next queued row
+   * (if any) is installed and the host is told how many slots are free.
+   * In multi-colour mode the next pass of the row is already queued: the host
+   * is only asked for the next row, with all its passes, after the last pass.
+   * In standalone mode the row is generated locally.
+   * With a row repeat transform, the current row is kept for its remaining
+   * passes first.
+   */
+  if (this->row_repeat_count < this->row_transform.get_row_repeat()) {
+    this->row_repeat_count++;
+    this->is_turnaround_pending = false;
+    this->dispatch(EVENT_ROW_INSTALLED);
+    return;
+  }
+
+  if (this->standalone) {
+    this->install_standalone_line();
+    return;
+  }
+
+  if (!this->uses_line_queue()) {
+    this->expected_line = this->current_row;
+    Ayab.sendReqLine(this->current_row);
+    return;
+  }
+
+  if (this->is_last_pass) {
+    // The flagged colour pass is knitted, the passes after it are dropped
+    this->checkpoint.end_session();
+    this->reset();
+    return;
+  }
+  this->line_queue.pop();
+  this->is_waiting_line = true;
+  this->install_queued_line();
+  if (this->get_knitting_state() != Knitting) {
+    // The installed line was the last one, the process has been reset.
+    return;
+  }
+  if (this->batched_lines) {
+    Ayab.sendIndLineCredits(this->expected_line, this->line_queue.free_slots());
+  } else if (this->is_waiting_line) {
+    Ayab.sendReqLine(this->expected_line);
+  }
+}
+
+bool KnittingProcess_::configure_dob_timing(bool scheduling,
+                                            uint8_t phase_advance) {
+  /**
+   * Choose how DOB follows the CCP edges. Kept across knitting sessions, it
+   * is a calibration of the machine.
+   *
+   * @param scheduling If the next needle is written by a hardware timer
+   * rather than when the loop notices the CCP edge.
+   * @param phase_advance How early the next needle is written, in 1/256 of
+   * the CCP period before its expected edge.
+   * @return false while knitting or if no timer is available.
+   */
+  if (this->get_knitting_state() == Knitting) {
+    DEBUG_PRINTLN("configure_dob_timing: not allowed while knitting");
+    return false;
+  }
+  if (scheduling && !DobScheduler::is_supported()) {
+    DEBUG_PRINTLN("configure_dob_timing: no timer on this board");
+    return false;
+  }
+  this->dob_scheduling = scheduling;
+  this->dob_phase_advance = phase_advance;
+  return true;
+}
+
+bool KnittingProcess_::configure_signal_filter(SampledSignal signal,
+                                               uint8_t mode, uint8_t depth) {
+  /**
+   * Filter glitches out of a carriage signal. Kept across knitting sessions,
+   * it depends on the machine and its cables.
+   *
+   * @param signal CCP, KSL or HOK.
+   * @param mode Integrator or majority vote (see SignalFilter).
+   * @param depth Samples of the filter, 0 or 1 to read the pin directly.
+   * @return false while knitting or if the filter is not supported.
+   */
+  if (this->get_knitting_state() == Knitting) {
+    DEBUG_PRINTLN("configure_signal_filter: not allowed while knitting");
+    return false;
+  }
+  return CarriageSampler::configure(signal, mode, depth);
+}
+
+bool KnittingProcess_::configure_reference_needles(uint8_t period,
+                                                   uint8_t offset) {
+  /**
+   * Set the needles ND1 rises on (see ND1_REFERENCE_PERIOD), once measured on
+   * the machine. Kept across knitting sessions.
+   *
+   * @param period Needles between two references, 0 to ignore ND1.
+   * @param offset First reference needle, less than the period.
+   * @return false while knitting or if the offset is out of the period.
+   */
+  if (this->get_knitting_state() == Knitting) {
+    DEBUG_PRINTLN("configure_reference_needles: not allowed while knitting");
+    return false;
+  }
+  if (period != 0 && offset >= period) {
+    return false;
+  }
+  this->reference_period = period;
+  this->reference_offset = offset;
+  return true;
+}
+
+void KnittingProcess_::schedule_next_needle(CarriageDirection direction,
+                                            unsigned long edge_time) {
+  /**
+   * Schedule the DOB state of the next needle from the CCP period, so that
+   * it is set up `dob_phase_advance` before the carriage reaches it.
+   * Without a speed estimate (first needles) the needles are written when
+   * their edge is seen.
+   *
+   * @param edge_time When the edge of the current needle happened, the time
+   * the loop took to process it is deducted.
+   */
+  this->is_next_needle_scheduled = false;
+  int next_needle = this->current_needle_index + 1;
+  if (!this->dob_scheduling || !this->speed_estimator.is_valid() ||
+      next_needle > this->end_needle - this->start_needle) {
+    return;
+  }
+
+  uint32_t period = this->speed_estimator.get_period_us();
+  uint32_t delay = period - ((period * this->dob_phase_advance) >> 8);
+  uint32_t elapsed = micros() - edge_time;
+  delay = elapsed < delay ? delay - elapsed : 0;
+  bool needle_state = this->pattern.get_needle_state(next_needle, direction);
+  this->carriage.schedule_DOB_state(needle_state, delay);
+  this->is_next_needle_scheduled = true;
+}
+
+void KnittingProcess_::check_overspeed() {
+  /**
+   * Warn the host (and the knitter, with the beeper) when the carriage gets
+   * close to the highest speed at which needles are reliably selected.
+   * Sent at most once per row.
+   */
+  constexpr uint32_t warning_period = SpeedEstimator::period_of(
+      static_cast<uint32_t>(MAX_SAFE_NEEDLES_PER_SECOND) *
+      OVERSPEED_WARNING_PERCENT / 100);
+  if (this->is_overspeed_reported ||
+      !this->speed_estimator.reaches(warning_period)) {
+    return;
+  }
+
+  this->is_overspeed_reported = true;
+  DEBUG_PRINTLN("Carriage overspeed");
+  Ayab.sendIndOverspeed(this->speed_estimator.get_needles_per_second());
+  if (this->beeper_enabled) {
+    this->carriage.beep(OVERSPEED_BEEP_MS);
+  }
 }
 
 void KnittingProcess_::knitting_loop() {
   /**
    * The main loop of the knitting process.
    * This function is called in the loop of the Arduino.
-   * It handles the knitting process state machine.
+   * It runs the state machine once for each carriage event queued since the
+   * previous call, in order, or once with the unchanged carriage state.
    */
+  if (!this->service_carriage_events()) {
+    this->housekeeping();
+  }
+}
 
-  // To avoid any incoherence, we always get the current state of the carriage
-  // at the beginning of the loop. This state will be used every time we need to
-  // read carriage state during this iteration.
-  CarriageState current_carriage_state = CarriageState::read_from_pins();
+bool KnittingProcess_::service_carriage_events() {
+  /**
+   * Run the state machine once for each carriage event queued since the
+   * previous call, in order, so that no edge is missed when the loop is late
+   * (e.g. while a message is handled).
+   *
+   * @return true if carriage events were processed.
+   */
+  CarriageEvents::poll();
+  uint8_t lost_events = CarriageEvents::take_lost_events();
+  if (lost_events != 0) {
+    DEBUG_PRINTLN("Carriage events lost, event queue full");
+    this->lost_carriage_events += lost_events;
+  }
+
+  CarriageEvent event;
+  bool has_event = false;
+  while (CarriageEvents::pop(event)) {
+    has_event = true;
+    unsigned long latency = micros() - event.time_us;
+    if (latency > this->max_edge_latency_us) {
+      this->max_edge_latency_us = latency;
+    }
+    this->process_carriage_state(event.to_state(), event.time_us);
+  }
+  if (lost_events != 0) {
+    // Resynchronise on the pins, the missing edges cannot be recovered
+    this->dispatch(EVENT_EVENTS_LOST);
+    this->process_carriage_state(CarriageSampler::read(), micros());
+    return true;
+  }
+  return has_event;
+}
+
+void KnittingProcess_::housekeeping() {
+  /**
+   * Run the state machine with the unchanged carriage state: first row
+   * request, solenoid inactivity timeout. Done when no carriage event is
+   * pending. The session checkpoint is written a byte at a time.
+   */
+  this->process_carriage_state(this->previousCarriageState, micros());
+  this->checkpoint.service();
+}
+
+bool KnittingProcess_::is_row_request_due() const {
+  /**
+   * If the first row of the session is to be asked for: the session started
+   * and the line queue has room for it. Checked by the scheduler, so the
+   * request does not wait for the housekeeping tick.
+   */
+  return this->phase == PHASE_STARTING && !this->line_queue.is_full();
+}
+
+void KnittingProcess_::request_rows() {
+  /**
+   * Ask for the first row (or generate it in standalone mode) with the
+   * unchanged carriage state.
+   */
+  this->dispatch(EVENT_STEP);
+}
+
+void KnittingProcess_::process_carriage_state(
+    CarriageState current_carriage_state, unsigned long time_us) {
+  /**
+   * One step of the knitting process state machine: the carriage change is
+   * turned into events (point cam, then needle) run through the transition
+   * table.
+   *
+   * @param current_carriage_state The carriage signals after an event, or the
+   * unchanged ones.
+   * @param time_us When the carriage got into this state, from micros().
+   */
+  KnittingState state = this->get_knitting_state();
+  CarriageDirection direction = current_carriage_state.get_direction();
 
   // Track carriage movement and manage solenoid power
   bool carriage_is_moving =
       current_carriage_state.is_carriage_moving(this->previousCarriageState);
+  if (carriage_is_moving && state != Idle) {
+    this->carriage.update_last_movement();
+  }
+  if (state == Knitting) {
+    // If solenoid was turned off due to inactivity, turn it back on
+    if (carriage_is_moving && !this->carriage.is_solenoid_powered()) {
+      this->carriage.power_solenoid(HIGH);
+    }
+    // Check for inactivity timeout and turn off solenoid if necessary
+    this->carriage.check_and_shutoff_if_inactive();
+  }
 
-  switch (knitting_state) {
-    case Idle:
-      // nothing to do in this case
-      break;
+  if (this->phase == PHASE_STARTING) {
+    // The only phase with a STEP rule: no table lookup on the other steps
+    this->dispatch(EVENT_STEP, current_carriage_state, time_us);
+  }
+  if (current_carriage_state.is_start_in_pattern(this->previousCarriageState)) {
+    this->dispatch(EVENT_ENTER_PATTERN, current_carriage_state, time_us);
+  } else if (current_carriage_state.is_start_out_of_pattern(
+                 this->previousCarriageState)) {
+    this->dispatch(EVENT_LEAVE_PATTERN, current_carriage_state, time_us);
+  }
+  if (current_carriage_state.is_direction_change(this->previousCarriageState)) {
+    this->dispatch(EVENT_REVERSE, current_carriage_state, time_us);
+  }
 
-    case WaitingStart: {
-      // Waiting for the carriage to move to start the knitting process
-      this->start_knitting_if_carriage_moves(current_carriage_state);
-      if (carriage_is_moving) {
-        this->carriage.update_last_movement();
-      }
-      break;
+  if (current_carriage_state.is_start_of_needle(this->previousCarriageState)) {
+    if (state == Knitting) {
+      this->speed_estimator.record_edge(time_us);
+      this->check_overspeed();
     }
-    case Knitting: {
-      // Knitting mode
-
-      // Track movement and update timestamp
-      if (carriage_is_moving) {
-        this->carriage.update_last_movement();
-        // If solenoid was turned off due to inactivity, turn it back on
-        if (!this->carriage.is_solenoid_powered()) {
-          this->carriage.power_solenoid(HIGH);
-        }
-      }
+    // Before the edge is processed: the level held up to it
+    this->record_needle_level(direction, current_carriage_state.DOB);
+    if (!current_carriage_state.is_in_pattern_section()) {
+      this->dispatch(EVENT_NEEDLE_OUTSIDE, current_carriage_state, time_us);
+    } else if (this->phase == PHASE_IN_PATTERN) {
+      // Hot path: the rule of this event in this phase is known
+      this->knit_needle(direction, time_us);
+    } else {
+      this->dispatch(EVENT_NEEDLE_IN_PATTERN, current_carriage_state, time_us);
+    }
+    if (state == Knitting) {
+      this->track_carriage_position(direction);
+    }
+  }
 
-      // Check for inactivity timeout and turn off solenoid if necessary
-      this->carriage.check_and_shutoff_if_inactive();
-
-      // Always request the first row when the knitting process starts
-      if (this->current_row == 0) {
-        DEBUG_PRINTLN("Requesting first row");
-        Ayab.sendReqLine(0);
-        this->current_row++;  // need to explicitly increment the row here; if
-                              // not the row will be 0
-        // and the next loop iteration will request the first row again if ayab
-        // didn't have the time to send the row
-        break;
-      }
+  // After the needle: ND1 rises on the needle the carriage is on
+  if (this->reference_period != 0 && state == Knitting &&
+      current_carriage_state.is_reference_needle(
+          this->previousCarriageState)) {
+    this->snap_to_reference_needle();
+    this->dispatch(EVENT_REFERENCE_NEEDLE, current_carriage_state, time_us);
+  }
 
-      bool start_of_needle = current_carriage_state.is_start_of_needle(
-          this->previousCarriageState);  // check if the carriage is at the
-                                         // start of the needle, always done
-                                         // to refresh the previous state
-      if (current_carriage_state.is_start_out_of_pattern(
-              this->previousCarriageState)) {
-        this->is_start_out_of_pattern = true;
-      }
+  // Update the previous carriage to be able to do states comparisons
+  this->previousCarriageState = current_carriage_state;
+}
 
-      // pattern
-      if (current_carriage_state.is_in_pattern_section() && start_of_needle) {
-        // DOB state must change only when the carriage is at the start of the
-        // needle
-        this->current_needle_index++;
-
-        bool needle_state = this->pattern.get_needle_state(
-            this->current_needle_index, current_carriage_state.get_direction());
-        this->carriage.set_DOB_state(needle_state);
-
-      } else if (this->is_start_out_of_pattern && start_of_needle) {
-        // carriage just moved out of pattern section
-        // WARNING: the carriage really finished to knit the pattern only when
-        // it is at the start of the needle after the KSL went from HIGH TO LOW
-        this->is_start_out_of_pattern = false;
-        this->current_needle_index = CARRIAGE_OFF_PATTERN;
-        // out of pattern section (KSL HIGH), the DOB must be low to avoid
-        // eating the solenoids.
-        this->carriage.set_DOB_state(LOW);
-        Ayab.sendReqLine(this->current_row);
+void KnittingProcess_::dispatch(KnittingEvent event) {
+  /**
+   * Run an event that is not a carriage change (host message, row installed).
+   */
+  this->dispatch(event, this->previousCarriageState, micros());
+}
+
+void KnittingProcess_::dispatch(KnittingEvent event,
+                                CarriageState carriage_state,
+                                unsigned long time_us) {
+  /**
+   * Move to the next phase of the transition table, then run the action of
+   * the transition. An action may dispatch further events (e.g. the next row
+   * installed at the end of a row), from the new phase.
+   */
+  KnittingTransition transition = KnittingFsm::transition(this->phase, event);
+  this->phase = transition.next;
+  this->run_action(transition.action, carriage_state, time_us);
+}
+
+void KnittingProcess_::run_action(KnittingAction action,
+                                  CarriageState carriage_state,
+                                  unsigned long time_us) {
+  CarriageDirection direction = carriage_state.get_direction();
+  switch (action) {
+    case ACTION_NONE:
+      break;
+    case ACTION_ANNOUNCE_CARRIAGE:
+      this->announce_carriage(direction);
+      break;
+    case ACTION_REQUEST_FIRST_ROW:
+      this->request_first_row();
+      break;
+    case ACTION_KNIT_NEEDLE:
+      this->knit_needle(direction, time_us);
+      break;
+    case ACTION_START_TURNAROUND:
+      this->is_turnaround_pending = true;
+      this->pattern_exit_time = time_us;
+      break;
+    case ACTION_END_ROW:
+      this->end_row(direction);
+      break;
+    case ACTION_RECORD_STALE_ROW:
+      // The carriage came back before the next row was installed: this pass
+      // is knitted with the previous row.
+      DEBUG_PRINTLN("Stale row: carriage entered pattern before next row");
+      this->turnaround_stats.record_stale_row();
+      break;
+    case ACTION_HOLD_DOB:
+      DEBUG_PRINTLN("Carriage edges lost, needles not selected in this row");
+      this->is_next_needle_scheduled = false;
+      this->carriage.set_DOB_state(LOW);
+      break;
+    case ACTION_SKIP_NEEDLE:
+      this->current_needle_index++;
+      break;
+    case ACTION_REWIND_NEEDLE:
+      this->rewind_needle(carriage_state);
+      break;
+    case ACTION_RESYNC_NEEDLE:
+      if (this->resync_needle(direction)) {
+        this->dispatch(EVENT_NEEDLE_RESYNCED, carriage_state, time_us);
       }
-    }
+      break;
     default:
       break;
   }
+}
 
-  // Update the previous carriage to be able to do states comparisons
-  this->previousCarriageState = current_carriage_state;
+void KnittingProcess_::request_first_row() {
+  /**
+   * Request the first row (or generate it in standalone mode), ahead of the
+   * carriage.
+   */
+  if (this->standalone) {
+    // No host involved, the first row is generated right away
+    this->install_standalone_line();
+    return;
+  }
+  DEBUG_PRINTLN("Requesting first row");
+  if (this->batched_lines) {
+    // The credits already ask for the first row: a reqLine on top of it would
+    // have the host send that row twice.
+    Ayab.sendIndLineCredits(this->expected_line,
+                            this->line_queue.free_slots());
+  } else {
+    Ayab.sendReqLine(this->expected_line);
+  }
+}
+
+void KnittingProcess_::knit_needle(CarriageDirection direction,
+                                   unsigned long time_us) {
+  /**
+   * Select the needle the carriage reached, and schedule the next one. DOB
+   * must change only when the carriage is at the start of the needle.
+   */
+  this->current_needle_index++;
+  if (this->is_next_needle_scheduled) {
+    // Already written by the timer, unless this edge came early
+    this->carriage.flush_DOB_state();
+  } else {
+    bool needle_state =
+        this->pattern.get_needle_state(this->current_needle_index, direction);
+    this->carriage.set_DOB_state(needle_state);
+  }
+  this->schedule_next_needle(direction, time_us);
+}
+
+void KnittingProcess_::end_row(CarriageDirection direction) {
+  /**
+   * The carriage left the pattern section: it really finished to knit the
+   * row only at the start of the needle after the KSL went from HIGH to LOW.
+   */
+  this->current_needle_index = CARRIAGE_OFF_PATTERN;
+  this->is_next_needle_scheduled = false;
+  // out of pattern section (KSL HIGH), the DOB must be low to avoid eating the
+  // solenoids.
+  this->carriage.set_DOB_state(LOW);
+  this->is_overspeed_reported = false;
+  this->check_row();
+  this->save_row_checkpoint();
+  // The next row is asked for first, the host answers while indState is sent.
+  // The last row resets the process, the flag is read before.
+  bool is_state_reported = this->continuous_reporting;
+  this->request_next_line();
+  if (is_state_reported) {
+    Ayab.sendIndState(direction);
+  }
+}
+
+void KnittingProcess_::rewind_needle(CarriageState carriage_state) {
+  /**
+   * The carriage turned inside the pattern section: count the needles from
+   * the other end of the row, so that the row goes on in the new direction
+   * from the needle the carriage is on.
+   *
+   * Turning on the first half of a needle (CCP HIGH), the next edge is the
+   * needle before it; on the second half (CCP LOW), the next edge is the same
+   * needle again.
+   */
+  DEBUG_PRINTLN("Carriage turned in the pattern section");
+  if (this->current_needle_index != CARRIAGE_OFF_PATTERN) {
+    int last_needle =
+        this->pattern.get_end_offset() - this->pattern.get_start_offset();
+    int index = last_needle - this->current_needle_index;
+    if (!carriage_state.CCP) {
+      index--;
+    }
+    this->current_needle_index =
+        index < CARRIAGE_OFF_PATTERN ? CARRIAGE_OFF_PATTERN : index;
+  }
+  this->is_turnaround_pending = false;
+
+  // The scheduled needle was the next one in the previous direction
+  this->is_next_needle_scheduled = false;
+  this->carriage.set_DOB_state(LOW);
+  this->speed_estimator.restart();
+  this->reversals++;
+}
+
+void KnittingProcess_::track_carriage_position(CarriageDirection direction) {
+  /**
+   * Absolute needle of the carriage after a needle edge: given by the needle
+   * count in the pattern section, counted on from there outside of it.
+   */
+  if (this->current_needle_index != CARRIAGE_OFF_PATTERN) {
+    this->carriage_position =
+        this->pattern.needle_index(this->current_needle_index, direction);
+    return;
+  }
+  if (this->carriage_position == CARRIAGE_POSITION_UNKNOWN) {
+    return;
+  }
+  if (direction == TO_RIGHT) {
+    if (this->carriage_position < DEFAULT_MAX_NEEDLES - 1) {
+      this->carriage_position++;
+    }
+  } else if (this->carriage_position > 0) {
+    this->carriage_position--;
+  }
+}
+
+void KnittingProcess_::snap_to_reference_needle() {
+  /**
+   * ND1 rose: move the carriage position to the nearest reference needle.
+   * A known position is needed to tell the reference needles apart.
+   */
+  if (this->carriage_position == CARRIAGE_POSITION_UNKNOWN) {
+    return;
+  }
+  int period = this->reference_period;
+  int periods =
+      (this->carriage_position - this->reference_offset + period / 2 + period) /
+          period -
+      1;
+  int reference = this->reference_offset + periods * period;
+  if (reference == this->carriage_position) {
+    return;
+  }
+  DEBUG_PRINTLN("Carriage position corrected on a reference needle");
+  this->carriage_position = reference;
+  if (this->position_corrections < UINT16_MAX) {
+    this->position_corrections++;
+  }
+}
+
+bool KnittingProcess_::resync_needle(CarriageDirection direction) {
+  /**
+   * Recompute the needle count of the row from the corrected carriage
+   * position, so that missed (or extra) edges do not shift the rest of the
+   * row. The current needle is written again, replacing a needle scheduled
+   * from the previous count.
+   *
+   * @return false if the position gives no needle of the row, the count is
+   * unchanged.
+   */
+  if (this->carriage_position == CARRIAGE_POSITION_UNKNOWN) {
+    return false;
+  }
+  int start = this->pattern.get_start_offset();
+  int end = this->pattern.get_end_offset();
+  int index = direction == TO_RIGHT ? this->carriage_position - start
+                                    : end - this->carriage_position;
+  if (index < 0 || index > end - start) {
+    return false;
+  }
+  this->current_needle_index = index;
+  this->is_next_needle_scheduled = false;
+  bool needle_state = this->pattern.get_needle_state(index, direction);
+  this->carriage.set_DOB_state(needle_state);
+  return true;
+}
+
+void KnittingProcess_::record_needle_level(CarriageDirection direction,
+                                           bool level) {
+  /**
+   * Keep the DOB level held when a CCP edge came (sampled with the edge), for
+   * the row check. It is the level of the needle written before the edge, or
+   * of the needle of the edge when the timer wrote it ahead. A write that
+   * came too late (loop behind, carriage faster than the schedule) leaves
+   * the level of the needle before it.
+   */
+  if (this->phase != PHASE_IN_PATTERN &&
+      this->phase != PHASE_LEAVING_PATTERN) {
+    return;
+  }
+  int index = this->current_needle_index;
+  if (this->is_next_needle_scheduled) {
+    index++;
+  }
+  if (index < 0 || index > this->end_needle - this->start_needle) {
+    return;
+  }
+  this->row_check.record(this->pattern.needle_index(index, direction), level);
+}
+
+void KnittingProcess_::save_checkpoint(uint8_t line) {
+  /**
+   * Keep the session in the checkpoint, to resume it from `line` after a
+   * reset. Standalone sessions do not need the host and are not kept.
+   */
+  if (this->standalone) {
+    return;
+  }
+  this->checkpoint.save(CheckpointRecord{this->start_needle, this->end_needle,
+                                         this->get_start_flags(), line});
+}
+
+void KnittingProcess_::save_row_checkpoint() {
+  /**
+   * Row boundary: the line is resumed from its first pass until its last
+   * pass (colour, row repeat) is knitted.
+   */
+  uint8_t line = this->current_row - 1;
+  if (this->row_repeat_count >= this->row_transform.get_row_repeat() &&
+      this->get_current_colour() + 1 >= this->colour_passes) {
+    line++;
+  }
+  this->save_checkpoint(line);
+}
+
+uint8_t KnittingProcess_::get_start_flags() const {
+  /**
+   * @return The reqStart flags of the session (standalone flag excepted).
+   */
+  uint8_t flags = (this->colour_passes - 1) << COLOUR_PASSES_SHIFT;
+  if (this->continuous_reporting) {
+    flags |= CONTINUOUS_REPORTING_FLAG;
+  }
+  if (this->beeper_enabled) {
+    flags |= BEEPER_ENABLED_FLAG;
+  }
+  if (this->batched_lines) {
+    flags |= BATCHED_LINES_FLAG;
+  }
+  if (this->row_check_report == ROW_CHECK_BITMAP) {
+    flags |= ROW_CHECK_BITMAP_FLAG;
+  } else if (this->row_check_report == ROW_CHECK_COUNT) {
+    flags |= ROW_CHECK_FLAG;
+  }
+  return flags;
+}
+
+bool KnittingProcess_::resume_from_line(uint8_t line) {
+  /**
+   * Resume a session started again from its checkpoint: the first line
+   * requested is `line` instead of 0. Only before the first row request.
+   *
+   * @return false if the session is standalone or already asked for a row.
+   */
+  if (this->phase != PHASE_STARTING || this->standalone) {
+    return false;
+  }
+  this->expected_line = line;
+  this->current_row = line;
+  this->save_checkpoint(line);
+  return true;
+}
+
+void KnittingProcess_::check_row() {
+  /**
+   * Compare the needles selected in the row that just ended with the row,
+   * before the next one is installed, and report it if the host asked.
+   */
+  if (!this->pattern.is_buffer_set()) {
+    return;
+  }
+  uint16_t mismatches = this->row_check.check_row(
+      this->pattern.get_buffer(), this->pattern.is_buffer_in_flash(),
+      this->start_needle, this->end_needle);
+  if (mismatches != 0) {
+    DEBUG_PRINTLN("Row check: needles selected differ from the row");
+  }
+  if (this->row_check_report != ROW_CHECK_OFF) {
+    const uint8_t* observed = this->row_check_report == ROW_CHECK_BITMAP
+                                  ? this->row_check.get_observed()
+                                  : nullptr;
+    Ayab.sendIndRowCheck(this->current_row - 1, mismatches, observed);
+  }
+  this->row_check.start_row();
 }
@@ -1,46 +1,196 @@
 #ifndef KNITTING_H_
 #define KNITTING_H_
+#include "knitting_fsm.h"
+#include "line_queue.h"
 #include "machine/carriage.h"
+#include "machine/carriage_sampler.h"
+#include "machine/speed_estimator.h"
+#include "motif.h"
+#include "motif_store.h"
 #include "pattern.h"
-
-enum KnittingState { Idle, WaitingStart, Knitting };
+#include "row_check.h"
+#include "row_transform.h"
+#include "session_checkpoint.h"
+#include "turnaround_stats.h"
 
 class KnittingProcess_ {
  private:
-  KnittingProcess_() = default;
-  int current_row;
-  int current_stitch;
-  KnittingState knitting_state;
+  int current_row = 0;
+  int current_stitch = 0;
+  KnittingPhase phase = PHASE_IDLE;
   Carriage carriage;
   Pattern pattern;
   CarriageState previousCarriageState = CarriageState();
 
-  int current_needle_index;
-  uint8_t start_needle;
-  uint8_t end_needle;
-  bool is_last_line;
-  bool is_start_out_of_pattern;
+  int current_needle_index = CARRIAGE_OFF_PATTERN;
+  uint8_t start_needle = 0;
+  uint8_t end_needle = 0;
+  bool is_last_line = false;
+  bool continuous_reporting = false;
+  bool beeper_enabled = false;
 
-  void start_knitting_if_carriage_moves(CarriageState carriage_state);
+  // Scheduled DOB output: the state of the next needle is written by a timer
+  // `dob_phase_advance` / 256 of a CCP period before its expected edge
+  bool dob_scheduling = false;
+  uint8_t dob_phase_advance = 0;
+  bool is_next_needle_scheduled = false;
 
- public:
-  static KnittingProcess_& getInstance();
+  // Carriage events dropped because the event queue was full
+  uint16_t lost_carriage_events = 0;
+  // Longest time between a carriage edge and its processing
+  unsigned long max_edge_latency_us = 0;
+
+  // Carriage turned inside the pattern section
+  uint16_t reversals = 0;
+
+  // Absolute needle of the carriage, moved to the ND1 reference needles
+  int carriage_position = CARRIAGE_POSITION_UNKNOWN;
+  uint16_t position_corrections = 0;
+  uint8_t reference_period = ND1_REFERENCE_PERIOD;  // 0: ND1 ignored
+  uint8_t reference_offset = ND1_REFERENCE_OFFSET;
+
+  // DOB level held at each needle, checked against the row at its end
+  RowCheck row_check;
+  RowCheckReport row_check_report = ROW_CHECK_OFF;
+
+  // Carriage speed, from the CCP period
+  SpeedEstimator speed_estimator;
+  bool is_overspeed_reported = false;  // Reported once per row
+
+  // Batched line transfer (rows pushed ahead by the host)
+  LineQueue line_queue;
+  bool batched_lines = false;
+  bool is_waiting_line = true;
+  uint8_t expected_line = 0;  // Next line the host has to send
 
+  // Multi-colour knitting: each row is knitted in colour_passes passes, sent
+  // together by the host and queued in the line queue
+  uint8_t colour_passes = 1;
+  uint8_t expected_colour = 0;  // Pass of expected_line the host has to send
+  bool is_last_pass = false;    // The installed pass ends the session
+
+  // Standalone knitting (rows generated from the motif or read from a
+  // pattern baked in flash, no host needed)
+  Motif motif;
+  bool standalone = false;
+  uint16_t standalone_row = 0;
+  const uint8_t* flash_rows = nullptr;  // nullptr when knitting the motif
+  uint16_t flash_row_count = 0;
+  uint8_t motif_line[MAX_LINE_BUFFER_LEN] = {};
+  EepromStorage eeprom;
+  MotifStore motif_store{eeprom, MOTIF_STORE_ADDRESS, MOTIF_STORE_RECORDS};
+
+  // Progress of the session, to resume it after a reset
+  SessionCheckpoint checkpoint{eeprom, CHECKPOINT_ADDRESS, CHECKPOINT_RECORDS};
+
+  // Per-session transform of the installed rows
+  RowTransform row_transform;
+  uint8_t transformed_line[MAX_LINE_BUFFER_LEN] = {};
+  uint8_t row_repeat_count = 1;  // Passes knitted with the current row
+
+  // Row turnaround measurement (pattern section exit to next row installed)
+  TurnaroundStats turnaround_stats;
+  bool is_turnaround_pending = false;
+  unsigned long pattern_exit_time = 0;
+
+  void dispatch(KnittingEvent event);
+  void dispatch(KnittingEvent event, CarriageState carriage_state,
+                unsigned long time_us);
+  void run_action(KnittingAction action, CarriageState carriage_state,
+                  unsigned long time_us);
+  void announce_carriage(CarriageDirection direction);
+  void request_first_row();
+  void knit_needle(CarriageDirection direction, unsigned long time_us);
+  void end_row(CarriageDirection direction);
+  void rewind_needle(CarriageState carriage_state);
+  void track_carriage_position(CarriageDirection direction);
+  void snap_to_reference_needle();
+  bool resync_needle(CarriageDirection direction);
+  void record_needle_level(CarriageDirection direction, bool level);
+  void check_row();
+  void save_checkpoint(uint8_t line);
+  void save_row_checkpoint();
+  void install_queued_line();
+  void install_standalone_line();
+  void install_motif_line();
+  void install_flash_line();
+  void request_next_line();
+  void check_overspeed();
+  void schedule_next_needle(CarriageDirection direction,
+                            unsigned long edge_time);
+  void process_carriage_state(CarriageState current_carriage_state,
+                              unsigned long time_us);
+
+ public:
+  // The only instance is KnittingProcess, set up by reset(). Constant-
+  // initialised: no constructor code runs before main().
+  constexpr KnittingProcess_() = default;
   KnittingProcess_(const KnittingProcess_&) = delete;
   KnittingProcess_& operator=(const KnittingProcess_&) = delete;
 
   void knitting_loop();
+  bool service_carriage_events();
+  void housekeeping();
+  bool is_row_request_due() const;
+  void request_rows();
   void reset();
   bool init();
   bool start_knitting(uint8_t start_needle, uint8_t end_needle,
-                      bool continuousReportingEnabled, bool beeperEnabled);
-  void set_next_line(uint8_t line_number, bool last_line_flag, uint8_t* line);
+                      bool continuousReportingEnabled, bool beeperEnabled,
+                      bool batched_lines = false, bool standalone = false,
+                      uint8_t colour_passes = 1,
+                      RowCheckReport row_check_report = ROW_CHECK_OFF);
+  bool start_flash_pattern(const uint8_t* rows, uint16_t row_count,
+                           uint8_t start_needle, uint8_t end_needle);
+  void set_next_line(uint8_t line_number, bool last_line_flag,
+                     const uint8_t* line, bool line_in_flash = false);
+  bool queue_line(uint8_t line_number, bool last_line_flag,
+                  const uint8_t* line, uint8_t colour = 0);
+  bool is_batched() const { return batched_lines; }
+  bool uses_line_queue() const { return batched_lines || colour_passes > 1; }
+  bool is_standalone() const { return standalone; }
+  Motif& get_motif() { return motif; }
+  RowTransform& get_row_transform() { return row_transform; }
+  bool configure_dob_timing(bool scheduling, uint8_t phase_advance);
+  bool configure_signal_filter(SampledSignal signal, uint8_t mode,
+                               uint8_t depth);
+  bool configure_reference_needles(uint8_t period, uint8_t offset);
+  bool is_dob_scheduling() const { return dob_scheduling; }
+  uint8_t get_dob_phase_advance() const { return dob_phase_advance; }
+  bool resume_from_line(uint8_t line);
+  bool load_checkpoint(CheckpointRecord& record) {
+    return checkpoint.load(record);
+  }
+  bool is_checkpoint_pending() const { return checkpoint.is_pending(); }
+  uint8_t get_start_flags() const;
+  bool save_motif(uint8_t slot);
+  bool load_motif(uint8_t slot);
+  uint8_t get_line_credits() const { return line_queue.free_slots(); }
+  uint8_t get_expected_line() const { return expected_line; }
+  uint8_t get_expected_colour() const { return expected_colour; }
+  uint8_t get_colour_passes() const { return colour_passes; }
+  uint8_t get_current_colour();
+  const SpeedEstimator& get_speed_estimator() const {
+    return speed_estimator;
+  }
+  bool has_overspeed_warning() const { return is_overspeed_reported; }
+  uint16_t get_lost_carriage_events() const { return lost_carriage_events; }
+  unsigned long get_max_edge_latency_us() const { return max_edge_latency_us; }
+  uint16_t get_reversals() const { return reversals; }
+  int get_carriage_position() const { return carriage_position; }
+  uint16_t get_position_corrections() const { return position_corrections; }
+  uint8_t get_reference_period() const { return reference_period; }
+  const RowCheck& get_row_check() const { return row_check; }
+  const TurnaroundStats& get_turnaround_stats() const {
+    return turnaround_stats;
+  }
   int get_current_needle_index() const { return current_needle_index; }
   const Pattern& get_pattern() const { return pattern; }
   uint8_t get_start_needle() const { return start_needle; }
   uint8_t get_end_needle() const { return end_needle; }
-  KnittingState get_knitting_state() const { return knitting_state; }
+  KnittingState get_knitting_state() const { return knitting_state_of(phase); }
+  KnittingPhase get_phase() const { return phase; }
 };
 
-extern KnittingProcess_& KnittingProcess;
+extern KnittingProcess_ KnittingProcess;
 #endif
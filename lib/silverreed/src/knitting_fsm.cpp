@@ -0,0 +1,88 @@
+#include "knitting_fsm.h"
+
+#include <Arduino.h>
+
+namespace {
+struct KnittingRule {
+  uint8_t phase;   // KnittingPhase
+  uint8_t event;   // KnittingEvent
+  uint8_t next;    // KnittingPhase
+  uint8_t action;  // KnittingAction
+};
+
+// clang-format off
+constexpr KnittingRule KNITTING_RULES[] PROGMEM = {
+  {PHASE_IDLE,            EVENT_INIT,              PHASE_WAITING_START,   ACTION_NONE},
+
+  {PHASE_WAITING_START,   EVENT_START,             PHASE_STARTING,        ACTION_NONE},
+  {PHASE_WAITING_START,   EVENT_NEEDLE_IN_PATTERN, PHASE_WAITING_START,   ACTION_ANNOUNCE_CARRIAGE},
+  {PHASE_WAITING_START,   EVENT_NEEDLE_OUTSIDE,    PHASE_WAITING_START,   ACTION_ANNOUNCE_CARRIAGE},
+
+  // Deferred to the first step: cnfStart is sent before the first reqLine
+  {PHASE_STARTING,        EVENT_STEP,              PHASE_PREFETCH,        ACTION_REQUEST_FIRST_ROW},
+  {PHASE_STARTING,        EVENT_ROW_INSTALLED,     PHASE_ROW_READY,       ACTION_NONE},
+
+  // Needles before the first row use an empty row
+  {PHASE_PREFETCH,        EVENT_ROW_INSTALLED,     PHASE_ROW_READY,       ACTION_NONE},
+  {PHASE_PREFETCH,        EVENT_ENTER_PATTERN,     PHASE_IN_PATTERN,      ACTION_NONE},
+  {PHASE_PREFETCH,        EVENT_NEEDLE_IN_PATTERN, PHASE_IN_PATTERN,      ACTION_KNIT_NEEDLE},
+  {PHASE_PREFETCH,        EVENT_LEAVE_PATTERN,     PHASE_LEAVING_PATTERN, ACTION_START_TURNAROUND},
+
+  {PHASE_ROW_READY,       EVENT_ENTER_PATTERN,     PHASE_IN_PATTERN,      ACTION_NONE},
+  {PHASE_ROW_READY,       EVENT_NEEDLE_IN_PATTERN, PHASE_IN_PATTERN,      ACTION_KNIT_NEEDLE},
+  {PHASE_ROW_READY,       EVENT_LEAVE_PATTERN,     PHASE_LEAVING_PATTERN, ACTION_START_TURNAROUND},
+
+  // Hot path, also run directly by KnittingProcess_::knit_needle()
+  {PHASE_IN_PATTERN,      EVENT_NEEDLE_IN_PATTERN, PHASE_IN_PATTERN,      ACTION_KNIT_NEEDLE},
+  {PHASE_IN_PATTERN,      EVENT_LEAVE_PATTERN,     PHASE_LEAVING_PATTERN, ACTION_START_TURNAROUND},
+  {PHASE_IN_PATTERN,      EVENT_EVENTS_LOST,       PHASE_ERROR,           ACTION_HOLD_DOB},
+  {PHASE_IN_PATTERN,      EVENT_REVERSE,           PHASE_IN_PATTERN,      ACTION_REWIND_NEEDLE},
+  {PHASE_IN_PATTERN,      EVENT_REFERENCE_NEEDLE,  PHASE_IN_PATTERN,      ACTION_RESYNC_NEEDLE},
+  // Turned at the cam edge after KSL fell, then out again: the row ends
+  {PHASE_IN_PATTERN,      EVENT_NEEDLE_OUTSIDE,    PHASE_TURNAROUND,      ACTION_END_ROW},
+
+  // The carriage really left the pattern on the needle after KSL fell
+  {PHASE_LEAVING_PATTERN, EVENT_NEEDLE_OUTSIDE,    PHASE_TURNAROUND,      ACTION_END_ROW},
+  {PHASE_LEAVING_PATTERN, EVENT_ENTER_PATTERN,     PHASE_IN_PATTERN,      ACTION_RECORD_STALE_ROW},
+  {PHASE_LEAVING_PATTERN, EVENT_NEEDLE_IN_PATTERN, PHASE_IN_PATTERN,      ACTION_KNIT_NEEDLE},
+  // Turned before the needle ending the row: the row goes on
+  {PHASE_LEAVING_PATTERN, EVENT_REVERSE,           PHASE_IN_PATTERN,      ACTION_REWIND_NEEDLE},
+
+  // Back in the pattern before the next row: knitted with the previous row
+  {PHASE_TURNAROUND,      EVENT_ROW_INSTALLED,     PHASE_ROW_READY,       ACTION_NONE},
+  {PHASE_TURNAROUND,      EVENT_ENTER_PATTERN,     PHASE_IN_PATTERN,      ACTION_RECORD_STALE_ROW},
+  {PHASE_TURNAROUND,      EVENT_NEEDLE_IN_PATTERN, PHASE_IN_PATTERN,      ACTION_KNIT_NEEDLE},
+
+  // The needle index is off by the lost edges until the end of the row
+  {PHASE_ERROR,           EVENT_NEEDLE_IN_PATTERN, PHASE_ERROR,           ACTION_SKIP_NEEDLE},
+  {PHASE_ERROR,           EVENT_LEAVE_PATTERN,     PHASE_LEAVING_PATTERN, ACTION_START_TURNAROUND},
+  // Unless a reference needle gives the needle of the row back
+  {PHASE_ERROR,           EVENT_REFERENCE_NEEDLE,  PHASE_ERROR,           ACTION_RESYNC_NEEDLE},
+  {PHASE_ERROR,           EVENT_NEEDLE_RESYNCED,   PHASE_IN_PATTERN,      ACTION_NONE},
+};
+// clang-format on
+
+constexpr uint8_t KNITTING_RULE_COUNT =
+    sizeof(KNITTING_RULES) / sizeof(KNITTING_RULES[0]);
+}  // namespace
+
+KnittingTransition KnittingFsm::transition(KnittingPhase phase,
+                                           KnittingEvent event) {
+  /**
+   * Look up the rule of an event in a phase. Not used for the needles in the
+   * pattern, see KnittingProcess_::process_carriage_state().
+   *
+   * @return The next phase and the action to run, the same phase and
+   * ACTION_NONE when the event is ignored in this phase.
+   */
+  for (uint8_t i = 0; i < KNITTING_RULE_COUNT; i++) {
+    const KnittingRule* rule = &KNITTING_RULES[i];
+    if (pgm_read_byte(&rule->phase) == phase &&
+        pgm_read_byte(&rule->event) == event) {
+      return KnittingTransition{
+          static_cast<KnittingPhase>(pgm_read_byte(&rule->next)),
+          static_cast<KnittingAction>(pgm_read_byte(&rule->action))};
+    }
+  }
+  return KnittingTransition{phase, ACTION_NONE};
+}
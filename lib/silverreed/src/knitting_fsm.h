@@ -0,0 +1,79 @@
+/**
+ * @file knitting_fsm.h
+ * @brief Phases, events and transition table of the knitting process.
+ */
+#ifndef KNITTING_FSM_H_
+#define KNITTING_FSM_H_
+
+#include <stdint.h>
+
+enum KnittingState { Idle, WaitingStart, Knitting };
+
+// Phases of the knitting process, each within one KnittingState
+enum KnittingPhase : uint8_t {
+  PHASE_IDLE,             // Idle
+  PHASE_WAITING_START,    // WaitingStart: reqInit received
+  PHASE_STARTING,         // Knitting: first row not requested yet
+  PHASE_PREFETCH,         // First row requested ahead of the carriage
+  PHASE_ROW_READY,        // Row installed, carriage outside the pattern
+  PHASE_IN_PATTERN,       // Selecting the needles of the row
+  PHASE_LEAVING_PATTERN,  // KSL fell, the row ends on the next needle
+  PHASE_TURNAROUND,       // Row finished, next row not installed yet
+  PHASE_ERROR,            // Edges lost in the row, needles not selected
+  PHASE_COUNT
+};
+
+enum KnittingEvent : uint8_t {
+  EVENT_INIT,               // reqInit
+  EVENT_START,              // reqStart accepted
+  EVENT_STEP,               // Each run of the state machine, in STARTING
+  EVENT_ENTER_PATTERN,      // KSL rose
+  EVENT_LEAVE_PATTERN,      // KSL fell
+  EVENT_REVERSE,            // HOK changed
+  EVENT_REFERENCE_NEEDLE,   // ND1 rose
+  EVENT_NEEDLE_RESYNCED,    // Needle count recomputed from ND1
+  EVENT_NEEDLE_IN_PATTERN,  // CCP rose, KSL HIGH
+  EVENT_NEEDLE_OUTSIDE,     // CCP rose, KSL LOW
+  EVENT_ROW_INSTALLED,      // Row received, generated or repeated
+  EVENT_EVENTS_LOST,        // Carriage event queue overflow
+  EVENT_COUNT
+};
+
+enum KnittingAction : uint8_t {
+  ACTION_NONE,
+  ACTION_ANNOUNCE_CARRIAGE,  // indState, solenoid power
+  ACTION_REQUEST_FIRST_ROW,
+  ACTION_KNIT_NEEDLE,
+  ACTION_START_TURNAROUND,
+  ACTION_END_ROW,  // DOB LOW, indState, next row
+  ACTION_RECORD_STALE_ROW,
+  ACTION_HOLD_DOB,
+  ACTION_SKIP_NEEDLE,
+  ACTION_REWIND_NEEDLE,  // Count the needles from the other end
+  ACTION_RESYNC_NEEDLE,  // Needle count from the reference needle
+  ACTION_COUNT
+};
+
+struct KnittingTransition {
+  KnittingPhase next;
+  KnittingAction action;
+};
+
+constexpr KnittingState knitting_state_of(KnittingPhase phase) {
+  return phase == PHASE_IDLE            ? Idle
+         : phase == PHASE_WAITING_START ? WaitingStart
+                                        : Knitting;
+}
+
+/**
+ * Transition table of the knitting process over (phase, event), in program
+ * memory. Events without a rule in a phase are ignored: the phase is kept and
+ * nothing is done.
+ */
+class KnittingFsm {
+ public:
+  static KnittingTransition transition(KnittingPhase phase,
+                                       KnittingEvent event);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "line_queue.h"
+
+#include <string.h>
+
+void LineQueue::clear() {
+  /**
+   * Drop every queued row, including the one being knitted.
+   */
+  this->head = 0;
+  this->count = 0;
+}
+
+bool LineQueue::push(uint8_t line_number, bool last_line,
+                     const uint8_t* data, uint8_t colour) {
+  /**
+   * Copy a row at the end of the queue.
+   *
+   * @param line_number The number of the line.
+   * @param last_line If the line is the last line of the pattern.
+   * @param data MAX_LINE_BUFFER_LEN bytes of needle states.
+   * @param colour The pass index of the line within its row.
+   * @return false if no slot is free (the host exceeded its credits).
+   */
+  if (this->is_full()) {
+    return false;
+  }
+
+  uint8_t tail = (this->head + this->count) % LINE_QUEUE_SLOTS;
+  QueuedLine& slot = this->slots[tail];
+  slot.line_number = line_number;
+  slot.colour = colour;
+  slot.last_line = last_line;
+  memcpy(slot.data, data, MAX_LINE_BUFFER_LEN);
+  this->count++;
+  return true;
+}
+
+void LineQueue::pop() {
+  /**
+   * Release the oldest row.
+   */
+  if (this->is_empty()) {
+    return;
+  }
+  this->head = (this->head + 1) % LINE_QUEUE_SLOTS;
+  this->count--;
+}
+
+QueuedLine* LineQueue::front() {
+  /**
+   * @return The oldest row, or nullptr if the queue is empty.
+   */
+  if (this->is_empty()) {
+    return nullptr;
+  }
+  return &this->slots[this->head];
+}
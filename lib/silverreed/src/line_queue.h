@@ -0,0 +1,49 @@
+/**
+ * @file line_queue.h
+ * @brief Fixed-size ring of pattern rows received ahead of the carriage.
+ */
+#ifndef LINE_QUEUE_H_
+#define LINE_QUEUE_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * A row as received from the host, already inverted to needle states.
+ */
+struct QueuedLine {
+  uint8_t line_number;
+  uint8_t colour;  // Pass index within the row (multi-colour knitting)
+  bool last_line;
+  uint8_t data[MAX_LINE_BUFFER_LEN];
+};
+
+/**
+ * Ring buffer of rows used by the batched line transfer.
+ *
+ * The oldest slot holds the row currently being knitted: the Pattern keeps a
+ * pointer into it, so it is only released by pop() once the carriage left
+ * the pattern section. The remaining slots are the credits advertised to the
+ * host.
+ */
+class LineQueue {
+ private:
+  QueuedLine slots[LINE_QUEUE_SLOTS];
+  uint8_t head;
+  uint8_t count;
+
+ public:
+  constexpr LineQueue() : slots{}, head(0), count(0) {}
+  void clear();
+  bool push(uint8_t line_number, bool last_line, const uint8_t* data,
+            uint8_t colour = 0);
+  void pop();
+  QueuedLine* front();
+  uint8_t size() const { return count; }
+  uint8_t free_slots() const { return LINE_QUEUE_SLOTS - count; }
+  bool is_empty() const { return count == 0; }
+  bool is_full() const { return count == LINE_QUEUE_SLOTS; }
+};
+
+#endif
@@ -2,24 +2,7 @@
 
 #include "Arduino.h"
 #include "config.h"
-
-CarriageState::CarriageState()
-    : CCP(false), KSL(false), DOB(false), HOK(false) {
-  /*
-   * Default constructor - initializes all pins to LOW/false.
-   * This is useful for testing and creating initial previous state snapshots
-   * without hardware access.
-   */
-}
-
-CarriageState::CarriageState(bool ccp, bool ksl, bool dob, bool hok)
-    : CCP(ccp), KSL(ksl), DOB(dob), HOK(hok) {
-  /*
-   * Explicit constructor with pin values.
-   * Use this when you have already read the pin values and want to
-   * construct a state object without re-reading from hardware.
-   */
-}
+#include "dob_scheduler.h"
 
 CarriageState CarriageState::read_from_pins() {
   /*
@@ -33,8 +16,9 @@ CarriageState CarriageState::read_from_pins() {
   bool ksl = digitalRead(PinsCorrespondance::KSL);
   bool dob = digitalRead(PinsCorrespondance::DOB);
   bool hok = digitalRead(PinsCorrespondance::HOK);
+  bool nd1 = digitalRead(PinsCorrespondance::ND1);
 
-  return CarriageState(ccp, ksl, dob, hok);
+  return CarriageState(ccp, ksl, dob, hok, nd1);
 }
 
 CarriageDirection CarriageState::get_direction() {
@@ -70,6 +54,26 @@ bool CarriageState::is_carriage_moving(CarriageState previous_state) {
   return previous_state.CCP != this->CCP;
 }
 
+bool CarriageState::is_direction_change(CarriageState previous_state) {
+  /*
+   * The carriage turned if the HOK pin changed values from the previous
+   * state.
+   *
+   * @param True if the direction of the carriage changed.
+   */
+  return previous_state.HOK != this->HOK;
+}
+
+bool CarriageState::is_reference_needle(CarriageState previous_state) {
+  /*
+   * The carriage is on a reference needle of the bed if the ND1 pin changed
+   * values from the previous state (from Low to High).
+   *
+   * @param True if the carriage reached a reference needle.
+   */
+  return this->ND1 == HIGH && previous_state.ND1 == LOW;
+}
+
 bool CarriageState::is_start_out_of_pattern(CarriageState previous_state) {
   /*
    * The carriage is out of the pattern section if the KSL pin changed values
@@ -80,6 +84,16 @@ bool CarriageState::is_start_out_of_pattern(CarriageState previous_state) {
   return this->KSL == LOW && previous_state.KSL == HIGH;
 }
 
+bool CarriageState::is_start_in_pattern(CarriageState previous_state) {
+  /*
+   * The carriage enters the pattern section if the KSL pin changed values
+   * from the previous state (from Low to High).
+   *
+   * @param True if the carriage just entered the pattern section.
+   */
+  return this->KSL == HIGH && previous_state.KSL == LOW;
+}
+
 bool CarriageState::is_start_of_needle(CarriageState previous_state) {
   /*
    * The carriage is at the start of the needle if the CCP pin changed values
@@ -90,22 +104,48 @@ bool CarriageState::is_start_of_needle(CarriageState previous_state) {
   return this->CCP == HIGH && previous_state.CCP == LOW;
 }
 
-Carriage::Carriage() {
+void Carriage::reset() {
+  /*
+   * Back to the power-up state, the solenoids off. Done from
+   * KnittingProcess.reset(), not by the constructor: the carriage is part of
+   * a global object, built before the Arduino core sets the hardware up.
+   */
   // Force initial solenoid state to LOW for safety
+  this->power_solenoid_state = LOW;
   digitalWrite(PinsCorrespondance::SOLENOID_POWER, LOW);
+  DobScheduler::cancel();
+  this->DOB_state = LOW;
+  this->solenoid_change_time = 0;
   this->last_carriage_movement_time = millis();
 }
 
 void Carriage::set_DOB_state(int state) {
   /*
-   * Set the state of the DOB pin.
+   * Set the state of the DOB pin, replacing any scheduled change.
    */
-  if (this->DOB_state == state) return;
+  bool was_scheduled = DobScheduler::cancel();
+  if (this->DOB_state == state && !was_scheduled) return;
 
   this->DOB_state = state;
   digitalWrite(PinsCorrespondance::DOB, state);
 }
 
+void Carriage::schedule_DOB_state(int state, unsigned long delay_us) {
+  /*
+   * Set the state of the DOB pin `delay_us` from now, using a hardware timer
+   * so that the loop timing does not matter.
+   */
+  this->DOB_state = state;
+  DobScheduler::schedule(state, delay_us);
+}
+
+void Carriage::flush_DOB_state() {
+  /*
+   * Apply the scheduled DOB state now if it is late.
+   */
+  DobScheduler::flush();
+}
+
 bool Carriage::is_solenoid_powered() const {
   return this->power_solenoid_state == HIGH;
 }
@@ -145,3 +185,10 @@ void Carriage::check_and_shutoff_if_inactive() {
     this->power_solenoid(LOW);
   }
 }
+
+void Carriage::beep(unsigned long duration_ms) {
+  /*
+   * Sound the buzzer, without blocking (the tone stops by itself).
+   */
+  tone(PinsCorrespondance::BEEPER, BEEP_FREQUENCY_HZ, duration_ms);
+}
@@ -11,14 +11,18 @@ class CarriageState {
   bool KSL;
   bool DOB;
   bool HOK;
+  bool ND1;
 
   // Default constructor - initializes all pins to LOW
   // Useful for testing and creating previous state snapshots
-  CarriageState();
+  constexpr CarriageState()
+      : CCP(false), KSL(false), DOB(false), HOK(false), ND1(false) {}
 
   // Explicit constructor with pin values
   // Use this when you have already read the pin values
-  CarriageState(bool ccp, bool ksl, bool dob, bool hok);
+  constexpr CarriageState(bool ccp, bool ksl, bool dob, bool hok,
+                          bool nd1 = false)
+      : CCP(ccp), KSL(ksl), DOB(dob), HOK(hok), ND1(nd1) {}
 
   // Static factory method to read current state from hardware pins
   // This is the preferred method for production code
@@ -26,7 +30,10 @@ class CarriageState {
 
   bool is_in_pattern_section();
   bool is_start_out_of_pattern(CarriageState previous_state);
+  bool is_start_in_pattern(CarriageState previous_state);
   bool is_carriage_moving(CarriageState previous_state);
+  bool is_direction_change(CarriageState previous_state);
+  bool is_reference_needle(CarriageState previous_state);
   CarriageDirection get_direction();
   bool is_start_of_needle(CarriageState previous_state);
 };
@@ -35,19 +42,24 @@ class Carriage {
  private:
   int DOB_state = LOW;
   int power_solenoid_state = LOW;
-  unsigned long solenoid_change_time;
-  unsigned long last_carriage_movement_time;
+  unsigned long solenoid_change_time = 0;
+  unsigned long last_carriage_movement_time = 0;
 
  public:
-  Carriage();
+  // No hardware access, see reset()
+  constexpr Carriage() = default;
 
+  void reset();
   void set_DOB_state(int state);
+  void schedule_DOB_state(int state, unsigned long delay_us);
+  void flush_DOB_state();
 
   bool is_solenoid_powered() const;
   bool is_end_of_pattern_section();
   void power_solenoid(int state);
   void update_last_movement();
   void check_and_shutoff_if_inactive();
+  void beep(unsigned long duration_ms);
 };
 
 #endif
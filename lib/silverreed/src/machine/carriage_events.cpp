@@ -0,0 +1,159 @@
+#include "carriage_events.h"
+
+#include <Arduino.h>
+
+#include "carriage_sampler.h"
+#include "config.h"
+#include "idle_sleep.h"
+#include "spsc_queue.h"
+
+namespace {
+SpscQueue<CarriageEvent, CARRIAGE_EVENT_QUEUE_SLOTS> events;
+uint8_t last_signals = 0;  // Producer only
+bool started = false;
+
+#if defined(__AVR__)
+// Bits of CCP, KSL, HOK and ND1 in PIND, digitalRead is too slow for the ISR
+uint8_t ccp_mask;
+uint8_t ksl_mask;
+uint8_t hok_mask;
+uint8_t nd1_mask;
+uint8_t dob_mask;
+#endif
+
+void queue_initial_state() {
+  // Before the producer starts: the state machine needs the levels even if
+  // nothing moves
+  last_signals = CarriageEvents::signals_of(CarriageSampler::read());
+  events.push(CarriageEvent{micros(), last_signals});
+}
+}  // namespace
+
+CarriageState CarriageEvent::to_state() const {
+  /**
+   * @return The carriage state after the event, with the DOB level held
+   * when it happened.
+   */
+  return CarriageState((this->signals & CARRIAGE_SIGNAL_CCP) != 0,
+                       (this->signals & CARRIAGE_SIGNAL_KSL) != 0,
+                       (this->signals & CARRIAGE_SIGNAL_DOB) != 0,
+                       (this->signals & CARRIAGE_SIGNAL_HOK) != 0,
+                       (this->signals & CARRIAGE_SIGNAL_ND1) != 0);
+}
+
+#if defined(__AVR__)
+
+ISR(PCINT2_vect) {
+  IdleSleep::note_wake();
+  // Filtered events come from the sampler interrupt instead
+  if (CarriageSampler::is_enabled()) {
+    return;
+  }
+  uint8_t pins = PIND;
+  uint8_t signals = 0;
+  if (pins & ccp_mask) signals |= CARRIAGE_SIGNAL_CCP;
+  if (pins & ksl_mask) signals |= CARRIAGE_SIGNAL_KSL;
+  if (pins & hok_mask) signals |= CARRIAGE_SIGNAL_HOK;
+  if (pins & nd1_mask) signals |= CARRIAGE_SIGNAL_ND1;
+  if (pins & dob_mask) signals |= CARRIAGE_SIGNAL_DOB;
+  CarriageEvents::record(signals);
+}
+
+bool CarriageEvents::is_interrupt_driven() { return true; }
+
+void CarriageEvents::begin() {
+  /**
+   * Queue the current state of the pins and enable the pin change interrupt
+   * of CCP, KSL, HOK and ND1 (all on port D), once.
+   */
+  if (started) {
+    return;
+  }
+  started = true;
+  ccp_mask = digitalPinToBitMask(PinsCorrespondance::CCP);
+  ksl_mask = digitalPinToBitMask(PinsCorrespondance::KSL);
+  hok_mask = digitalPinToBitMask(PinsCorrespondance::HOK);
+  nd1_mask = digitalPinToBitMask(PinsCorrespondance::ND1);
+  dob_mask = digitalPinToBitMask(PinsCorrespondance::DOB);
+  queue_initial_state();
+  *digitalPinToPCMSK(PinsCorrespondance::CCP) |=
+      _BV(digitalPinToPCMSKbit(PinsCorrespondance::CCP));
+  *digitalPinToPCMSK(PinsCorrespondance::KSL) |=
+      _BV(digitalPinToPCMSKbit(PinsCorrespondance::KSL));
+  *digitalPinToPCMSK(PinsCorrespondance::HOK) |=
+      _BV(digitalPinToPCMSKbit(PinsCorrespondance::HOK));
+  *digitalPinToPCMSK(PinsCorrespondance::ND1) |=
+      _BV(digitalPinToPCMSKbit(PinsCorrespondance::ND1));
+  PCIFR = _BV(PCIF2);
+  PCICR |= _BV(PCIE2);
+}
+
+void CarriageEvents::poll() {}
+
+#else
+
+bool CarriageEvents::is_interrupt_driven() { return false; }
+
+void CarriageEvents::begin() {
+  if (started) {
+    return;
+  }
+  started = true;
+  queue_initial_state();
+}
+
+void CarriageEvents::poll() {
+  /**
+   * No pin interrupt to use: queue the pins if they changed since the
+   * previous call.
+   */
+  record(signals_of(CarriageSampler::read()));
+}
+
+#endif
+
+void CarriageEvents::record(uint8_t signals) {
+  /**
+   * Producer side: queue an event if the signals changed (DOB excepted).
+   * Called from the interrupts on AVR.
+   */
+  if (((signals ^ last_signals) & ~CARRIAGE_SIGNAL_DOB) == 0) {
+    return;
+  }
+  last_signals = signals;
+  events.push(CarriageEvent{micros(), signals});
+}
+
+bool CarriageEvents::pop(CarriageEvent& event) {
+  /**
+   * Consumer side: take the oldest event.
+   *
+   * @return false when every event was processed.
+   */
+  return events.pop(event);
+}
+
+bool CarriageEvents::is_pending() {
+  /**
+   * @return true if events are waiting to be processed (polling the pins
+   * first on boards without the pin change interrupt).
+   */
+  poll();
+  return !events.is_empty();
+}
+
+uint8_t CarriageEvents::take_lost_events() {
+  /**
+   * @return The events dropped because the queue was full, since the
+   * previous call. The edges they carried are missing from the queue.
+   */
+  return events.take_dropped();
+}
+
+uint8_t CarriageEvents::signals_of(const CarriageState& state) {
+  return (state.CCP ? CARRIAGE_SIGNAL_CCP : 0) |
+         (state.KSL ? CARRIAGE_SIGNAL_KSL : 0) |
+         (state.HOK ? CARRIAGE_SIGNAL_HOK : 0) |
+         (state.ND1 ? CARRIAGE_SIGNAL_ND1 : 0) |
+         (state.DOB ? CARRIAGE_SIGNAL_DOB : 0);
+}
@@ -0,0 +1,52 @@
+/**
+ * @file carriage_events.h
+ * @brief Timestamped carriage signal changes, queued from interrupts.
+ */
+#ifndef CARRIAGE_EVENTS_H_
+#define CARRIAGE_EVENTS_H_
+
+#include <stdint.h>
+
+#include "carriage.h"
+
+// Signal levels of a CarriageEvent
+const uint8_t CARRIAGE_SIGNAL_CCP = 0x01;
+const uint8_t CARRIAGE_SIGNAL_KSL = 0x02;
+const uint8_t CARRIAGE_SIGNAL_HOK = 0x04;
+const uint8_t CARRIAGE_SIGNAL_ND1 = 0x08;
+const uint8_t CARRIAGE_SIGNAL_DOB = 0x10;  // Output, sampled with the others
+
+/**
+ * Levels of CCP, KSL, HOK and ND1 right after one of them changed (CCP edge,
+ * point cam entered or left, direction change, reference needle), and the
+ * level DOB held at that time. A change of DOB alone is not an event.
+ */
+struct CarriageEvent {
+  unsigned long time_us;  // micros() when the change was seen
+  uint8_t signals;        // CARRIAGE_SIGNAL_* bits
+
+  CarriageState to_state() const;
+};
+
+/**
+ * Queue of carriage events between the pin interrupts (producer) and the
+ * knitting process (consumer), so that every edge is processed once and in
+ * order even when the loop is late.
+ *
+ * On AVR the events come from the pin change interrupt of CCP, KSL and HOK,
+ * or from the carriage sampler interrupt when a signal filter is configured.
+ * Elsewhere poll() reads the pins from the loop.
+ */
+class CarriageEvents {
+ public:
+  static void begin();
+  static bool is_interrupt_driven();
+  static void record(uint8_t signals);
+  static void poll();
+  static bool pop(CarriageEvent& event);
+  static bool is_pending();
+  static uint8_t take_lost_events();
+  static uint8_t signals_of(const CarriageState& state);
+};
+
+#endif
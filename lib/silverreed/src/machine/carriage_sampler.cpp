@@ -0,0 +1,193 @@
+#include "carriage_sampler.h"
+
+#include <Arduino.h>
+
+#include "carriage_events.h"
+#include "config.h"
+#include "hardware_timer.h"
+
+#if defined(__AVR__)
+#include <util/atomic.h>
+#else
+#define ATOMIC_BLOCK(type)
+#endif
+
+namespace {
+SignalFilter filters[SAMPLED_SIGNAL_COUNT];
+volatile bool enabled = false;
+
+const int signal_pins[SAMPLED_SIGNAL_COUNT] = {
+    PinsCorrespondance::CCP, PinsCorrespondance::KSL, PinsCorrespondance::HOK};
+
+#if defined(__AVR__)
+// Input registers of the sampled pins, digitalRead is too slow for the ISR
+volatile uint8_t* input_registers[SAMPLED_SIGNAL_COUNT];
+uint8_t input_masks[SAMPLED_SIGNAL_COUNT];
+const uint16_t sample_ticks =
+    SIGNAL_SAMPLE_PERIOD_US / (TIMER1_PRESCALER / (F_CPU / 1000000UL));
+
+volatile uint8_t* nd1_input_register;
+uint8_t nd1_input_mask;
+volatile uint8_t* dob_input_register;
+uint8_t dob_input_mask;
+
+bool read_raw(uint8_t signal) {
+  return (*input_registers[signal] & input_masks[signal]) != 0;
+}
+
+bool read_nd1() { return (*nd1_input_register & nd1_input_mask) != 0; }
+
+bool read_dob() { return (*dob_input_register & dob_input_mask) != 0; }
+
+void find_input_registers() {
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    uint8_t pin = signal_pins[signal];
+    input_registers[signal] = portInputRegister(digitalPinToPort(pin));
+    input_masks[signal] = digitalPinToBitMask(pin);
+  }
+  nd1_input_register =
+      portInputRegister(digitalPinToPort(PinsCorrespondance::ND1));
+  nd1_input_mask = digitalPinToBitMask(PinsCorrespondance::ND1);
+  dob_input_register =
+      portInputRegister(digitalPinToPort(PinsCorrespondance::DOB));
+  dob_input_mask = digitalPinToBitMask(PinsCorrespondance::DOB);
+}
+
+void start_sampling() {
+  HardwareTimer::start();
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    OCR1B = TCNT1 + sample_ticks;
+    TIFR1 = _BV(OCF1B);
+    TIMSK1 |= _BV(OCIE1B);
+  }
+}
+
+void stop_sampling() {
+  // TIMSK1 is shared with the DOB scheduler interrupt
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { TIMSK1 &= ~_BV(OCIE1B); }
+}
+#else
+bool read_raw(uint8_t signal) { return digitalRead(signal_pins[signal]); }
+bool read_nd1() { return digitalRead(PinsCorrespondance::ND1); }
+bool read_dob() { return digitalRead(PinsCorrespondance::DOB); }
+void find_input_registers() {}
+void start_sampling() {}
+void stop_sampling() {}
+#endif
+}  // namespace
+
+#if defined(__AVR__)
+ISR(TIMER1_COMPB_vect) {
+  OCR1B += sample_ticks;
+  CarriageEvents::record(CarriageSampler::sample());
+}
+
+bool CarriageSampler::is_timer_driven() { return true; }
+#else
+bool CarriageSampler::is_timer_driven() { return false; }
+#endif
+
+bool CarriageSampler::configure(SampledSignal signal, uint8_t mode,
+                                uint8_t depth) {
+  /**
+   * Configure the filter of one signal. Sampling runs while at least one
+   * filter is configured (depth above 1).
+   *
+   * @return false if the mode or depth is not supported.
+   */
+  if (signal >= SAMPLED_SIGNAL_COUNT || !SignalFilter::is_valid(mode, depth)) {
+    return false;
+  }
+
+  stop_sampling();
+  find_input_registers();
+  enabled = false;
+  filters[signal].configure(mode, depth);
+  for (uint8_t i = 0; i < SAMPLED_SIGNAL_COUNT; i++) {
+    // Start from the current pins, not from a stale filtered state
+    filters[i].reset(read_raw(i));
+    enabled = enabled || filters[i].is_filtering();
+  }
+  if (enabled) {
+    start_sampling();
+  }
+  return true;
+}
+
+bool CarriageSampler::is_enabled() { return enabled; }
+
+uint8_t CarriageSampler::sample() {
+  /**
+   * Feed one sample of each signal to its filter. Called from the timer
+   * interrupt on AVR. ND1 is not filtered, a reference is only used when it
+   * is close to the needle count. DOB is an output, its level is only read.
+   *
+   * @return The filtered levels, as CARRIAGE_SIGNAL_* bits.
+   */
+  const uint8_t signal_bits[SAMPLED_SIGNAL_COUNT] = {
+      CARRIAGE_SIGNAL_CCP, CARRIAGE_SIGNAL_KSL, CARRIAGE_SIGNAL_HOK};
+  uint8_t signals = 0;
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    if (filters[signal].sample(read_raw(signal))) {
+      signals |= signal_bits[signal];
+    }
+  }
+  if (read_nd1()) {
+    signals |= CARRIAGE_SIGNAL_ND1;
+  }
+  if (read_dob()) {
+    signals |= CARRIAGE_SIGNAL_DOB;
+  }
+  return signals;
+}
+
+CarriageState CarriageSampler::read() {
+  /**
+   * Read the carriage state, through the filters when they are enabled.
+   * DOB is an output and ND1 is not filtered, both are read from their pin.
+   *
+   * @return CarriageState snapshot of the (filtered) signals.
+   */
+  if (!enabled) {
+    return CarriageState::read_from_pins();
+  }
+#if !defined(__AVR__)
+  sample();
+#endif
+
+  bool ccp, ksl, hok;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ccp = filters[SAMPLED_CCP].get_state();
+    ksl = filters[SAMPLED_KSL].get_state();
+    hok = filters[SAMPLED_HOK].get_state();
+  }
+  bool dob = digitalRead(PinsCorrespondance::DOB);
+  bool nd1 = digitalRead(PinsCorrespondance::ND1);
+  return CarriageState(ccp, ksl, dob, hok, nd1);
+}
+
+uint8_t CarriageSampler::get_latency_samples(SampledSignal signal) {
+  /**
+   * @return The delay the filter of `signal` adds to a clean edge, in samples.
+   */
+  return filters[signal].get_latency_samples();
+}
+
+uint16_t CarriageSampler::get_rejected_glitches(SampledSignal signal) {
+  /**
+   * @return The glitches filtered out on `signal` since the last clear.
+   */
+  uint16_t glitches;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    glitches = filters[signal].get_rejected_glitches();
+  }
+  return glitches;
+}
+
+void CarriageSampler::clear_rejected_glitches() {
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+      filters[signal].clear_rejected_glitches();
+    }
+  }
+}
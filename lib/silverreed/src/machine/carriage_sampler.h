@@ -0,0 +1,41 @@
+/**
+ * @file carriage_sampler.h
+ * @brief Oversampling of the carriage signals through glitch filters.
+ */
+#ifndef CARRIAGE_SAMPLER_H_
+#define CARRIAGE_SAMPLER_H_
+
+#include <stdint.h>
+
+#include "carriage.h"
+#include "signal_filter.h"
+
+enum SampledSignal : uint8_t {
+  SAMPLED_CCP,
+  SAMPLED_KSL,
+  SAMPLED_HOK,
+  SAMPLED_SIGNAL_COUNT
+};
+
+/**
+ * Samples CCP, KSL and HOK at a fixed rate and feeds them to one
+ * SignalFilter each, so that noise on the machine cables does not count as
+ * needles or point cams.
+ *
+ * On AVR, the Timer1 compare B interrupt samples every
+ * SIGNAL_SAMPLE_PERIOD_US. Elsewhere the signals are sampled on each read, at
+ * the loop rate. Until a filter is configured, read() is a plain pin read.
+ */
+class CarriageSampler {
+ public:
+  static bool is_timer_driven();
+  static bool configure(SampledSignal signal, uint8_t mode, uint8_t depth);
+  static bool is_enabled();
+  static uint8_t sample();
+  static CarriageState read();
+  static uint8_t get_latency_samples(SampledSignal signal);
+  static uint16_t get_rejected_glitches(SampledSignal signal);
+  static void clear_rejected_glitches();
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "dob_scheduler.h"
+
+#include <Arduino.h>
+
+#include "config.h"
+#include "hardware_timer.h"
+
+namespace {
+volatile bool pending = false;
+volatile bool pending_state = false;
+
+void write_DOB(bool state) { digitalWrite(PinsCorrespondance::DOB, state); }
+}  // namespace
+
+#if defined(__AVR__)
+
+ISR(TIMER1_COMPA_vect) {
+  TIMSK1 &= ~_BV(OCIE1A);
+  write_DOB(pending_state);
+  pending = false;
+}
+
+bool DobScheduler::is_supported() { return true; }
+
+void DobScheduler::schedule(bool state, unsigned long delay_us) {
+  /**
+   * Write DOB `delay_us` from now, replacing any pending write.
+   */
+  uint16_t ticks = HardwareTimer::us_to_ticks(delay_us);
+  if (ticks == 0) {
+    cancel();
+    write_DOB(state);
+    return;
+  }
+  HardwareTimer::start();
+
+  uint8_t sreg = SREG;
+  cli();
+  pending_state = state;
+  pending = true;
+  OCR1A = TCNT1 + ticks;
+  TIFR1 = _BV(OCF1A);  // Drop a compare match of the previous schedule
+  TIMSK1 |= _BV(OCIE1A);
+  SREG = sreg;
+}
+
+bool DobScheduler::cancel() {
+  /**
+   * Drop the pending write.
+   *
+   * @return true if a write was pending.
+   */
+  uint8_t sreg = SREG;
+  cli();
+  TIMSK1 &= ~_BV(OCIE1A);
+  bool was_pending = pending;
+  pending = false;
+  SREG = sreg;
+  return was_pending;
+}
+
+#else
+
+bool DobScheduler::is_supported() { return false; }
+
+void DobScheduler::schedule(bool state, unsigned long delay_us) {
+  /**
+   * No timer available: write DOB right away.
+   */
+  write_DOB(state);
+}
+
+bool DobScheduler::cancel() { return false; }
+
+#endif
+
+bool DobScheduler::flush() {
+  /**
+   * Perform the pending write now, if the timer did not fire yet (the next
+   * needle came earlier than expected).
+   *
+   * @return true if a write was pending.
+   */
+  bool state = pending_state;
+  if (!cancel()) {
+    return false;
+  }
+  write_DOB(state);
+  return true;
+}
+
+bool DobScheduler::is_pending() { return pending; }
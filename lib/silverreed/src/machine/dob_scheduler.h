@@ -0,0 +1,28 @@
+/**
+ * @file dob_scheduler.h
+ * @brief DOB writes scheduled with a hardware timer compare.
+ */
+#ifndef DOB_SCHEDULER_H_
+#define DOB_SCHEDULER_H_
+
+#include <stdint.h>
+
+/**
+ * Writes DOB at a given delay from now, independently of the loop timing.
+ *
+ * On AVR, Timer1 runs freely (see hardware_timer.h) and its compare A
+ * interrupt performs the write. Elsewhere there is no timer to use and the
+ * writes happen immediately.
+ *
+ * There is only one DOB pin, hence one pending write at a time.
+ */
+class DobScheduler {
+ public:
+  static bool is_supported();
+  static void schedule(bool state, unsigned long delay_us);
+  static bool flush();
+  static bool cancel();
+  static bool is_pending();
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "hardware_timer.h"
+
+#if defined(__AVR__)
+
+#include <Arduino.h>
+
+#include "config.h"
+
+namespace {
+bool timer_started = false;
+}  // namespace
+
+void HardwareTimer::start() {
+  /**
+   * Switch Timer1 to normal mode (the Arduino core sets it up for PWM), once.
+   */
+  if (timer_started) {
+    return;
+  }
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11) | _BV(CS10);  // Prescaler 64
+  timer_started = true;
+}
+
+uint16_t HardwareTimer::us_to_ticks(unsigned long us) {
+  /**
+   * @return The number of timer ticks in `us`, saturated to the 16-bit
+   * counter range.
+   */
+  const unsigned long us_per_tick = TIMER1_PRESCALER / (F_CPU / 1000000UL);
+  unsigned long ticks = us / us_per_tick;
+  return ticks > 0xFFFFUL ? 0xFFFFU : static_cast<uint16_t>(ticks);
+}
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file hardware_timer.h
+ * @brief Free running Timer1, shared by the timer compare users (AVR only).
+ */
+#ifndef HARDWARE_TIMER_H_
+#define HARDWARE_TIMER_H_
+
+#include <stdint.h>
+
+#if defined(__AVR__)
+
+/**
+ * Timer1 in normal mode, counting freely with prescaler TIMER1_PRESCALER.
+ *
+ * Each user owns one compare unit: A for the DOB scheduler, B for the
+ * carriage sampler. Starting the timer does not touch the compare interrupts
+ * already enabled.
+ */
+namespace HardwareTimer {
+void start();
+uint16_t us_to_ticks(unsigned long us);
+}  // namespace HardwareTimer
+
+#endif
+
+#endif
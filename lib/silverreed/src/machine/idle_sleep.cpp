@@ -0,0 +1,114 @@
+#include "idle_sleep.h"
+
+#include <Arduino.h>
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#endif
+
+namespace {
+uint16_t sleep_count = 0;
+uint16_t edge_wake_count = 0;
+uint16_t max_wake_latency_us = 0;
+volatile bool is_sleeping = false;
+volatile bool has_edge_wake = false;
+volatile uint8_t edge_wake_ticks = 0;
+}  // namespace
+
+#if defined(__AVR__)
+
+namespace {
+void record_latency(uint16_t latency) {
+  if (latency > max_wake_latency_us) {
+    max_wake_latency_us = latency;
+  }
+}
+}  // namespace
+
+bool IdleSleep::is_supported() { return true; }
+
+bool IdleSleep::sleep(WakeCondition has_work) {
+  /**
+   * Sleep until the next interrupt, unless there is work.
+   *
+   * The work is checked with the interrupts disabled, and the CPU sleeps on
+   * the instruction following sei() (run before any pending interrupt), so an
+   * interrupt arriving after the check still wakes it up.
+   *
+   * The wake up latency is measured when the millis() tick woke the CPU: the
+   * Timer0 counter then holds the time since its overflow. The time of a
+   * carriage edge is not known, only the Timer0 count at the entry of its
+   * interrupt is kept (see note_wake()).
+   *
+   * @return true if the CPU slept.
+   */
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  cli();
+  if (has_work()) {
+    sei();
+    return false;
+  }
+  unsigned long start_ms = millis();
+  has_edge_wake = false;
+  is_sleeping = true;
+  sleep_enable();
+  sei();
+  sleep_cpu();
+  uint8_t ticks = TCNT0;
+  is_sleeping = false;
+  sleep_disable();
+
+  if (sleep_count < UINT16_MAX) {
+    sleep_count++;
+  }
+  if (has_edge_wake) {
+    if (edge_wake_count < UINT16_MAX) {
+      edge_wake_count++;
+    }
+  } else if (millis() != start_ms) {
+    // Timer0 counts every 64 clock cycles
+    record_latency(ticks * 64U / clockCyclesPerMicrosecond());
+  }
+  return true;
+}
+
+void IdleSleep::note_wake() {
+  /**
+   * Called first by the pin change interrupt: if the CPU was sleeping, the
+   * edge woke it up. The Timer0 count is kept, to compare with the time of
+   * an edge Timer0 made (OC0B). Only the first interrupt after sleep_cpu()
+   * is taken.
+   */
+  uint8_t ticks = TCNT0;
+  if (is_sleeping) {
+    is_sleeping = false;
+    edge_wake_ticks = ticks;
+    has_edge_wake = true;
+  }
+}
+
+#else
+
+bool IdleSleep::is_supported() { return false; }
+
+bool IdleSleep::sleep(WakeCondition has_work) {
+  (void)has_work;
+  return false;
+}
+
+void IdleSleep::note_wake() {}
+
+#endif
+
+uint16_t IdleSleep::get_sleep_count() { return sleep_count; }
+
+uint16_t IdleSleep::get_edge_wake_count() { return edge_wake_count; }
+
+uint8_t IdleSleep::get_edge_wake_ticks() { return edge_wake_ticks; }
+
+uint16_t IdleSleep::get_max_wake_latency_us() { return max_wake_latency_us; }
+
+void IdleSleep::clear_stats() {
+  sleep_count = 0;
+  edge_wake_count = 0;
+  max_wake_latency_us = 0;
+}
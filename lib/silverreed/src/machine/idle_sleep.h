@@ -0,0 +1,36 @@
+/**
+ * @file idle_sleep.h
+ * @brief Idle sleep of the MCU until the next interrupt.
+ */
+#ifndef IDLE_SLEEP_H_
+#define IDLE_SLEEP_H_
+
+#include <stdint.h>
+
+typedef bool (*WakeCondition)();
+
+/**
+ * Puts the CPU in idle sleep when there is no work. The timers, the UART and
+ * the pin change interrupts keep running, so it wakes on a carriage edge
+ * (PCINT2, or the sampler timer when a filter is configured), a serial byte
+ * or the millis() tick of Timer0, at the latest ~1 ms later. The pin change
+ * interrupt calls note_wake() first, which keeps the Timer0 count at its
+ * entry: the wake-up latency of an edge made by Timer0 (CCP is OC0B) is
+ * measured from it.
+ *
+ * Only AVR boards sleep. Elsewhere sleep() returns right away and the loop
+ * keeps polling.
+ */
+class IdleSleep {
+ public:
+  static bool is_supported();
+  static bool sleep(WakeCondition has_work);
+  static void note_wake();
+  static uint16_t get_sleep_count();
+  static uint16_t get_edge_wake_count();
+  static uint8_t get_edge_wake_ticks();
+  static uint16_t get_max_wake_latency_us();
+  static void clear_stats();
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "signal_filter.h"
+
+#include "config.h"
+
+namespace {
+uint8_t history_mask(uint8_t depth) { return (1U << depth) - 1U; }
+
+uint8_t count_bits(uint8_t bits) {
+  uint8_t count = 0;
+  for (; bits != 0; bits &= bits - 1U) {
+    count++;
+  }
+  return count;
+}
+}  // namespace
+
+SignalFilter::SignalFilter()
+    : mode(FILTER_INTEGRATOR),
+      depth(0),
+      integrator(0),
+      state(false),
+      is_glitch(false),
+      rejected_glitches(0) {}
+
+bool SignalFilter::is_valid(uint8_t mode, uint8_t depth) {
+  /**
+   * @return true if the filter can be configured with `mode` and `depth`.
+   */
+  if (depth <= 1U) {
+    return mode <= FILTER_MAJORITY;
+  }
+  if (mode == FILTER_INTEGRATOR) {
+    return depth <= SIGNAL_FILTER_MAX_DEPTH;
+  }
+  // An even window could not decide on a tie
+  return mode == FILTER_MAJORITY && depth <= SIGNAL_MAJORITY_MAX_DEPTH &&
+         (depth & 1U) == 1U;
+}
+
+bool SignalFilter::configure(uint8_t mode, uint8_t depth) {
+  /**
+   * Change the filter, keeping its output state.
+   *
+   * @return false if the mode or depth is not supported.
+   */
+  if (!is_valid(mode, depth)) {
+    return false;
+  }
+  this->mode = mode;
+  this->depth = depth;
+  this->reset(this->state);
+  return true;
+}
+
+void SignalFilter::reset(bool state) {
+  /**
+   * Settle the filter on `state`, as if it had been sampled for long.
+   */
+  this->state = state;
+  if (this->mode == FILTER_MAJORITY) {
+    this->integrator = state ? history_mask(this->depth) : 0;
+  } else {
+    this->integrator = state ? this->depth : 0;
+  }
+  this->is_glitch = false;
+}
+
+bool SignalFilter::sample(bool raw) {
+  /**
+   * Add a sample of the signal.
+   *
+   * @return The filtered state.
+   */
+  if (this->depth <= 1U) {
+    this->state = raw;
+    return raw;
+  }
+
+  bool new_state = this->state;
+  bool at_rest;
+  if (this->mode == FILTER_MAJORITY) {
+    uint8_t mask = history_mask(this->depth);
+    this->integrator = ((this->integrator << 1) | raw) & mask;
+    new_state = count_bits(this->integrator) > (this->depth >> 1);
+    at_rest = this->integrator == (new_state ? mask : 0);
+  } else {
+    if (raw && this->integrator < this->depth) {
+      this->integrator++;
+    } else if (!raw && this->integrator > 0) {
+      this->integrator--;
+    }
+    if (this->integrator == this->depth) {
+      new_state = true;
+    } else if (this->integrator == 0) {
+      new_state = false;
+    }
+    at_rest = this->integrator == (new_state ? this->depth : 0);
+  }
+
+  if (new_state != this->state) {
+    this->state = new_state;
+    this->is_glitch = false;
+  } else if (raw != this->state) {
+    this->is_glitch = true;
+  } else if (at_rest && this->is_glitch) {
+    // Back to the output state without switching: a glitch was filtered out
+    this->is_glitch = false;
+    this->rejected_glitches++;
+  }
+  return this->state;
+}
+
+uint8_t SignalFilter::get_latency_samples() const {
+  /**
+   * @return The delay added to a clean edge, in samples.
+   */
+  if (this->depth <= 1U) {
+    return 0;
+  }
+  return this->mode == FILTER_MAJORITY ? (this->depth >> 1) + 1U
+                                       : this->depth;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file signal_filter.h
+ * @brief Digital glitch filter for a sampled carriage signal.
+ */
+#ifndef SIGNAL_FILTER_H_
+#define SIGNAL_FILTER_H_
+
+#include <stdint.h>
+
+enum SignalFilterMode : uint8_t { FILTER_INTEGRATOR = 0, FILTER_MAJORITY = 1 };
+
+/**
+ * Debounces a signal from regular samples of it.
+ *
+ * - Integrator: a counter goes up on HIGH samples and down on LOW ones,
+ *   saturating at 0 and `depth`; the output switches when it reaches either
+ *   end. A clean edge is delayed by `depth` samples and any burst shorter than
+ *   that is rejected.
+ * - Majority: the output is the majority of the last `depth` samples (odd).
+ *   A clean edge is delayed by depth / 2 + 1 samples and bursts of up to
+ *   depth / 2 samples are rejected.
+ *
+ * A depth of 0 or 1 passes the samples through.
+ */
+class SignalFilter {
+ private:
+  uint8_t mode;
+  uint8_t depth;
+  uint8_t integrator;  // Integrator count, or history bits (majority)
+  bool state;
+  bool is_glitch;  // The samples left the output state without switching it
+  uint16_t rejected_glitches;
+
+ public:
+  SignalFilter();
+  static bool is_valid(uint8_t mode, uint8_t depth);
+  bool configure(uint8_t mode, uint8_t depth);
+  void reset(bool state);
+  bool sample(bool raw);
+  bool get_state() const { return state; }
+  bool is_filtering() const { return depth > 1; }
+  uint8_t get_latency_samples() const;
+  uint16_t get_rejected_glitches() const { return rejected_glitches; }
+  void clear_rejected_glitches() { rejected_glitches = 0; }
+};
+
+#endif
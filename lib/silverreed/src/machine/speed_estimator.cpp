@@ -0,0 +1,67 @@
+#include "speed_estimator.h"
+
+#include "config.h"
+
+void SpeedEstimator::clear() {
+  /**
+   * Forget the previous edges, done at the start of each knitting session.
+   */
+  this->restart();
+  this->min_period = 0;
+}
+
+void SpeedEstimator::restart() {
+  /**
+   * Start a new estimate from the next edge, keeping the highest speed (the
+   * carriage turned).
+   */
+  this->last_edge_time = 0;
+  this->has_last_edge = false;
+  this->average_period = 0;
+}
+
+void SpeedEstimator::record_edge(unsigned long time_us) {
+  /**
+   * Add a CCP rising edge to the estimate.
+   *
+   * @param time_us Time of the edge, from micros().
+   */
+  unsigned long period = time_us - this->last_edge_time;
+  bool had_last_edge = this->has_last_edge;
+  this->last_edge_time = time_us;
+  this->has_last_edge = true;
+  if (!had_last_edge) {
+    return;
+  }
+
+  if (period > SPEED_STOPPED_PERIOD_US) {
+    // The carriage stopped, the next period starts a new estimate
+    this->average_period = 0;
+    return;
+  }
+
+  int32_t sample = static_cast<int32_t>(period) << SPEED_PERIOD_FRACTION_BITS;
+  if (this->average_period == 0) {
+    this->average_period = sample;
+  } else {
+    int32_t average = static_cast<int32_t>(this->average_period);
+    average += (sample - average) >> SPEED_AVERAGE_SHIFT;
+    this->average_period = average > 0 ? average : 1;
+  }
+
+  if (this->min_period == 0 || this->average_period < this->min_period) {
+    this->min_period = this->average_period;
+  }
+}
+
+uint16_t SpeedEstimator::to_needles_per_second(uint32_t period) {
+  /**
+   * @param period Fixed point CCP period, 0 when unknown.
+   * @return The carriage speed in needles per second, 0 when unknown.
+   */
+  if (period == 0) {
+    return 0;
+  }
+  uint32_t speed = (1000000UL << SPEED_PERIOD_FRACTION_BITS) / period;
+  return speed > 0xFFFFU ? 0xFFFFU : speed;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file speed_estimator.h
+ * @brief Carriage speed estimated from the period of the CCP pulses.
+ */
+#ifndef SPEED_ESTIMATOR_H_
+#define SPEED_ESTIMATOR_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * Moving average of the time between two CCP rising edges (one needle).
+ *
+ * The average period is kept in fixed point (SPEED_PERIOD_FRACTION_BITS
+ * fractional bits) and updated with an exponential moving average over about
+ * 2^SPEED_AVERAGE_SHIFT needles, so no division is done per needle: speeds
+ * are compared as periods (period_of() is evaluated at compile time), and
+ * converted to needles per second only when reported. A pause longer than
+ * SPEED_STOPPED_PERIOD_US restarts the estimate.
+ */
+class SpeedEstimator {
+ private:
+  unsigned long last_edge_time;
+  bool has_last_edge;
+  uint32_t average_period;  // us, fixed point, 0 until two edges were seen
+  uint32_t min_period;      // Same unit, highest speed of the session
+
+  static uint16_t to_needles_per_second(uint32_t period);
+
+ public:
+  // Fixed point period of a speed in needles per second
+  static constexpr uint32_t period_of(uint16_t needles_per_second) {
+    return (1000000UL << SPEED_PERIOD_FRACTION_BITS) / needles_per_second;
+  }
+
+  constexpr SpeedEstimator()
+      : last_edge_time(0),
+        has_last_edge(false),
+        average_period(0),
+        min_period(0) {}
+  void clear();
+  void restart();
+  void record_edge(unsigned long time_us);
+  bool reaches(uint32_t period) const {
+    return average_period != 0 && average_period <= period;
+  }
+  uint16_t get_needles_per_second() const {
+    return to_needles_per_second(average_period);
+  }
+  uint32_t get_period_us() const {
+    return average_period >> SPEED_PERIOD_FRACTION_BITS;
+  }
+  uint16_t get_max_needles_per_second() const {
+    return to_needles_per_second(min_period);
+  }
+  bool is_valid() const { return average_period != 0; }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "motif.h"
+
+#include <string.h>
+
+#include "Arduino.h"
+
+bool Motif::configure(uint8_t width, uint8_t height, uint8_t x_offset,
+                      uint8_t y_offset, uint8_t flags, uint16_t rows) {
+  /**
+   * Set the geometry of the motif. The tile content must then be uploaded
+   * with load().
+   *
+   * @param width Repeat width in needles.
+   * @param height Repeat height in rows.
+   * @param x_offset Horizontal shift of the repeat, in needles.
+   * @param y_offset Tile row knitted first.
+   * @param flags MOTIF_MIRROR_HORIZONTAL and/or MOTIF_MIRROR_VERTICAL.
+   * @param rows Number of rows to knit, 0 to knit until stopped.
+   * @return false if the tile does not fit in MOTIF_MAX_BYTES.
+   */
+  uint8_t stride = (width + BITS_PER_BYTE - 1) / BITS_PER_BYTE;
+  if (width == 0 || height == 0 ||
+      static_cast<uint16_t>(stride) * height > MOTIF_MAX_BYTES) {
+    this->width = 0;
+    return false;
+  }
+
+  this->width = width;
+  this->height = height;
+  this->stride = stride;
+  this->x_offset = x_offset % width;
+  this->y_offset = y_offset % height;
+  this->flags = flags;
+  this->rows = rows;
+  this->loaded_bytes = 0;
+  return true;
+}
+
+bool Motif::load(uint8_t offset, const uint8_t* data, uint8_t length) {
+  /**
+   * Copy a chunk of the tile. Chunks must be sent in order.
+   *
+   * @return false if the chunk is out of order or exceeds the tile.
+   */
+  if (this->width == 0 || offset != this->loaded_bytes ||
+      offset + length > this->tile_size()) {
+    return false;
+  }
+  memcpy(this->tile + offset, data, length);
+  this->loaded_bytes += length;
+  return true;
+}
+
+void Motif::render_row(uint16_t row, uint8_t* line) const {
+  /**
+   * Generate a full row of the needle bed from the tile.
+   * The line uses the Pattern convention (inverted bits: 0 selects a needle).
+   *
+   * @param row Row number since the start of the knitting.
+   * @param line MAX_LINE_BUFFER_LEN bytes, overwritten.
+   */
+  uint8_t tile_y = (row + this->y_offset) % this->height;
+  if (this->flags & MOTIF_MIRROR_VERTICAL) {
+    tile_y = this->height - 1 - tile_y;
+  }
+  const uint8_t* tile_row = this->tile + tile_y * this->stride;
+  bool mirror = this->flags & MOTIF_MIRROR_HORIZONTAL;
+
+  memset(line, 0xFF, MAX_LINE_BUFFER_LEN);
+  // Walk the tile column alongside the needle to avoid a modulo per needle
+  uint8_t x = (this->width - this->x_offset) % this->width;
+  for (uint8_t needle = 0; needle < DEFAULT_MAX_NEEDLES; needle++) {
+    uint8_t tile_x = mirror ? this->width - 1 - x : x;
+    if (bitRead(tile_row[tile_x >> 3], tile_x & BIT_INDEX_MASK)) {
+      line[needle >> 3] &= ~(1U << (needle & BIT_INDEX_MASK));
+    }
+    if (++x == this->width) {
+      x = 0;
+    }
+  }
+}
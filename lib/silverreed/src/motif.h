@@ -0,0 +1,65 @@
+/**
+ * @file motif.h
+ * @brief Repeating motif tile used to generate rows without the host.
+ */
+#ifndef MOTIF_H_
+#define MOTIF_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+// Motif flags (reqMotif)
+const uint8_t MOTIF_MIRROR_HORIZONTAL = 0x01;
+const uint8_t MOTIF_MIRROR_VERTICAL = 0x02;
+
+/**
+ * A motif tile repeated over the whole needle bed.
+ *
+ * The tile uses the same bit layout as cnfLine rows (little endian bits, 1
+ * for a selected needle), one row every `stride` bytes. Needle 0 of the bed
+ * shows tile column `-x_offset` (modulo the width) and row 0 of the knitting
+ * shows tile row `y_offset`.
+ */
+class Motif {
+ private:
+  uint8_t width;
+  uint8_t height;
+  uint8_t stride;
+  uint8_t x_offset;
+  uint8_t y_offset;
+  uint8_t flags;
+  uint16_t rows;
+  uint8_t loaded_bytes;
+  uint8_t tile[MOTIF_MAX_BYTES];
+
+ public:
+  constexpr Motif()
+      : width(0),
+        height(0),
+        stride(0),
+        x_offset(0),
+        y_offset(0),
+        flags(0),
+        rows(0),
+        loaded_bytes(0),
+        tile() {}
+  bool configure(uint8_t width, uint8_t height, uint8_t x_offset,
+                 uint8_t y_offset, uint8_t flags, uint16_t rows);
+  bool load(uint8_t offset, const uint8_t* data, uint8_t length);
+  void render_row(uint16_t row, uint8_t* line) const;
+
+  bool is_loaded() const {
+    return width != 0 && loaded_bytes == tile_size();
+  }
+  uint8_t tile_size() const { return stride * height; }
+  uint8_t get_width() const { return width; }
+  uint8_t get_height() const { return height; }
+  uint8_t get_x_offset() const { return x_offset; }
+  uint8_t get_y_offset() const { return y_offset; }
+  uint8_t get_flags() const { return flags; }
+  const uint8_t* get_tile() const { return tile; }
+  uint16_t get_rows() const { return rows; }
+};
+
+#endif
@@ -0,0 +1,195 @@
+#include "motif_store.h"
+
+#include "Arduino.h"
+#include "crc.h"
+
+// Tile bytes copied at once when loading a motif (stack buffer)
+const uint8_t MOTIF_LOAD_CHUNK = 16;
+
+uint16_t MotifStore::record_address(uint8_t record) const {
+  return this->address + static_cast<uint16_t>(record) * MOTIF_RECORD_SIZE;
+}
+
+uint16_t MotifStore::read_sequence(uint8_t record) const {
+  uint16_t base = this->record_address(record);
+  return (static_cast<uint16_t>(this->storage.read(base + 2)) << 8) |
+         this->storage.read(base + 3);
+}
+
+uint8_t MotifStore::compute_crc(uint8_t record) const {
+  /**
+   * CRC8 of the header (bytes 1-10) and of the tile of a record.
+   * A record whose geometry does not fit in a Motif never matches its CRC.
+   */
+  uint16_t base = this->record_address(record);
+  uint8_t crc = 0x00U;
+  for (uint8_t i = 1; i < MOTIF_RECORD_HEADER - 1; i++) {
+    crc = crc8_update(crc, this->storage.read(base + i));
+  }
+
+  uint8_t width = this->storage.read(base + 4);
+  uint8_t height = this->storage.read(base + 5);
+  uint16_t tile_size =
+      static_cast<uint16_t>((width + BITS_PER_BYTE - 1) / BITS_PER_BYTE) *
+      height;
+  if (tile_size > MOTIF_MAX_BYTES) {
+    return ~this->storage.read(base + MOTIF_RECORD_HEADER - 1);
+  }
+  for (uint8_t i = 0; i < tile_size; i++) {
+    crc = crc8_update(crc, this->storage.read(base + MOTIF_RECORD_HEADER + i));
+  }
+  return crc;
+}
+
+bool MotifStore::is_valid(uint8_t record) const {
+  /**
+   * @return true if the record is committed and its content is intact.
+   */
+  uint16_t base = this->record_address(record);
+  return this->storage.read(base) == MOTIF_RECORD_VALID &&
+         this->storage.read(base + 1) < MOTIF_STORE_SLOTS &&
+         this->storage.read(base + MOTIF_RECORD_HEADER - 1) ==
+             this->compute_crc(record);
+}
+
+int8_t MotifStore::find(uint8_t slot) const {
+  /**
+   * @return The record holding the latest version of a slot, -1 if the slot
+   * is empty. Two versions only coexist if a save was interrupted between its
+   * commit and the invalidation of the previous version.
+   */
+  int8_t found = -1;
+  for (uint8_t record = 0; record < this->records; record++) {
+    if (this->storage.read(this->record_address(record) + 1) != slot ||
+        !this->is_valid(record)) {
+      continue;
+    }
+    if (found < 0 ||
+        static_cast<int16_t>(this->read_sequence(record) -
+                             this->read_sequence(found)) > 0) {
+      found = record;
+    }
+  }
+  return found;
+}
+
+bool MotifStore::save(uint8_t slot, const Motif& motif) {
+  /**
+   * Save a motif in a slot, replacing its previous content.
+   *
+   * @return false if the slot number is invalid, the motif is incomplete or
+   * no record is free.
+   */
+  if (slot >= MOTIF_STORE_SLOTS || !motif.is_loaded()) {
+    return false;
+  }
+
+  // Sequence of the newest record, to order the writes
+  int8_t current = this->find(slot);
+  bool has_valid = false;
+  uint16_t newest = 0;
+  for (uint8_t record = 0; record < this->records; record++) {
+    if (!this->is_valid(record)) {
+      continue;
+    }
+    uint16_t sequence = this->read_sequence(record);
+    if (!has_valid || static_cast<int16_t>(sequence - newest) > 0) {
+      newest = sequence;
+    }
+    has_valid = true;
+  }
+  uint16_t sequence = newest + 1;
+
+  // Least recently written record not holding a slot. Erased records (never
+  // written) come first.
+  int8_t target = -1;
+  uint16_t target_age = 0;
+  for (uint8_t record = 0; record < this->records; record++) {
+    if (this->is_valid(record)) {
+      continue;
+    }
+    uint8_t state = this->storage.read(this->record_address(record));
+    uint16_t age = state == MOTIF_RECORD_OBSOLETE
+                       ? sequence - this->read_sequence(record)
+                       : 0xFFFFU;
+    if (target < 0 || age > target_age) {
+      target = record;
+      target_age = age;
+    }
+  }
+  if (target < 0) {
+    return false;
+  }
+
+  uint8_t header[MOTIF_RECORD_HEADER - 2] = {
+      slot,
+      highByte(sequence),
+      lowByte(sequence),
+      motif.get_width(),
+      motif.get_height(),
+      motif.get_x_offset(),
+      motif.get_y_offset(),
+      motif.get_flags(),
+      highByte(motif.get_rows()),
+      lowByte(motif.get_rows()),
+  };
+  uint16_t base = this->record_address(target);
+  // Not valid until the end of the write
+  this->storage.update(base, MOTIF_RECORD_OBSOLETE);
+  uint8_t crc = 0x00U;
+  for (uint8_t i = 0; i < sizeof(header); i++) {
+    this->storage.update(base + 1 + i, header[i]);
+    crc = crc8_update(crc, header[i]);
+  }
+  const uint8_t* tile = motif.get_tile();
+  for (uint8_t i = 0; i < motif.tile_size(); i++) {
+    this->storage.update(base + MOTIF_RECORD_HEADER + i, tile[i]);
+    crc = crc8_update(crc, tile[i]);
+  }
+  this->storage.update(base + MOTIF_RECORD_HEADER - 1, crc);
+
+  // Commit, then drop the previous version
+  this->storage.update(base, MOTIF_RECORD_VALID);
+  if (current >= 0) {
+    this->storage.update(this->record_address(current),
+                         MOTIF_RECORD_OBSOLETE);
+  }
+  return true;
+}
+
+bool MotifStore::load(uint8_t slot, Motif& motif) const {
+  /**
+   * Load the motif of a slot.
+   *
+   * @return false if the slot is empty or its content is corrupted.
+   */
+  int8_t record = this->find(slot);
+  if (record < 0) {
+    return false;
+  }
+
+  uint16_t base = this->record_address(record);
+  uint16_t rows = (static_cast<uint16_t>(this->storage.read(base + 9)) << 8) |
+                  this->storage.read(base + 10);
+  if (!motif.configure(this->storage.read(base + 4),
+                       this->storage.read(base + 5),
+                       this->storage.read(base + 6),
+                       this->storage.read(base + 7),
+                       this->storage.read(base + 8), rows)) {
+    return false;
+  }
+
+  uint8_t chunk[MOTIF_LOAD_CHUNK];
+  for (uint8_t offset = 0; offset < motif.tile_size();
+       offset += MOTIF_LOAD_CHUNK) {
+    uint8_t length = motif.tile_size() - offset;
+    if (length > MOTIF_LOAD_CHUNK) {
+      length = MOTIF_LOAD_CHUNK;
+    }
+    for (uint8_t i = 0; i < length; i++) {
+      chunk[i] = this->storage.read(base + MOTIF_RECORD_HEADER + offset + i);
+    }
+    motif.load(offset, chunk, length);
+  }
+  return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file motif_store.h
+ * @brief Persistent motif slots with wear levelling.
+ */
+#ifndef MOTIF_STORE_H_
+#define MOTIF_STORE_H_
+
+#include <stdint.h>
+
+#include "config.h"
+#include "motif.h"
+#include "storage.h"
+
+/**
+ * Keeps motifs in persistent storage so they can be knitted again by slot
+ * number without uploading them.
+ *
+ * Each save goes to the least recently written free record, so the writes
+ * are spread over all the records. A record is committed by writing its
+ * state byte last, and the previous version of the slot is only marked
+ * obsolete afterwards: a power loss during a save keeps the previous version.
+ *
+ * Record layout:
+ *   0      state (MOTIF_RECORD_VALID, MOTIF_RECORD_OBSOLETE or erased)
+ *   1      slot
+ *   2-3    write sequence (big endian)
+ *   4-10   width, height, x offset, y offset, flags, rows (big endian)
+ *   11     CRC8 of bytes 1-10 and of the tile
+ *   12...  tile (MOTIF_MAX_BYTES)
+ */
+const uint8_t MOTIF_RECORD_HEADER = 12;
+const uint8_t MOTIF_RECORD_SIZE = MOTIF_RECORD_HEADER + MOTIF_MAX_BYTES;
+const uint8_t MOTIF_RECORD_VALID = 0xA5;
+const uint8_t MOTIF_RECORD_OBSOLETE = 0x00;
+
+class MotifStore {
+ private:
+  Storage& storage;
+  uint16_t address;
+  uint8_t records;
+
+  uint16_t record_address(uint8_t record) const;
+  uint16_t read_sequence(uint8_t record) const;
+  uint8_t compute_crc(uint8_t record) const;
+  bool is_valid(uint8_t record) const;
+  int8_t find(uint8_t slot) const;
+
+ public:
+  constexpr MotifStore(Storage& storage, uint16_t address, uint8_t records)
+      : storage(storage), address(address), records(records) {}
+  bool save(uint8_t slot, const Motif& motif);
+  bool load(uint8_t slot, Motif& motif) const;
+  bool contains(uint8_t slot) const { return find(slot) >= 0; }
+};
+
+#endif
@@ -4,18 +4,6 @@
 #include "config.h"
 #include "debug.h"
 
-Pattern::Pattern() {
-  /**
-   * Init the pattern with default values.
-   * By default, the needle range is set to the full machine (0 to
-   * DEFAULT_MAX_NEEDLES needles). The buffer pointer is initialized to nullptr
-   * and must be set via set_buffer() before calling get_needle_state().
-   */
-  this->buffer = nullptr;
-  this->start_offset = 0;
-  this->end_offset = DEFAULT_MAX_NEEDLES;
-}
-
 void Pattern::set_needle_range(uint8_t start_needle, uint8_t end_needle) {
   /**
    * Set the range of needles for the pattern.
@@ -27,13 +15,25 @@ void Pattern::set_needle_range(uint8_t start_needle, uint8_t end_needle) {
   this->end_offset = end_needle;
 }
 
-void Pattern::set_buffer(uint8_t* buffer) {
+void Pattern::set_buffer(const uint8_t* buffer) {
   /**
    * Set the buffer of the pattern.
    *
    * @param buffer The buffer of the pattern.
    */
   this->buffer = buffer;
+  this->buffer_in_flash = false;
+}
+
+void Pattern::set_flash_buffer(const uint8_t* buffer) {
+  /**
+   * Set a buffer stored in program memory (PROGMEM) as the pattern.
+   * The row is read in place with pgm_read_byte, without any copy in SRAM.
+   *
+   * @param buffer The buffer of the pattern, in program memory.
+   */
+  this->buffer = buffer;
+  this->buffer_in_flash = true;
 }
 
 bool Pattern::get_needle_state(int needle_in_pattern,
@@ -85,7 +85,9 @@ bool Pattern::read_bit_little_endian(int offset) {
    * The caller must ensure set_buffer() was called before using this function.
    */
   uint8_t current_byte = offset >> 3;  // Divide by BITS_PER_BYTE
-  bool pixelValue =
-      bitRead(this->buffer[current_byte], offset & BIT_INDEX_MASK);
+  uint8_t value = this->buffer_in_flash
+                      ? pgm_read_byte(this->buffer + current_byte)
+                      : this->buffer[current_byte];
+  bool pixelValue = bitRead(value, offset & BIT_INDEX_MASK);
   return pixelValue;
 }
@@ -7,22 +7,31 @@
 #define PATTERN_H_
 
 #include "Arduino.h"
+#include "config.h"
 #include "machine/carriage.h"
 
 class Pattern {
  private:
   int start_offset;
   int end_offset;
-  uint8_t* buffer;
+  const uint8_t* buffer;
+  bool buffer_in_flash;  // buffer points to program memory (PROGMEM)
 
  public:
-  Pattern();
+  // The full machine (0 to DEFAULT_MAX_NEEDLES), no buffer until set_buffer()
+  constexpr Pattern()
+      : start_offset(0),
+        end_offset(DEFAULT_MAX_NEEDLES),
+        buffer(nullptr),
+        buffer_in_flash(false) {}
   bool get_needle_state(int needle_in_pattern, CarriageDirection direction);
   bool read_bit_little_endian(int offset);
   int needle_index(int needle_in_pattern, CarriageDirection direction);
   void set_needle_range(uint8_t start_needle, uint8_t end_needle);
-  void set_buffer(uint8_t* buffer);
-  uint8_t* get_buffer() const { return buffer; }
+  void set_buffer(const uint8_t* buffer);
+  void set_flash_buffer(const uint8_t* buffer);
+  const uint8_t* get_buffer() const { return buffer; }
+  bool is_buffer_in_flash() const { return buffer_in_flash; }
   int get_start_offset() const { return start_offset; }
   int get_end_offset() const { return end_offset; }
   bool is_buffer_set() const { return buffer != nullptr; }
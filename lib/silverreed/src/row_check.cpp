@@ -0,0 +1,80 @@
+#include "row_check.h"
+
+void RowCheck::clear() {
+  /**
+   * Forget the rows checked in the previous session.
+   */
+  this->rows_with_errors = 0;
+  this->row_mismatches = 0;
+  this->start_row();
+}
+
+void RowCheck::start_row() {
+  /**
+   * Start recording a new row: every needle reads as LOW until recorded.
+   */
+  for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+    this->observed[i] = 0;
+  }
+}
+
+void RowCheck::record(int needle, bool level) {
+  /**
+   * Record the DOB level held on a needle. A needle passed several
+   * times in the row (carriage turning) keeps its last level.
+   *
+   * @param needle The needle number (bit offset in the row buffer).
+   */
+  if (needle < 0 || needle >= DEFAULT_MAX_NEEDLES) {
+    return;
+  }
+  uint8_t mask = 1 << (needle & BIT_INDEX_MASK);
+  if (level) {
+    this->observed[needle >> 3] |= mask;
+  } else {
+    this->observed[needle >> 3] &= ~mask;
+  }
+}
+
+uint16_t RowCheck::check_row(const uint8_t* row, bool row_in_flash,
+                             uint8_t start_needle, uint8_t end_needle) {
+  /**
+   * Compare the recorded levels with the row, on the needle range only.
+   *
+   * @param row The row buffer the needles were selected from, DOB levels.
+   * @param row_in_flash If the row is stored in program memory.
+   * @return The number of needles whose level differs from the row.
+   */
+  uint16_t mismatches = 0;
+  uint8_t first_byte = start_needle >> 3;
+  uint8_t last_byte = end_needle >> 3;
+  for (uint8_t i = first_byte; i <= last_byte; i++) {
+    uint8_t expected = row_in_flash ? pgm_read_byte(row + i) : row[i];
+    uint8_t difference = expected ^ this->observed[i];
+    if (i == first_byte) {
+      difference &= 0xFF << (start_needle & BIT_INDEX_MASK);
+    }
+    if (i == last_byte) {
+      difference &= 0xFF >> (BIT_INDEX_MASK - (end_needle & BIT_INDEX_MASK));
+    }
+    mismatches += count_bits(difference);
+  }
+
+  this->row_mismatches = mismatches;
+  if (mismatches != 0 && this->rows_with_errors < UINT16_MAX) {
+    this->rows_with_errors++;
+  }
+  return mismatches;
+}
+
+uint8_t RowCheck::count_bits(uint8_t value) {
+  /**
+   * Number of bits set, one iteration per bit set (usually none).
+   */
+  uint8_t count = 0;
+  while (value != 0) {
+    value &= value - 1;
+    count++;
+  }
+  return count;
+}
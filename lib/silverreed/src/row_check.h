@@ -0,0 +1,45 @@
+/**
+ * @file row_check.h
+ * @brief Closed-loop check of the needles selected in a row.
+ */
+#ifndef ROW_CHECK_H_
+#define ROW_CHECK_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "config.h"
+
+// What is reported to the host at the end of each row
+enum RowCheckReport { ROW_CHECK_OFF, ROW_CHECK_COUNT, ROW_CHECK_BITMAP };
+
+/**
+ * DOB level held at each needle of a row (sampled at the CCP edge of the next
+ * needle), compared with the row when the carriage leaves the pattern section.
+ *
+ * The levels are kept in the layout of the row buffer (bit n is needle n), so
+ * the comparison is an XOR of whole bytes. Needles the carriage did not
+ * select in the row (edges lost, turn in the pattern) read as LOW.
+ */
+class RowCheck {
+ private:
+  uint8_t observed[MAX_LINE_BUFFER_LEN];
+  uint16_t row_mismatches;    // Needles of the last checked row
+  uint16_t rows_with_errors;  // In the session
+
+ public:
+  constexpr RowCheck()
+      : observed(), row_mismatches(0), rows_with_errors(0) {}
+  void clear();
+  void start_row();
+  void record(int needle, bool level);
+  uint16_t check_row(const uint8_t* row, bool row_in_flash,
+                     uint8_t start_needle, uint8_t end_needle);
+  static uint8_t count_bits(uint8_t value);
+
+  const uint8_t* get_observed() const { return observed; }
+  uint16_t get_row_mismatches() const { return row_mismatches; }
+  uint16_t get_rows_with_errors() const { return rows_with_errors; }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "row_dictionary.h"
+
+#include <string.h>
+
+void RowDictionary::clear() {
+  /**
+   * Forget every row, done at the start of each knitting session.
+   */
+  this->valid_slots = 0;
+}
+
+bool RowDictionary::store(uint8_t slot, const uint8_t* line) {
+  /**
+   * Copy a row into a slot, replacing the previous one.
+   *
+   * @param slot The dictionary slot.
+   * @param line MAX_LINE_BUFFER_LEN bytes, already inverted.
+   * @return false if the slot does not exist.
+   */
+  if (slot >= ROW_DICTIONARY_SLOTS) {
+    return false;
+  }
+  memcpy(this->rows[slot], line, MAX_LINE_BUFFER_LEN);
+  this->valid_slots |= 1U << slot;
+  return true;
+}
+
+const uint8_t* RowDictionary::get(uint8_t slot) const {
+  /**
+   * @return The row stored in the slot, nullptr if the slot is empty.
+   */
+  if (slot >= ROW_DICTIONARY_SLOTS || !(this->valid_slots & (1U << slot))) {
+    return nullptr;
+  }
+  return this->rows[slot];
+}
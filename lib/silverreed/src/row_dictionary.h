@@ -0,0 +1,29 @@
+/**
+ * @file row_dictionary.h
+ * @brief Rows kept on the device to be referenced by a short message.
+ */
+#ifndef ROW_DICTIONARY_H_
+#define ROW_DICTIONARY_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * Small set of rows stored by the host along with a cnfLine, so that a
+ * repeated row can later be sent as a reference to its slot (cnfLineRef).
+ * Rows are stored inverted, ready to be installed in the Pattern.
+ */
+class RowDictionary {
+ private:
+  uint8_t rows[ROW_DICTIONARY_SLOTS][MAX_LINE_BUFFER_LEN];
+  uint8_t valid_slots;  // Bit n set when slot n holds a row
+
+ public:
+  constexpr RowDictionary() : rows(), valid_slots(0) {}
+  void clear();
+  bool store(uint8_t slot, const uint8_t* line);
+  const uint8_t* get(uint8_t slot) const;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "row_transform.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+namespace {
+
+// Bits of a nibble in reverse order (16 bytes instead of a 256 bytes table)
+const uint8_t REVERSED_NIBBLE[16] = {0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                     0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF};
+// Each bit of a nibble doubled: bit b goes to bits 2b and 2b + 1
+const uint8_t DOUBLED_NIBBLE[16] = {0x00, 0x03, 0x0C, 0x0F, 0x30, 0x33,
+                                    0x3C, 0x3F, 0xC0, 0xC3, 0xCC, 0xCF,
+                                    0xF0, 0xF3, 0xFC, 0xFF};
+
+void shift_up(const uint8_t* src, uint8_t* dst, uint8_t count) {
+  /**
+   * Move every bit `count` needles higher (needle n goes to n + count).
+   */
+  int bytes = count >> 3;
+  uint8_t bits = count & BIT_INDEX_MASK;
+  for (int i = MAX_LINE_BUFFER_LEN - 1; i >= 0; i--) {
+    uint8_t high = i - bytes >= 0 ? src[i - bytes] : 0;
+    uint8_t low = i - bytes - 1 >= 0 ? src[i - bytes - 1] : 0;
+    dst[i] = bits ? (high << bits) | (low >> (8 - bits)) : high;
+  }
+}
+
+void shift_down(const uint8_t* src, uint8_t* dst, uint8_t count) {
+  /**
+   * Move every bit `count` needles lower (needle n goes to n - count).
+   */
+  int bytes = count >> 3;
+  uint8_t bits = count & BIT_INDEX_MASK;
+  for (int i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+    uint8_t low = i + bytes < MAX_LINE_BUFFER_LEN ? src[i + bytes] : 0;
+    uint8_t high = i + bytes + 1 < MAX_LINE_BUFFER_LEN ? src[i + bytes + 1] : 0;
+    dst[i] = bits ? (low >> bits) | (high << (8 - bits)) : low;
+  }
+}
+
+void keep_first_bits(uint8_t* line, uint8_t width) {
+  /**
+   * Clear every bit from `width` onwards.
+   */
+  uint8_t first = width >> 3;
+  if (first >= MAX_LINE_BUFFER_LEN) {
+    return;
+  }
+  line[first] &= (1U << (width & BIT_INDEX_MASK)) - 1;
+  memset(line + first + 1, 0, MAX_LINE_BUFFER_LEN - first - 1);
+}
+
+}  // namespace
+
+bool RowTransform::configure(uint8_t flags, uint8_t row_repeat,
+                             uint8_t shift) {
+  /**
+   * Set the transform of the next knitting session.
+   *
+   * @param flags TRANSFORM_* flags.
+   * @param row_repeat Number of times each row is knitted (at least 1).
+   * @param shift Circular shift in needles, modulo the needle range width.
+   * @return false if the parameters are invalid, the transform is unchanged.
+   */
+  if ((flags & ~TRANSFORM_FLAGS_MASK) != 0 || row_repeat == 0) {
+    return false;
+  }
+  this->flags = flags;
+  this->row_repeat = row_repeat;
+  this->shift = shift;
+  return true;
+}
+
+void RowTransform::apply(const uint8_t* line, bool line_in_flash,
+                         uint8_t start_needle, uint8_t end_needle,
+                         uint8_t* output) const {
+  /**
+   * Transform a row of the needle bed into `output`.
+   * Only the needles of the range are meaningful in the output, like for the
+   * rows sent by the host.
+   *
+   * @param line MAX_LINE_BUFFER_LEN bytes, Pattern layout (inverted bits).
+   * @param line_in_flash If `line` is stored in program memory.
+   * @param start_needle The first needle of the pattern.
+   * @param end_needle The last needle of the pattern.
+   * @param output MAX_LINE_BUFFER_LEN bytes, overwritten.
+   */
+  uint8_t width = end_needle - start_needle + 1;
+  uint8_t row[MAX_LINE_BUFFER_LEN];
+  for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+    row[i] = line_in_flash ? pgm_read_byte(line + i) : line[i];
+  }
+
+  // Work relative to the range: start needle at bit 0, bits above the width
+  // cleared so that they cannot wrap into the range.
+  shift_down(row, output, start_needle);
+  if (this->flags & TRANSFORM_INVERT) {
+    for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+      output[i] = ~output[i];
+    }
+  }
+  keep_first_bits(output, width);
+
+  if (this->flags & TRANSFORM_DOUBLE_WIDTH) {
+    for (int8_t i = MAX_LINE_BUFFER_LEN - 1; i >= 0; i--) {
+      uint8_t source = output[i >> 1];
+      output[i] = DOUBLED_NIBBLE[(i & 1) ? source >> 4 : source & 0x0F];
+    }
+    keep_first_bits(output, width);
+  }
+
+  if (this->flags & TRANSFORM_MIRROR) {
+    // Reverse the 200 bits of the row, then bring the range back to bit 0
+    for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+      uint8_t source = output[MAX_LINE_BUFFER_LEN - 1 - i];
+      row[i] = (REVERSED_NIBBLE[source & 0x0F] << 4) |
+               REVERSED_NIBBLE[source >> 4];
+    }
+    shift_down(row, output, MAX_LINE_BUFFER_LEN * 8 - width);
+  }
+
+  uint8_t rotation = this->shift % width;
+  if (rotation != 0) {
+    uint8_t wrapped[MAX_LINE_BUFFER_LEN];
+    shift_up(output, row, rotation);
+    shift_down(output, wrapped, width - rotation);
+    for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+      row[i] |= wrapped[i];
+    }
+    keep_first_bits(row, width);
+    memcpy(output, row, MAX_LINE_BUFFER_LEN);
+  }
+
+  memcpy(row, output, MAX_LINE_BUFFER_LEN);
+  shift_up(row, output, start_needle);
+}
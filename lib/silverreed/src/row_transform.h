@@ -0,0 +1,48 @@
+/**
+ * @file row_transform.h
+ * @brief Transforms applied on the device to the rows sent by the host.
+ */
+#ifndef ROW_TRANSFORM_H_
+#define ROW_TRANSFORM_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+// Row transform flags (reqTransform)
+const uint8_t TRANSFORM_MIRROR = 0x01;
+const uint8_t TRANSFORM_INVERT = 0x02;
+const uint8_t TRANSFORM_DOUBLE_WIDTH = 0x04;
+const uint8_t TRANSFORM_FLAGS_MASK = 0x07;
+
+/**
+ * Per-session transform of the rows, relative to the needle range.
+ *
+ * Applied once when a row is installed, in this order: colour invert, 2x
+ * needle doubling (the first half of the range is stretched over the whole
+ * range), horizontal mirror, circular shift towards the higher needles. Each
+ * step works a byte at a time on the MAX_LINE_BUFFER_LEN bytes of the row, so
+ * the cost is bounded and nothing is done per needle.
+ *
+ * Row repetition (each row knitted `row_repeat` times) is handled by the
+ * knitting process.
+ */
+class RowTransform {
+ private:
+  uint8_t flags;
+  uint8_t row_repeat;
+  uint8_t shift;
+
+ public:
+  constexpr RowTransform() : flags(0), row_repeat(1), shift(0) {}
+  bool configure(uint8_t flags, uint8_t row_repeat, uint8_t shift);
+  void apply(const uint8_t* line, bool line_in_flash, uint8_t start_needle,
+             uint8_t end_needle, uint8_t* output) const;
+
+  bool is_identity() const { return flags == 0 && shift == 0; }
+  uint8_t get_flags() const { return flags; }
+  uint8_t get_row_repeat() const { return row_repeat; }
+  uint8_t get_shift() const { return shift; }
+};
+
+#endif
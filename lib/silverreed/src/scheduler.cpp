@@ -0,0 +1,81 @@
+#include "scheduler.h"
+
+#include <Arduino.h>
+
+Scheduler::Scheduler() : task_count(0) {}
+
+bool Scheduler::add_task(TaskFunction run, TaskPendingFunction is_pending,
+                         uint8_t priority, uint16_t budget_us) {
+  /**
+   * Register a task, kept sorted by priority (tasks of equal priority in the
+   * order they were added).
+   *
+   * @return false if SCHEDULER_MAX_TASKS tasks are already registered.
+   */
+  if (this->task_count >= SCHEDULER_MAX_TASKS || run == nullptr) {
+    return false;
+  }
+
+  uint8_t index = this->task_count;
+  while (index > 0 && this->tasks[index - 1].priority > priority) {
+    this->tasks[index] = this->tasks[index - 1];
+    index--;
+  }
+  this->tasks[index] =
+      SchedulerTask{run, is_pending, priority, budget_us, 0, 0};
+  this->task_count++;
+  return true;
+}
+
+bool Scheduler::run_once() {
+  /**
+   * Run the highest priority task with pending work, or the first slack time
+   * task when none has.
+   *
+   * @return false if no task ran.
+   */
+  SchedulerTask* selected = nullptr;
+  SchedulerTask* slack = nullptr;
+  for (uint8_t i = 0; i < this->task_count; i++) {
+    SchedulerTask& task = this->tasks[i];
+    if (task.is_pending == nullptr) {
+      if (slack == nullptr) {
+        slack = &task;
+      }
+    } else if (task.is_pending()) {
+      selected = &task;
+      break;
+    }
+  }
+  if (selected == nullptr) {
+    selected = slack;
+  }
+  if (selected == nullptr) {
+    return false;
+  }
+
+  unsigned long start = micros();
+  selected->run();
+  unsigned long duration = micros() - start;
+  if (duration > selected->max_run_us) {
+    selected->max_run_us = duration;
+  }
+  if (duration > selected->budget_us && selected->overruns < UINT16_MAX) {
+    selected->overruns++;
+  }
+  return true;
+}
+
+bool Scheduler::has_pending_task() const {
+  /**
+   * @return true if a task with a pending check has work (slack time tasks
+   * are not counted).
+   */
+  for (uint8_t i = 0; i < this->task_count; i++) {
+    const SchedulerTask& task = this->tasks[i];
+    if (task.is_pending != nullptr && task.is_pending()) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file scheduler.h
+ * @brief Cooperative scheduler running the firmware tasks by priority.
+ */
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+typedef void (*TaskFunction)();
+typedef bool (*TaskPendingFunction)();
+
+/**
+ * A task and its timing statistics.
+ */
+struct SchedulerTask {
+  TaskFunction run;
+  TaskPendingFunction is_pending;  // nullptr: runs in the slack time
+  uint8_t priority;                // 0 is the highest
+  uint16_t budget_us;              // Expected longest run
+  uint16_t overruns;               // Runs longer than the budget
+  unsigned long max_run_us;
+};
+
+/**
+ * Runs, on each call of run_once(), the highest priority task that has work
+ * pending. Tasks are not preempted: the latency of a high priority task is
+ * bounded by the longest run of the others, which is why every task does a
+ * bounded chunk of work per run (checked against its budget).
+ *
+ * Tasks without a pending check only run when no other task has work.
+ * Without such slack time tasks, run_once() returns false when there is no
+ * work, and the caller can sleep until the next interrupt.
+ */
+class Scheduler {
+ private:
+  SchedulerTask tasks[SCHEDULER_MAX_TASKS];
+  uint8_t task_count;
+
+ public:
+  Scheduler();
+  bool add_task(TaskFunction run, TaskPendingFunction is_pending,
+                uint8_t priority, uint16_t budget_us);
+  bool run_once();
+  bool has_pending_task() const;
+  uint8_t get_task_count() const { return task_count; }
+  const SchedulerTask& get_task(uint8_t index) const { return tasks[index]; }
+};
+
+#endif
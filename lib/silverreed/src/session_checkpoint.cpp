@@ -0,0 +1,157 @@
+#include "session_checkpoint.h"
+
+#include "crc.h"
+
+uint16_t SessionCheckpoint::record_address(uint8_t record) const {
+  return this->address +
+         static_cast<uint16_t>(record) * CHECKPOINT_RECORD_SIZE;
+}
+
+bool SessionCheckpoint::is_valid(uint8_t record) const {
+  /**
+   * @return true if the record is committed and its content is intact.
+   */
+  uint16_t base = this->record_address(record);
+  uint8_t state = this->storage.read(base);
+  if (state != CHECKPOINT_ACTIVE && state != CHECKPOINT_ENDED) {
+    return false;
+  }
+  uint8_t crc = 0x00U;
+  for (uint8_t i = 1; i < CHECKPOINT_RECORD_SIZE - 1; i++) {
+    crc = crc8_update(crc, this->storage.read(base + i));
+  }
+  return this->storage.read(base + CHECKPOINT_RECORD_SIZE - 1) == crc;
+}
+
+void SessionCheckpoint::scan() {
+  /**
+   * Find the committed record with the highest write sequence, once.
+   */
+  if (this->is_scanned) {
+    return;
+  }
+  this->is_scanned = true;
+  this->newest = -1;
+  for (uint8_t record = 0; record < this->records; record++) {
+    if (!this->is_valid(record)) {
+      continue;
+    }
+    uint8_t sequence = this->storage.read(this->record_address(record) + 1);
+    if (this->newest < 0 ||
+        static_cast<int8_t>(sequence - this->newest_sequence) > 0) {
+      this->newest = record;
+      this->newest_sequence = sequence;
+    }
+  }
+  if (this->newest < 0) {
+    return;
+  }
+  uint16_t base = this->record_address(this->newest);
+  this->newest_state = this->storage.read(base);
+  this->newest_record.start_needle = this->storage.read(base + 2);
+  this->newest_record.end_needle = this->storage.read(base + 3);
+  this->newest_record.flags = this->storage.read(base + 4);
+  this->newest_record.line = this->storage.read(base + 5);
+}
+
+void SessionCheckpoint::stage(uint8_t state, const CheckpointRecord& record) {
+  /**
+   * Prepare the write of a checkpoint. A checkpoint replacing one that is not
+   * completely written goes to the same record.
+   */
+  this->scan();
+  uint8_t sequence = this->newest < 0 ? 0 : this->newest_sequence + 1;
+  if (!this->is_pending()) {
+    this->pending_record =
+        this->newest < 0 ? 0 : (this->newest + 1) % this->records;
+  }
+
+  this->pending[0] = state;
+  this->pending[1] = sequence;
+  this->pending[2] = record.start_needle;
+  this->pending[3] = record.end_needle;
+  this->pending[4] = record.flags;
+  this->pending[5] = record.line;
+  uint8_t crc = 0x00U;
+  for (uint8_t i = 1; i < CHECKPOINT_RECORD_SIZE - 1; i++) {
+    crc = crc8_update(crc, this->pending[i]);
+  }
+  this->pending[CHECKPOINT_RECORD_SIZE - 1] = crc;
+  this->pending_step = 0;
+}
+
+void SessionCheckpoint::save(const CheckpointRecord& record) {
+  /**
+   * Keep the progress of the session. Nothing is written if it did not change
+   * since the last checkpoint.
+   */
+  CheckpointRecord current;
+  if (!this->is_pending() && this->load(current) &&
+      current.start_needle == record.start_needle &&
+      current.end_needle == record.end_needle &&
+      current.flags == record.flags && current.line == record.line) {
+    return;
+  }
+  this->stage(CHECKPOINT_ACTIVE, record);
+}
+
+void SessionCheckpoint::end_session() {
+  /**
+   * The session is finished: it is not offered for resuming any more.
+   */
+  if (this->is_pending()) {
+    this->pending[0] = CHECKPOINT_ENDED;
+    this->pending_step = 0;
+    return;
+  }
+  CheckpointRecord current;
+  if (this->load(current)) {
+    this->stage(CHECKPOINT_ENDED, current);
+  }
+}
+
+bool SessionCheckpoint::service() {
+  /**
+   * Write the next byte of the pending checkpoint, if the storage is ready:
+   * the state is invalidated first, then the content is written and the
+   * state committed last.
+   *
+   * @return true if a byte was written (or found unchanged).
+   */
+  if (!this->is_pending() || !this->storage.is_ready()) {
+    return false;
+  }
+  uint16_t base = this->record_address(this->pending_record);
+  if (this->pending_step == 0) {
+    if (this->newest == this->pending_record) {
+      this->newest = -1;  // Single record, overwritten
+    }
+    this->storage.update(base, CHECKPOINT_WRITING);
+  } else if (this->pending_step < CHECKPOINT_RECORD_SIZE) {
+    this->storage.update(base + this->pending_step,
+                         this->pending[this->pending_step]);
+  } else {
+    this->storage.update(base, this->pending[0]);
+    this->newest = this->pending_record;
+    this->newest_state = this->pending[0];
+    this->newest_sequence = this->pending[1];
+    this->newest_record = CheckpointRecord{this->pending[2], this->pending[3],
+                                           this->pending[4], this->pending[5]};
+  }
+  this->pending_step++;
+  return true;
+}
+
+bool SessionCheckpoint::load(CheckpointRecord& record) {
+  /**
+   * Read the last committed checkpoint.
+   *
+   * @return false if there is none, or if its session is finished.
+   */
+  this->scan();
+  if (this->newest < 0 || this->newest_state != CHECKPOINT_ACTIVE) {
+    return false;
+  }
+  record = this->newest_record;
+  return true;
+}
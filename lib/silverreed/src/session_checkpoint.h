@@ -0,0 +1,93 @@
+/**
+ * @file session_checkpoint.h
+ * @brief Knitting progress kept in persistent storage across resets.
+ */
+#ifndef SESSION_CHECKPOINT_H_
+#define SESSION_CHECKPOINT_H_
+
+#include <stdint.h>
+
+#include "config.h"
+#include "storage.h"
+
+/**
+ * What is needed to start a knitting session again from where it stopped.
+ */
+struct CheckpointRecord {
+  uint8_t start_needle;
+  uint8_t end_needle;
+  uint8_t flags;  // reqStart flags
+  uint8_t line;   // First line not completely knitted
+};
+
+/**
+ * Keeps the progress of the knitting session, so that it can be resumed
+ * after a reset (brown-out, USB disconnection).
+ *
+ * Each checkpoint goes to the record after the newest one, so the writes are
+ * spread over all the records. The write never waits for the storage: it is
+ * done one byte at a time by service() when the storage is ready, at most
+ * CHECKPOINT_WRITE_STEPS bytes per checkpoint (less, since unchanged bytes
+ * are not written). A record is committed by writing its state byte last, so
+ * a reset during a write keeps the previous checkpoint.
+ *
+ * The records are only scanned on the first use. The newest one is then kept
+ * in RAM, so saving at the end of a row reads nothing from the storage.
+ *
+ * Record layout:
+ *   0      state (CHECKPOINT_ACTIVE, CHECKPOINT_ENDED, anything else invalid)
+ *   1      write sequence
+ *   2-5    start needle, end needle, flags, line
+ *   6      CRC8 of bytes 1-5
+ */
+const uint8_t CHECKPOINT_RECORD_SIZE = 7;
+const uint8_t CHECKPOINT_WRITE_STEPS = CHECKPOINT_RECORD_SIZE + 1;
+const uint8_t CHECKPOINT_ACTIVE = 0xA5;
+const uint8_t CHECKPOINT_ENDED = 0x5A;
+const uint8_t CHECKPOINT_WRITING = 0x00;
+
+class SessionCheckpoint {
+ private:
+  Storage& storage;
+  uint16_t address;
+  uint8_t records;
+
+  // Record being written, CHECKPOINT_WRITE_STEPS when none
+  uint8_t pending[CHECKPOINT_RECORD_SIZE];
+  uint8_t pending_record;
+  uint8_t pending_step;
+
+  // Newest committed record, -1 when none, valid once scanned
+  bool is_scanned;
+  int8_t newest;
+  uint8_t newest_state;
+  uint8_t newest_sequence;
+  CheckpointRecord newest_record;
+
+  uint16_t record_address(uint8_t record) const;
+  bool is_valid(uint8_t record) const;
+  void scan();
+  void stage(uint8_t state, const CheckpointRecord& record);
+
+ public:
+  constexpr SessionCheckpoint(Storage& storage, uint16_t address,
+                              uint8_t records)
+      : storage(storage),
+        address(address),
+        records(records),
+        pending(),
+        pending_record(0),
+        pending_step(CHECKPOINT_WRITE_STEPS),
+        is_scanned(false),
+        newest(-1),
+        newest_state(0),
+        newest_sequence(0),
+        newest_record{0, 0, 0, 0} {}
+  void save(const CheckpointRecord& record);
+  void end_session();
+  bool service();
+  bool is_pending() const { return pending_step < CHECKPOINT_WRITE_STEPS; }
+  bool load(CheckpointRecord& record);
+};
+
+#endif
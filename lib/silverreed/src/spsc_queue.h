@@ -0,0 +1,83 @@
+/**
+ * @file spsc_queue.h
+ * @brief Lock-free single-producer single-consumer ring buffer.
+ */
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <stdint.h>
+
+/**
+ * Ring buffer shared by one producer (typically an interrupt handler) and one
+ * consumer (the loop), without disabling interrupts.
+ *
+ * Each index is written by one side only and is a single byte, so its update
+ * is atomic even on AVR; acquire/release ordering makes the slot contents
+ * visible before the index that publishes them. One slot is kept empty to
+ * tell a full queue from an empty one: SLOTS - 1 items fit.
+ *
+ * Items pushed while the queue is full are dropped and counted, the consumer
+ * collects the count with take_dropped().
+ */
+template <typename T, uint8_t SLOTS>
+class SpscQueue {
+  static_assert(SLOTS >= 2 && SLOTS <= 128 && (SLOTS & (SLOTS - 1)) == 0,
+                "SpscQueue slots must be a power of two up to 128");
+
+ private:
+  static constexpr uint8_t MASK = SLOTS - 1;
+
+  T slots[SLOTS];
+  uint8_t head = 0;     // Next slot to write, producer only
+  uint8_t tail = 0;     // Next slot to read, consumer only
+  uint8_t dropped = 0;  // Items dropped so far, producer only (wraps)
+  uint8_t dropped_seen = 0;  // Value of `dropped` last taken, consumer only
+
+ public:
+  bool push(const T& item) {
+    /**
+     * Producer side: add an item.
+     *
+     * @return false if the queue is full (the item is dropped).
+     */
+    uint8_t next = (this->head + 1) & MASK;
+    if (next == __atomic_load_n(&this->tail, __ATOMIC_ACQUIRE)) {
+      __atomic_store_n(&this->dropped, this->dropped + 1, __ATOMIC_RELEASE);
+      return false;
+    }
+    this->slots[this->head] = item;
+    __atomic_store_n(&this->head, next, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  bool pop(T& item) {
+    /**
+     * Consumer side: take the oldest item.
+     *
+     * @return false if the queue is empty.
+     */
+    if (this->tail == __atomic_load_n(&this->head, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    item = this->slots[this->tail];
+    __atomic_store_n(&this->tail, (this->tail + 1) & MASK, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  uint8_t take_dropped() {
+    /**
+     * Consumer side: items dropped since the previous call (up to 255).
+     */
+    uint8_t dropped = __atomic_load_n(&this->dropped, __ATOMIC_ACQUIRE);
+    uint8_t count = dropped - this->dropped_seen;
+    this->dropped_seen = dropped;
+    return count;
+  }
+
+  bool is_empty() const {
+    return this->tail == __atomic_load_n(&this->head, __ATOMIC_ACQUIRE);
+  }
+  static constexpr uint8_t capacity() { return SLOTS - 1; }
+};
+
+#endif
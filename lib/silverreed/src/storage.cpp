@@ -0,0 +1,22 @@
+#include "storage.h"
+
+#include <EEPROM.h>
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
+
+uint8_t EepromStorage::read(uint16_t address) const {
+  return EEPROM.read(address);
+}
+
+void EepromStorage::update(uint16_t address, uint8_t value) {
+  EEPROM.update(address, value);
+}
+
+bool EepromStorage::is_ready() const {
+#if defined(__AVR__)
+  return eeprom_is_ready();
+#else
+  return true;
+#endif
+}
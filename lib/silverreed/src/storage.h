@@ -0,0 +1,40 @@
+/**
+ * @file storage.h
+ * @brief Byte-addressed persistent storage (motif store, session checkpoint).
+ */
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+#include <stdint.h>
+
+/**
+ * Persistent storage backend. The firmware uses the MCU EEPROM, tests can
+ * provide a RAM simulation.
+ *
+ * Backends are never deleted through a Storage pointer: the destructor is not
+ * virtual, so that the global objects holding one have nothing to register
+ * for destruction.
+ */
+class Storage {
+ public:
+  virtual uint8_t read(uint16_t address) const = 0;
+  // Write a byte only if it differs from the stored one (saves wear)
+  virtual void update(uint16_t address, uint8_t value) = 0;
+  // true if a byte can be written without waiting for the previous write
+  virtual bool is_ready() const { return true; }
+
+ protected:
+  ~Storage() = default;
+};
+
+/**
+ * Storage backed by the Arduino EEPROM library.
+ */
+class EepromStorage : public Storage {
+ public:
+  uint8_t read(uint16_t address) const override;
+  void update(uint16_t address, uint8_t value) override;
+  bool is_ready() const override;
+};
+
+#endif
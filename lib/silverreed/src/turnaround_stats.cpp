@@ -0,0 +1,59 @@
+#include "turnaround_stats.h"
+
+void TurnaroundStats::clear() {
+  /**
+   * Forget every recorded turnaround.
+   */
+  this->count = 0;
+  this->stale_rows = 0;
+  this->min_us = 0xFFFFFFFFUL;
+  this->max_us = 0;
+  this->total_us = 0;
+  for (uint8_t i = 0; i < TURNAROUND_HISTOGRAM_BINS; i++) {
+    this->histogram[i] = 0;
+  }
+}
+
+void TurnaroundStats::record(uint32_t turnaround_us) {
+  /**
+   * Record the turnaround of one row.
+   *
+   * @param turnaround_us Time from the pattern section exit to the
+   * installation of the next row, in microseconds.
+   */
+  if (this->count == 0xFFFFU) {
+    return;  // Saturated, keep the statistics consistent
+  }
+  this->count++;
+  this->total_us += turnaround_us;
+  if (turnaround_us < this->min_us) {
+    this->min_us = turnaround_us;
+  }
+  if (turnaround_us > this->max_us) {
+    this->max_us = turnaround_us;
+  }
+  this->histogram[histogram_bin(turnaround_us)]++;
+}
+
+void TurnaroundStats::record_stale_row() {
+  /**
+   * Record a pass started before the next row arrived, i.e. knitted with the
+   * previous row.
+   */
+  if (this->stale_rows < 0xFFFFU) {
+    this->stale_rows++;
+  }
+}
+
+uint8_t TurnaroundStats::histogram_bin(uint32_t turnaround_us) {
+  /**
+   * @return The histogram bin of a turnaround (log2 of the milliseconds).
+   */
+  uint32_t turnaround_ms = turnaround_us / 1000U;
+  uint8_t bin = 0;
+  while (turnaround_ms > 0 && bin < TURNAROUND_HISTOGRAM_BINS - 1) {
+    turnaround_ms >>= 1;
+    bin++;
+  }
+  return bin;
+}
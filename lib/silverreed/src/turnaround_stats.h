@@ -0,0 +1,49 @@
+/**
+ * @file turnaround_stats.h
+ * @brief Row turnaround latency statistics.
+ */
+#ifndef TURNAROUND_STATS_H_
+#define TURNAROUND_STATS_H_
+
+#include <stdint.h>
+
+#include "config.h"
+
+/**
+ * Statistics on the time between the carriage leaving the pattern section
+ * and the next row being installed.
+ *
+ * Histogram bin 0 counts turnarounds below 1 ms, bin k (1 to n-2) those in
+ * [2^(k-1), 2^k) ms and the last bin everything above.
+ */
+class TurnaroundStats {
+ private:
+  uint16_t count;
+  uint16_t stale_rows;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint32_t total_us;
+  uint16_t histogram[TURNAROUND_HISTOGRAM_BINS];
+
+ public:
+  constexpr TurnaroundStats()
+      : count(0),
+        stale_rows(0),
+        min_us(0xFFFFFFFFUL),
+        max_us(0),
+        total_us(0),
+        histogram() {}
+  void clear();
+  void record(uint32_t turnaround_us);
+  void record_stale_row();
+  static uint8_t histogram_bin(uint32_t turnaround_us);
+
+  uint16_t get_count() const { return count; }
+  uint16_t get_stale_rows() const { return stale_rows; }
+  uint32_t get_min_us() const { return count ? min_us : 0; }
+  uint32_t get_max_us() const { return max_us; }
+  uint32_t get_average_us() const { return count ? total_us / count : 0; }
+  uint16_t get_histogram(uint8_t bin) const { return histogram[bin]; }
+};
+
+#endif
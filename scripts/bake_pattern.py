@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+"""
+Convert an image into a pattern compiled into the firmware (baked-in pattern).
+
+The generated header holds one row of the needle bed per image row, in the
+layout `Pattern::read_bit_little_endian` expects: little-endian bits (needle n
+is bit n % 8 of byte n / 8), inverted like the firmware does for `cnfLine`
+(0 selects a needle). The rows are stored in program memory (PROGMEM) and
+knitted in place by the `uno_baked` environment, so no host is needed.
+
+Dark pixels select the needle (contrast colour). The bottom row of the image
+is knitted first, like the knitted fabric grows from the bottom up.
+
+Supported images: PNG (8-bit or less, non interlaced) and PBM/PGM
+(netpbm, ASCII or binary).
+
+Usage:
+    python scripts/bake_pattern.py patterns/example.pbm -o src/baked_pattern.h
+    python scripts/bake_pattern.py motif.png --start-needle 80 --invert
+"""
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAX_NEEDLES = 200  # DEFAULT_MAX_NEEDLES in config.h
+LINE_BUFFER_LEN = 25  # MAX_LINE_BUFFER_LEN in config.h
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+
+
+def read_netpbm(data):
+    """Decode a PBM (P1/P4) or PGM (P2/P5) image into rows of 0-255 levels."""
+    magic = data[:2]
+    tokens = []
+    pos = 2
+    header_len = 2 if magic in (b"P1", b"P4") else 3  # width, height, maxval
+    while len(tokens) < header_len:
+        while data[pos : pos + 1].isspace():
+            pos += 1
+        if data[pos : pos + 1] == b"#":
+            pos = data.index(b"\n", pos)
+            continue
+        start = pos
+        while not data[pos : pos + 1].isspace():
+            pos += 1
+        tokens.append(data[start:pos])
+    pos += 1  # single whitespace before the raster
+    width, height = int(tokens[0]), int(tokens[1])
+    if magic == b"P1":
+        bits = [c for c in data[pos:].decode("ascii") if c in "01"]
+        levels = [0 if b == "1" else 255 for b in bits]
+    elif magic == b"P4":
+        stride = (width + 7) // 8
+        levels = []
+        for y in range(height):
+            row = data[pos + y * stride : pos + (y + 1) * stride]
+            levels += [
+                0 if row[x >> 3] & (0x80 >> (x & 7)) else 255 for x in range(width)
+            ]
+    elif magic in (b"P2", b"P5"):
+        maxval = int(tokens[2])
+        if magic == b"P2":
+            values = [int(v) for v in data[pos:].split()]
+        else:
+            values = list(data[pos : pos + width * height])
+        levels = [v * 255 // maxval for v in values]
+    else:
+        raise ValueError("unsupported netpbm format")
+    return [levels[y * width : (y + 1) * width] for y in range(height)]
+
+
+def paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(data):
+    """Decode a non interlaced PNG image into rows of 0-255 grey levels."""
+    pos = len(PNG_SIGNATURE)
+    idat = b""
+    palette = []
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos : pos + 8])
+        chunk = data[pos + 8 : pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(
+                ">IIBBBBB", chunk
+            )
+        elif kind == b"PLTE":
+            palette = [tuple(chunk[i : i + 3]) for i in range(0, length, 3)]
+        elif kind == b"IDAT":
+            idat += chunk
+        elif kind == b"IEND":
+            break
+    if depth > 8 or interlace:
+        raise ValueError("only non interlaced PNG up to 8 bits are supported")
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    bpp = max(1, channels * depth // 8)  # bytes per pixel for the filters
+    stride = (width * channels * depth + 7) // 8
+    raw = zlib.decompress(idat)
+
+    rows = []
+    previous = bytearray(stride)
+    for y in range(height):
+        filter_type = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1 : (y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - bpp] if i >= bpp else 0
+            b = previous[i]
+            c = previous[i - bpp] if i >= bpp else 0
+            if filter_type == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif filter_type == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif filter_type == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xFF
+            elif filter_type == 4:
+                line[i] = (line[i] + paeth(a, b, c)) & 0xFF
+        previous = line
+
+        # Unpack the samples (sub-byte depths are packed MSB first)
+        samples = []
+        mask = (1 << depth) - 1
+        for i in range(width * channels):
+            bit = i * depth
+            value = (line[bit >> 3] >> (8 - depth - (bit & 7))) & mask
+            samples.append(value if color == 3 else value * 255 // mask)
+        levels = []
+        for x in range(width):
+            pixel = samples[x * channels : (x + 1) * channels]
+            if color == 3:
+                rgb, alpha = palette[pixel[0]], 255
+            elif color in (0, 4):
+                rgb, alpha = pixel[:1] * 3, pixel[1] if color == 4 else 255
+            else:
+                rgb, alpha = pixel[:3], pixel[3] if color == 6 else 255
+            if alpha < 128:
+                levels.append(255)  # transparent pixels are background
+                continue
+            levels.append((rgb[0] * 299 + rgb[1] * 587 + rgb[2] * 114) // 1000)
+        rows.append(levels)
+    return rows
+
+
+def read_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(PNG_SIGNATURE):
+        return read_png(data)
+    if data[:2] in (b"P1", b"P2", b"P4", b"P5"):
+        return read_netpbm(data)
+    raise ValueError(f"{path}: unsupported image format (PNG, PBM or PGM)")
+
+
+def pack_row(levels, start_needle, threshold, invert):
+    """Pack one image row into an inverted little-endian needle bed row."""
+    line = bytearray(b"\xff" * LINE_BUFFER_LEN)
+    for x, level in enumerate(levels):
+        selected = (level < threshold) != invert
+        if selected:
+            needle = start_needle + x
+            line[needle >> 3] &= ~(1 << (needle & 7))
+    return line
+
+
+def bake(image_path, output_path, start_needle=None, threshold=128, invert=False):
+    """Write the header holding the image baked into flash."""
+    rows = read_image(image_path)
+    width = len(rows[0])
+    if width > MAX_NEEDLES:
+        raise ValueError(f"image is {width} pixels wide, max {MAX_NEEDLES}")
+    if start_needle is None:
+        start_needle = (MAX_NEEDLES - width) // 2  # centred on the bed
+    end_needle = start_needle + width - 1
+    if start_needle < 0 or end_needle >= MAX_NEEDLES:
+        raise ValueError("pattern does not fit on the needle bed")
+
+    lines = [
+        pack_row(levels, start_needle, threshold, invert)
+        for levels in reversed(rows)  # bottom row knitted first
+    ]
+    body = ",\n".join(
+        "    {" + ", ".join(f"0x{b:02X}" for b in line) + "}" for line in lines
+    )
+    header = f"""\
+// Generated by scripts/bake_pattern.py from {os.path.basename(image_path)},
+// do not edit.
+#ifndef BAKED_PATTERN_H_
+#define BAKED_PATTERN_H_
+
+#include <Arduino.h>
+
+#include "config.h"
+
+const uint16_t BAKED_PATTERN_ROWS = {len(lines)};
+const uint8_t BAKED_PATTERN_START_NEEDLE = {start_needle};
+const uint8_t BAKED_PATTERN_END_NEEDLE = {end_needle};
+
+const uint8_t baked_pattern[BAKED_PATTERN_ROWS][MAX_LINE_BUFFER_LEN] PROGMEM = {{
+{body}}};
+
+#endif
+"""
+    with open(output_path, "w") as f:
+        f.write(header)
+    return len(lines), start_needle, end_needle
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("image", help="PNG, PBM or PGM image")
+    parser.add_argument(
+        "-o", "--output", default="src/baked_pattern.h", help="generated header"
+    )
+    parser.add_argument(
+        "--start-needle",
+        type=int,
+        default=None,
+        help="needle of the first image column (default: centred)",
+    )
+    parser.add_argument(
+        "--threshold",
+        type=int,
+        default=128,
+        help="grey level below which a pixel selects the needle",
+    )
+    parser.add_argument(
+        "--invert", action="store_true", help="light pixels select the needle"
+    )
+    args = parser.parse_args()
+
+    try:
+        rows, start, end = bake(
+            args.image, args.output, args.start_needle, args.threshold, args.invert
+        )
+    except (OSError, ValueError) as error:
+        print(f"bake_pattern: {error}", file=sys.stderr)
+        return 1
+    print(
+        f"{args.output}: {rows} rows, needles {start}-{end}, "
+        f"{rows * LINE_BUFFER_LEN} bytes of flash"
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
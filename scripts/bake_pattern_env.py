@@ -0,0 +1,23 @@
+"""
+PlatformIO pre-build script of the `uno_baked` environment.
+
+Generates src/baked_pattern.h from the image set by the `custom_pattern_image`
+option (and optionally `custom_pattern_start_needle`), see bake_pattern.py.
+"""
+import os
+import sys
+
+Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+
+project_dir = env["PROJECT_DIR"]  # noqa: F821
+sys.path.insert(0, os.path.join(project_dir, "scripts"))
+from bake_pattern import bake  # noqa: E402
+
+image = env.GetProjectOption("custom_pattern_image")  # noqa: F821
+start_needle = env.GetProjectOption("custom_pattern_start_needle", "")  # noqa: F821
+rows, start, end = bake(
+    os.path.join(project_dir, image),
+    os.path.join(project_dir, "src", "baked_pattern.h"),
+    int(start_needle) if start_needle else None,
+)
+print(f"Baked {image}: {rows} rows, needles {start}-{end}")
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""
+Report of the latency added by the carriage signal filters against the noise
+they reject.
+
+The CCP line is simulated at the sample rate of the firmware
+(SIGNAL_SAMPLE_PERIOD_US) for a carriage at a given speed, with glitches of
+random widths injected at random times. Each filter of `SignalFilter` (same
+algorithms as machine/signal_filter.cpp) counts the needles from the noisy
+samples; a needle counted too many or too few shifts the rest of the row.
+Count errors are the difference between the needles counted and the real ones.
+
+For each filter the report gives the delay it adds to every edge, that delay
+as a share of the half CCP period (the DOB write must still happen within the
+needle), the glitches rejected, and the needle count errors per 1000 needles.
+
+Usage:
+    python scripts/glitch_filter_report.py
+    python scripts/glitch_filter_report.py --speed 250 --glitch-rate 2 \\
+        --max-glitch-us 300
+"""
+import argparse
+import random
+import sys
+
+SAMPLE_PERIOD_US = 100  # SIGNAL_SAMPLE_PERIOD_US in config.h
+MAX_SAFE_NEEDLES_PER_SECOND = 250  # config.h, placeholder until measured
+
+INTEGRATOR = "integrator"
+MAJORITY = "majority"
+FILTERS = [
+    (INTEGRATOR, 0),
+    (INTEGRATOR, 2),
+    (INTEGRATOR, 3),
+    (INTEGRATOR, 4),
+    (INTEGRATOR, 6),
+    (MAJORITY, 3),
+    (MAJORITY, 5),
+    (MAJORITY, 7),
+]
+
+
+class SignalFilter:
+    """Python port of SignalFilter::sample()."""
+
+    def __init__(self, mode, depth):
+        self.mode = mode
+        self.depth = depth
+        self.state = False
+        self.count = 0  # integrator count or history bits
+        self.is_glitch = False
+        self.rejected = 0
+
+    def latency_samples(self):
+        if self.depth <= 1:
+            return 0
+        return self.depth // 2 + 1 if self.mode == MAJORITY else self.depth
+
+    def sample(self, raw):
+        if self.depth <= 1:
+            self.state = raw
+            return raw
+        new_state = self.state
+        if self.mode == MAJORITY:
+            mask = (1 << self.depth) - 1
+            self.count = ((self.count << 1) | raw) & mask
+            new_state = bin(self.count).count("1") > self.depth // 2
+            at_rest = self.count == (mask if new_state else 0)
+        else:
+            if raw and self.count < self.depth:
+                self.count += 1
+            elif not raw and self.count > 0:
+                self.count -= 1
+            if self.count == self.depth:
+                new_state = True
+            elif self.count == 0:
+                new_state = False
+            at_rest = self.count == (self.depth if new_state else 0)
+
+        if new_state != self.state:
+            self.state = new_state
+            self.is_glitch = False
+        elif raw != self.state:
+            self.is_glitch = True
+        elif at_rest and self.is_glitch:
+            self.is_glitch = False
+            self.rejected += 1
+        return self.state
+
+
+def noisy_ccp(needles, speed, glitch_rate, max_glitch_us, rng):
+    """
+    Samples of a CCP line: `needles` square periods at `speed` needles per
+    second, with on average `glitch_rate` glitches per needle, each inverting
+    the line for 1 us to `max_glitch_us`.
+    """
+    period_us = 1e6 / speed
+    duration_us = needles * period_us
+    glitches = []
+    t = rng.expovariate(glitch_rate / period_us)
+    while t < duration_us:
+        glitches.append((t, t + rng.uniform(1, max_glitch_us)))
+        t += rng.expovariate(glitch_rate / period_us)
+
+    samples = []
+    g = 0
+    t = 0.0
+    while t < duration_us:
+        level = (t % period_us) < period_us / 2
+        while g < len(glitches) and glitches[g][1] < t:
+            g += 1
+        if g < len(glitches) and glitches[g][0] <= t:
+            level = not level
+        samples.append(level)
+        t += SAMPLE_PERIOD_US
+    return samples, len(glitches)
+
+
+def run(needles, speed, glitch_rate, max_glitch_us, seed):
+    rng = random.Random(seed)
+    samples, injected = noisy_ccp(
+        needles, speed, glitch_rate, max_glitch_us, rng
+    )
+    half_period_us = 1e6 / speed / 2
+
+    print(
+        f"{needles} needles at {speed} needles/s, {injected} glitches of "
+        f"1-{max_glitch_us} us, sampled every {SAMPLE_PERIOD_US} us"
+    )
+    print(
+        f"{'filter':<14} {'latency':>8} {'of half':>8} {'rejected':>9} "
+        f"{'errors':>7} {'/1000':>6}"
+    )
+    for mode, depth in FILTERS:
+        flt = SignalFilter(mode, depth)
+        edges = 0
+        previous = False
+        for raw in samples:
+            state = flt.sample(raw)
+            edges += state and not previous
+            previous = state
+        latency_us = flt.latency_samples() * SAMPLE_PERIOD_US
+        errors = abs(edges - needles)
+        share = 100 * latency_us / half_period_us
+        name = "none" if depth <= 1 else f"{mode} {depth}"
+        print(
+            f"{name:<14} {latency_us:>5} us {share:>7.0f}% {flt.rejected:>9} "
+            f"{errors:>7} {1000 * errors / needles:>6.1f}"
+        )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("--needles", type=int, default=2000)
+    parser.add_argument(
+        "--speed",
+        type=int,
+        default=MAX_SAFE_NEEDLES_PER_SECOND,
+        help="carriage speed in needles per second",
+    )
+    parser.add_argument(
+        "--glitch-rate", type=float, default=1.0, help="glitches per needle"
+    )
+    parser.add_argument(
+        "--max-glitch-us", type=int, default=250, help="longest glitch"
+    )
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+    if args.speed <= 0 or args.needles <= 0:
+        print(
+            "glitch_filter_report: speed and needles must be positive",
+            file=sys.stderr,
+        )
+        return 1
+    run(
+        args.needles, args.speed, args.glitch_rate, args.max_glitch_us, args.seed
+    )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
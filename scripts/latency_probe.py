@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+Round-trip latency probe for the AYAB serial link.
+
+Sends reqPing messages to the firmware and measures, for each of them:
+- the round trip time seen by the host,
+- the device processing time (send - receive timestamps of cnfPing),
+- the link time (round trip minus device processing time).
+
+Works against real hardware (e.g. /dev/ttyACM0) or any pty exposing the
+firmware, such as a simulator. `--simulate` starts an in-process simulated
+firmware behind a pty to check the tool itself.
+
+Usage:
+    python scripts/latency_probe.py /dev/ttyACM0 --count 500
+    python scripts/latency_probe.py --simulate
+"""
+import argparse
+import os
+import statistics
+import struct
+import sys
+import threading
+import time
+
+import serial
+
+REQ_PING = 0x08
+CNF_PING = 0xC8
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+SLIP_ESC_END = 0xDC
+SLIP_ESC_ESC = 0xDD
+
+
+def slip_encode(payload):
+    """Encode a payload in a SLIP frame."""
+    encoded = bytearray([SLIP_END])
+    for byte in payload:
+        if byte == SLIP_END:
+            encoded += bytes([SLIP_ESC, SLIP_ESC_END])
+        elif byte == SLIP_ESC:
+            encoded += bytes([SLIP_ESC, SLIP_ESC_ESC])
+        else:
+            encoded.append(byte)
+    encoded.append(SLIP_END)
+    return bytes(encoded)
+
+
+class SlipReader:
+    """Incremental SLIP decoder."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.escaped = False
+
+    def feed(self, data):
+        """Feed raw bytes and return the list of complete packets."""
+        packets = []
+        for byte in data:
+            if self.escaped:
+                self.buffer.append(SLIP_END if byte == SLIP_ESC_END else SLIP_ESC)
+                self.escaped = False
+            elif byte == SLIP_ESC:
+                self.escaped = True
+            elif byte == SLIP_END:
+                if self.buffer:
+                    packets.append(bytes(self.buffer))
+                self.buffer.clear()
+            else:
+                self.buffer.append(byte)
+        return packets
+
+
+def simulated_firmware(fd, processing_us, stop):
+    """Answer reqPing on a pty like the firmware does."""
+    reader = SlipReader()
+    start = time.perf_counter_ns()
+    while not stop.is_set():
+        try:
+            data = os.read(fd, 256)
+        except OSError:
+            return
+        for packet in reader.feed(data):
+            if packet[0] != REQ_PING:
+                continue
+            receive_us = (time.perf_counter_ns() - start) // 1000
+            time.sleep(processing_us / 1e6)
+            send_us = (time.perf_counter_ns() - start) // 1000
+            sequence = packet[1] if len(packet) > 1 else 0
+            answer = struct.pack(
+                ">BBII", CNF_PING, sequence, receive_us & 0xFFFFFFFF,
+                send_us & 0xFFFFFFFF
+            )
+            os.write(fd, slip_encode(answer))
+
+
+def ping(port, reader, sequence, timeout):
+    """Send one reqPing and wait for the matching cnfPing.
+
+    Returns (round trip us, device processing us) or None on timeout.
+    """
+    sent = time.perf_counter_ns()
+    port.write(slip_encode(bytes([REQ_PING, sequence])))
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        for packet in reader.feed(port.read(port.in_waiting or 1)):
+            if len(packet) < 10 or packet[0] != CNF_PING or packet[1] != sequence:
+                continue  # other messages (indState, debug...) are ignored
+            round_trip = (time.perf_counter_ns() - sent) / 1000
+            _, _, receive_us, send_us = struct.unpack(">BBII", packet[:10])
+            processing = (send_us - receive_us) & 0xFFFFFFFF
+            return round_trip, processing
+    return None
+
+
+def percentile(values, ratio):
+    """Nearest-rank percentile of a sorted list."""
+    index = min(len(values) - 1, max(0, round(ratio * (len(values) - 1))))
+    return values[index]
+
+
+def report(name, values):
+    """Print the distribution of a list of durations in microseconds."""
+    values = sorted(values)
+    print(
+        f"{name:<18} min {values[0]:9.1f}  p50 {percentile(values, 0.5):9.1f}"
+        f"  p95 {percentile(values, 0.95):9.1f}"
+        f"  p99 {percentile(values, 0.99):9.1f}  max {values[-1]:9.1f} us"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("port", nargs="?", help="serial port or pty path")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--count", type=int, default=200)
+    parser.add_argument("--interval", type=float, default=0.01,
+                        help="delay between pings in seconds")
+    parser.add_argument("--timeout", type=float, default=0.5)
+    parser.add_argument("--simulate", action="store_true",
+                        help="probe an in-process simulated firmware on a pty")
+    parser.add_argument("--processing-us", type=int, default=50,
+                        help="simulated device processing time")
+    args = parser.parse_args()
+
+    stop = threading.Event()
+    if args.simulate:
+        master, slave = os.openpty()
+        threading.Thread(
+            target=simulated_firmware,
+            args=(master, args.processing_us, stop),
+            daemon=True,
+        ).start()
+        args.port = os.ttyname(slave)
+    elif args.port is None:
+        parser.error("a port is required unless --simulate is used")
+
+    # Opening the port resets the Uno; leave it time to boot.
+    port = serial.Serial(args.port, args.baudrate, timeout=0.01)
+    if not args.simulate:
+        time.sleep(2)
+    port.reset_input_buffer()
+
+    reader = SlipReader()
+    round_trips, processing, link, lost = [], [], [], 0
+    for i in range(args.count):
+        result = ping(port, reader, i & 0xFF, args.timeout)
+        if result is None:
+            lost += 1
+        else:
+            round_trips.append(result[0])
+            processing.append(result[1])
+            link.append(result[0] - result[1])
+        time.sleep(args.interval)
+    stop.set()
+    port.close()
+
+    print(f"{len(round_trips)} answers, {lost} lost")
+    if len(round_trips) < 2:
+        return 1
+    report("round trip", round_trips)
+    report("device processing", processing)
+    report("link", link)
+    jitter = statistics.fmean(
+        abs(a - b) for a, b in zip(round_trips, round_trips[1:])
+    )
+    print(f"{'jitter':<18} {jitter:.1f} us (mean successive difference), "
+          f"stdev {statistics.stdev(round_trips):.1f} us")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
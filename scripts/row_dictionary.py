@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""
+Host-side encoder for the row dictionary, with a bytes-on-wire benchmark.
+
+Repeated rows are sent once as a full cnfLine that also stores them in a
+dictionary slot of the firmware, then as 4-byte cnfLineRef messages. The
+encoder knows the whole pattern in advance and fills the dictionary greedily:
+a row is stored only if it is knitted again, evicting the slot whose row is
+needed the furthest in the future (or never again).
+
+The benchmark compares the SLIP-framed bytes sent with and without the
+dictionary for every pattern image given (PNG, PBM or PGM, see
+bake_pattern.py), or for a few built-in patterns when none is given.
+
+Usage:
+    python scripts/row_dictionary.py patterns/example.pbm my_jacquard.png
+    python scripts/row_dictionary.py --slots 8
+"""
+import argparse
+import os
+import random
+import re
+import sys
+
+from bake_pattern import LINE_BUFFER_LEN, MAX_NEEDLES, read_image
+
+CNF_LINE = 0x42  # AYAB_API::cnfLine in ayab.h
+CNF_LINE_REF = 0xD2  # AYAB_API::cnfLineRef in ayab.h
+LAST_LINE_FLAG = 0x01
+STORE_ROW_FLAG = 0x02
+STORE_ROW_SLOT_SHIFT = 4
+LINE_REF_LAST_LINE_FLAG = 0x80
+DICTIONARY_SLOTS = 4  # ROW_DICTIONARY_SLOTS in config.h
+
+SLIP_END = 0xC0
+SLIP_ESC = 0xDB
+
+
+AYAB_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lib",
+                      "silverreed", "src", "communication", "ayab.h")
+
+
+def check_opcodes(path=AYAB_H):
+    """Compare the opcodes used here with the AYAB_API enum of the firmware.
+
+    Returns the list of mismatches, empty when they agree.
+    """
+    with open(path, encoding="utf-8") as header:
+        source = header.read()
+    errors = []
+    for name, value in (("cnfLine", CNF_LINE), ("cnfLineRef", CNF_LINE_REF)):
+        match = re.search(rf"\b{name}\s*=\s*(0x[0-9A-Fa-f]+)", source)
+        if match is None:
+            errors.append(f"{name} not found in {path}")
+        elif int(match.group(1), 16) != value:
+            errors.append(f"{name} is {match.group(1)} in the firmware, "
+                          f"0x{value:02X} here")
+    return errors
+
+
+def crc8(data):
+    """CRC-8 (Dallas/Maxim, reflected 0x31) as computed by the firmware."""
+    crc = 0
+    for byte in data:
+        for _ in range(8):
+            mix = (crc ^ byte) & 0x01
+            crc >>= 1
+            if mix:
+                crc ^= 0x8C
+            byte >>= 1
+    return crc
+
+
+def slip_size(payload):
+    """Bytes on the wire for a SLIP frame (escapes and END byte included)."""
+    return len(payload) + 1 + sum(b in (SLIP_END, SLIP_ESC) for b in payload)
+
+
+def cnf_line(line_number, row, last, slot=None):
+    flags = LAST_LINE_FLAG if last else 0
+    if slot is not None:
+        flags |= STORE_ROW_FLAG | (slot << STORE_ROW_SLOT_SHIFT)
+    message = bytes([CNF_LINE, line_number & 0xFF, 0, flags]) + row
+    return message + bytes([crc8(message)])
+
+
+def cnf_line_ref(line_number, slot, last):
+    slot_byte = slot | (LINE_REF_LAST_LINE_FLAG if last else 0)
+    message = bytes([CNF_LINE_REF, line_number & 0xFF, slot_byte])
+    return message + bytes([crc8(message)])
+
+
+def encode(rows, slots=DICTIONARY_SLOTS):
+    """
+    Encode the rows of a pattern (bytes of LINE_BUFFER_LEN each, in knitting
+    order) into the messages answering each reqLine.
+    """
+    # Position of the next use of each row, computed backwards
+    next_use = [0] * len(rows)
+    seen = {}
+    for index in range(len(rows) - 1, -1, -1):
+        next_use[index] = seen.get(rows[index], len(rows))
+        seen[rows[index]] = index
+
+    dictionary = {}  # row -> slot
+    slot_next_use = {}  # slot -> position of the next use of its row
+    messages = []
+    for index, row in enumerate(rows):
+        last = index == len(rows) - 1
+        if row in dictionary:
+            slot = dictionary[row]
+            messages.append(cnf_line_ref(index, slot, last))
+            slot_next_use[slot] = next_use[index]
+            continue
+
+        slot = None
+        if next_use[index] < len(rows):
+            # Knitted again: store it, in a free slot or instead of the row
+            # needed the furthest away, if that one is needed later than this
+            if len(dictionary) < slots:
+                slot = len(dictionary)
+            else:
+                victim = max(slot_next_use, key=slot_next_use.get)
+                if slot_next_use[victim] > next_use[index]:
+                    slot = victim
+                    del dictionary[
+                        next(r for r, s in dictionary.items() if s == victim)
+                    ]
+        if slot is not None:
+            dictionary[row] = slot
+            slot_next_use[slot] = next_use[index]
+        messages.append(cnf_line(index, row, last, slot))
+    return messages
+
+
+def image_rows(path):
+    """Rows of a pattern image, packed like AYAB Desktop sends them."""
+    levels = read_image(path)
+    width = len(levels[0])
+    start = (MAX_NEEDLES - width) // 2
+    rows = []
+    for line in reversed(levels):
+        row = bytearray(LINE_BUFFER_LEN)
+        for x, level in enumerate(line):
+            if level < 128:
+                needle = start + x
+                row[needle >> 3] |= 1 << (needle & 7)
+        rows.append(bytes(row))
+    return rows
+
+
+def builtin_patterns():
+    """Representative patterns when no image is given."""
+    rng = random.Random(1)
+
+    def row(bits):
+        return bytes(
+            sum(bits[(i * 8 + b) % len(bits)] << b for b in range(8))
+            for i in range(LINE_BUFFER_LEN)
+        )
+
+    motif = [[rng.randint(0, 1) for _ in range(24)] for _ in range(16)]
+    stripes = [row([1] * 4 + [0] * 4), row([0] * 8)]
+    return {
+        "24x16 repeat, 200 rows": [row(motif[i % 16]) for i in range(200)],
+        "2-row stripes, 200 rows": [stripes[(i // 6) % 2] for i in range(200)],
+        "random noise, 200 rows": [
+            row([rng.randint(0, 1) for _ in range(200)]) for _ in range(200)
+        ],
+    }
+
+
+def benchmark(patterns, slots):
+    print(f"{'pattern':<32} {'rows':>5} {'unique':>6} {'full':>7} "
+          f"{'dict':>7} {'saved':>6}")
+    for name, rows in patterns.items():
+        full = sum(slip_size(cnf_line(i, r, False)) for i, r in enumerate(rows))
+        encoded = sum(slip_size(m) for m in encode(rows, slots))
+        saved = 100.0 * (full - encoded) / full
+        print(f"{name:<32} {len(rows):>5} {len(set(rows)):>6} {full:>7} "
+              f"{encoded:>7} {saved:>5.1f}%")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("images", nargs="*", help="PNG, PBM or PGM patterns")
+    parser.add_argument(
+        "--slots",
+        type=int,
+        default=DICTIONARY_SLOTS,
+        help="dictionary slots of the firmware (ROW_DICTIONARY_SLOTS)",
+    )
+    parser.add_argument(
+        "--check",
+        action="store_true",
+        help="only check the opcodes against the firmware (ayab.h)",
+    )
+    args = parser.parse_args()
+
+    try:
+        errors = check_opcodes()
+    except OSError as error:
+        errors = [] if not args.check else [str(error)]
+    for error in errors:
+        print(f"row_dictionary: {error}", file=sys.stderr)
+    if errors:
+        return 1
+    if args.check:
+        print("row_dictionary: opcodes match the firmware")
+        return 0
+
+    if args.images:
+        try:
+            patterns = {path: image_rows(path) for path in args.images}
+        except (OSError, ValueError) as error:
+            print(f"row_dictionary: {error}", file=sys.stderr)
+            return 1
+    else:
+        patterns = builtin_patterns()
+    benchmark(patterns, args.slots)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+Flash and RAM used by the firmware at several git revisions.
+
+Each revision is checked out in a temporary worktree and built with
+`pio run -t size`. The sizes are printed with their difference to the first
+revision, to back a change with its effect on the firmware.
+
+Usage:
+    python scripts/size_report.py 83d78fe~1 83d78fe
+    python scripts/size_report.py main HEAD --env uno_baked
+"""
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SIZE_LINE = re.compile(r"^(RAM|Flash):.*\(used (\d+) bytes from (\d+) bytes\)")
+
+
+def build_size(repository, revision, env):
+    """Build `revision` and return {"RAM": bytes, "Flash": bytes}."""
+    worktree = tempfile.mkdtemp(prefix="size_report_")
+    try:
+        subprocess.run(
+            ["git", "-C", repository, "worktree", "add", "--detach", worktree,
+             revision],
+            check=True, capture_output=True)
+        build = subprocess.run(
+            ["pio", "run", "-d", worktree, "-e", env, "-t", "size"],
+            check=True, capture_output=True, text=True)
+    finally:
+        subprocess.run(
+            ["git", "-C", repository, "worktree", "remove", "--force",
+             worktree],
+            capture_output=True)
+        shutil.rmtree(worktree, ignore_errors=True)
+    sizes = {}
+    for line in build.stdout.splitlines():
+        match = SIZE_LINE.match(line.strip())
+        if match:
+            sizes[match.group(1)] = int(match.group(2))
+    if len(sizes) != 2:
+        raise ValueError(f"{revision}: no size in the output of pio run")
+    return sizes
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[1])
+    parser.add_argument("revisions", nargs="+", help="git revisions to build")
+    parser.add_argument("--env", default="uno", help="PlatformIO environment")
+    args = parser.parse_args()
+
+    repository = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    try:
+        sizes = [build_size(repository, revision, args.env)
+                 for revision in args.revisions]
+    except (OSError, ValueError, subprocess.CalledProcessError) as error:
+        print(f"size_report: {error}", file=sys.stderr)
+        return 1
+
+    print(f"{'revision':<24} {'flash':>7} {'delta':>7} {'RAM':>6} {'delta':>6}")
+    for revision, size in zip(args.revisions, sizes):
+        flash_delta = size["Flash"] - sizes[0]["Flash"]
+        ram_delta = size["RAM"] - sizes[0]["RAM"]
+        print(f"{revision:<24} {size['Flash']:>7} {flash_delta:>+7} "
+              f"{size['RAM']:>6} {ram_delta:>+6}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
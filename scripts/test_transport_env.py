@@ -0,0 +1,17 @@
+"""
+PlatformIO pre-build script of the board environments.
+
+For `pio test` only, wraps the transport of the AYAB protocol in the one of
+test/test_embedded/capture_transport.h, which keeps the packets the firmware
+sent for the tests to check. The firmware builds are left untouched.
+"""
+import os
+
+Import("env")  # noqa: F821 (provided by PlatformIO/SCons)
+
+if "test" in env.GetBuildType():  # noqa: F821
+    project_dir = env["PROJECT_DIR"]  # noqa: F821
+    env.Append(  # noqa: F821
+        CPPDEFINES=["AYAB_TRANSPORT_CAPTURE"],
+        CPPPATH=[os.path.join(project_dir, "test", "test_embedded")],
+    )
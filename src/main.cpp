@@ -3,17 +3,59 @@
  */
 #include <Arduino.h>
 
+#include "boot_timing.h"
 #include "communication/ayab.h"
 #include "config.h"
 #include "debug.h"
 #include "knitting.h"
+#include "machine/carriage_events.h"
+#include "machine/idle_sleep.h"
+#include "scheduler.h"
+#ifdef BAKED_PATTERN
+#include "baked_pattern.h"  // Generated by scripts/bake_pattern.py
+#endif
+
+// Task priorities, 0 is the highest
+enum TaskPriority : uint8_t {
+  CARRIAGE_PRIORITY = 0,
+  PROTOCOL_PRIORITY = 1,
+  ROW_REQUEST_PRIORITY = 2,
+  HOUSEKEEPING_PRIORITY = 3
+};
+
+Scheduler scheduler;
+unsigned long last_housekeeping_ms = 0;
+
+void service_carriage() { KnittingProcess.service_carriage_events(); }
+
+bool is_carriage_pending() { return CarriageEvents::is_pending(); }
+
+void service_protocol() { Ayab.poll_serial(PROTOCOL_RX_CHUNK_BYTES); }
+
+bool is_protocol_pending() { return Ayab.has_serial_input(); }
+
+void service_row_request() { KnittingProcess.request_rows(); }
+
+bool is_row_request_due() { return KnittingProcess.is_row_request_due(); }
+
+bool is_housekeeping_due() {
+  return millis() - last_housekeeping_ms >= HOUSEKEEPING_PERIOD_MS;
+}
+
+void housekeeping() {
+  last_housekeeping_ms = millis();
+  Ayab.check_baudrate_timeout();
+  KnittingProcess.housekeeping();
+}
+
+bool has_pending_task() { return scheduler.has_pending_task(); }
 
 void setup() {
   /**
    * Setup run at the start of the Arduino.
    */
   // Set the pin modes.
-  pinMode(PinsCorrespondance::ND1, INPUT_PULLUP);  // not used for now
+  pinMode(PinsCorrespondance::ND1, INPUT_PULLUP);  // Reference needles
   pinMode(PinsCorrespondance::KSL, INPUT_PULLUP);
   pinMode(PinsCorrespondance::DOB, OUTPUT);
   pinMode(PinsCorrespondance::CCP, INPUT_PULLUP);
@@ -27,16 +69,37 @@ void setup() {
   // Initialize the program singletons.
   Ayab.init();
   KnittingProcess.reset();
+#ifdef BAKED_PATTERN
+  // Knit the pattern compiled into flash right away, no host needed
+  KnittingProcess.start_flash_pattern(&baked_pattern[0][0], BAKED_PATTERN_ROWS,
+                                      BAKED_PATTERN_START_NEEDLE,
+                                      BAKED_PATTERN_END_NEEDLE);
+#endif
+
+  // Carriage edges first, then the serial input in bounded chunks, the row
+  // requests as soon as the line queue has room, and the rest on the timer
+  // tick
+  scheduler.add_task(service_carriage, is_carriage_pending, CARRIAGE_PRIORITY,
+                     CARRIAGE_TASK_BUDGET_US);
+  scheduler.add_task(service_protocol, is_protocol_pending, PROTOCOL_PRIORITY,
+                     PROTOCOL_TASK_BUDGET_US);
+  scheduler.add_task(service_row_request, is_row_request_due,
+                     ROW_REQUEST_PRIORITY, ROW_REQUEST_TASK_BUDGET_US);
+  scheduler.add_task(housekeeping, is_housekeeping_due, HOUSEKEEPING_PRIORITY,
+                     HOUSEKEEPING_TASK_BUDGET_US);
 
   // DEBUG
   DEBUG_START();
   DEBUG_PRINTLN("Init done");
+  BootTiming::mark_setup_done();
 }
 
 void loop() {
   /**
-   * Loop run continuously after the setup.
+   * Loop run continuously after the setup: one task with work, or idle sleep
+   * until the next carriage edge, serial byte or timer tick.
    */
-  Ayab.update();
-  KnittingProcess.knitting_loop();
+  if (!scheduler.run_once()) {
+    IdleSleep::sleep(has_pending_task);
+  }
 }
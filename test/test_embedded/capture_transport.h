@@ -0,0 +1,85 @@
+#ifndef CAPTURE_TRANSPORT_H
+#define CAPTURE_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "communication/slip_link.h"
+#include "communication/transport.h"
+
+/**
+ * Transport of the AYAB protocol in the unit tests, selected in transport.h
+ * by AYAB_TRANSPORT_CAPTURE (set by scripts/test_transport_env.py).
+ *
+ * Writes to the transport of the board and decodes the SLIP packets written,
+ * so that a test can check the last packet the firmware sent. Packets longer
+ * than Size are truncated. Bytes given to inject() are read before those of
+ * the other transport, as if the host had sent them.
+ */
+template <typename Backend, size_t Size>
+class CaptureTransport : public Transport<CaptureTransport<Backend, Size>> {
+ private:
+  Backend backend;
+  uint8_t packet[Size] = {};
+  size_t size = 0;       // Bytes of the packet being written
+  size_t sent_size = 0;  // Bytes of the last complete packet, 0 if none
+  size_t sent_count = 0;  // Complete packets written
+  bool is_escaped = false;
+  uint8_t input[Size] = {};
+  size_t input_head = 0;
+  size_t input_tail = 0;
+
+ public:
+  using Transport<CaptureTransport<Backend, Size>>::write;
+
+  void begin(uint32_t baudrate) { this->backend.begin(baudrate); }
+  int available() {
+    return (this->input_tail - this->input_head) + this->backend.available();
+  }
+  int read() {
+    if (this->input_head < this->input_tail) {
+      return this->input[this->input_head++];
+    }
+    return this->backend.read();
+  }
+  void inject(const uint8_t* bytes, size_t count) {
+    if (this->input_head == this->input_tail) {
+      this->input_head = this->input_tail = 0;
+    }
+    for (size_t i = 0; i < count && this->input_tail < Size; i++) {
+      this->input[this->input_tail++] = bytes[i];
+    }
+  }
+  void flush() { this->backend.flush(); }
+  void write(uint8_t byte) {
+    this->backend.write(byte);
+    if (byte == Slip::END) {
+      if (this->size > 0) {
+        this->sent_size = this->size;
+        this->size = 0;
+        this->sent_count++;
+      }
+      this->is_escaped = false;
+      return;
+    }
+    if (this->size == 0) {
+      this->sent_size = 0;  // The next packet overwrites the buffer
+    }
+    if (this->is_escaped) {
+      this->is_escaped = false;
+      byte = byte == Slip::ESC_END ? Slip::END : Slip::ESC;
+    } else if (byte == Slip::ESC) {
+      this->is_escaped = true;
+      return;
+    }
+    if (this->size < Size) {
+      this->packet[this->size++] = byte;
+    }
+  }
+
+  const uint8_t* get_sent_packet() const { return this->packet; }
+  size_t get_sent_size() const { return this->sent_size; }
+  size_t get_sent_count() const { return this->sent_count; }
+};
+
+#endif
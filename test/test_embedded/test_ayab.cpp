@@ -9,7 +9,7 @@
 #include "version.h"
 
 void test_CRC8_calculation() {
-  Ayab_& ayab_instance = Ayab_::getInstance();
+  Ayab_& ayab_instance = Ayab;
 
   // Test known CRC8 values from the protocol
   // Example from reqStart: {0x01, 0x54, 0x74, 0x02} -> CRC = 0x5b
@@ -111,7 +111,7 @@ void test_cnfLine_invalid_checksum() {
   Ayab.receive(start_buffer, sizeof(start_buffer));
 
   // Get current pattern buffer
-  uint8_t* buffer_before = KnittingProcess.get_pattern().get_buffer();
+  const uint8_t* buffer_before = KnittingProcess.get_pattern().get_buffer();
 
   // Invalid cnfLine packet with wrong CRC (0xFF instead of 0x71)
   uint8_t confline_buffer[] = {0x42, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -121,7 +121,7 @@ void test_cnfLine_invalid_checksum() {
   Ayab.receive(confline_buffer, sizeof(confline_buffer));
 
   // Pattern buffer should remain unchanged due to CRC error
-  uint8_t* buffer_after = KnittingProcess.get_pattern().get_buffer();
+  const uint8_t* buffer_after = KnittingProcess.get_pattern().get_buffer();
   TEST_ASSERT_EQUAL_PTR(buffer_before, buffer_after);
 }
 
@@ -201,7 +201,7 @@ void test_reqInfo_response() {
   // verify the version parsing logic and constants
 
   // Verify API_VERSION constant
-  TEST_ASSERT_EQUAL(6, API_VERSION);
+  TEST_ASSERT_EQUAL(7, API_VERSION);
 
   // Test that version parsing functions work correctly with FIRMWARE_VERSION
   uint8_t major = parse_version_major(FIRMWARE_VERSION);
@@ -240,6 +240,142 @@ void test_reqInfo_response() {
   // If we get here without crashing, the test passes
 }
 
+void test_reqBaud_negotiation() {
+  // NOTE: simavr hands the UART bytes to the test runner whatever the baud
+  // rate, so the test output survives the switch. The time a byte takes on
+  // the line does follow UBRR0 (see test_reqBaud_uart_at_new_rate).
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+
+  // Host asks for 250000 baud (index 1)
+  uint8_t request[] = {0x07, 0x01, 0x30};
+  Ayab.receive(request, sizeof(request));
+  TEST_ASSERT_EQUAL_UINT32(250000U, Ayab.get_baudrate());
+  TEST_ASSERT_TRUE(Ayab.is_baudrate_pending());
+
+  // Same request at the new rate confirms the switch
+  Ayab.receive(request, sizeof(request));
+  TEST_ASSERT_FALSE(Ayab.is_baudrate_pending());
+  delay(BAUD_SWITCH_TIMEOUT_MS + 10);
+  Ayab.update();
+  TEST_ASSERT_EQUAL_UINT32(250000U, Ayab.get_baudrate());
+
+  // Going back to the default rate
+  uint8_t request_default[] = {0x07, 0x00, 0x6e};
+  Ayab.receive(request_default, sizeof(request_default));
+  Ayab.receive(request_default, sizeof(request_default));
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+  TEST_ASSERT_FALSE(Ayab.is_baudrate_pending());
+}
+
+void test_reqBaud_uart_at_new_rate() {
+  // The confirmation is answered over the UART, at the new rate
+  uint8_t request[] = {0x07, 0x01, 0x30};
+  Ayab.receive(request, sizeof(request));
+  TEST_ASSERT_TRUE(Ayab.is_baudrate_pending());
+#if defined(__AVR__)
+  // Double speed: UBRR0 = F_CPU / 8 / baud - 1
+  TEST_ASSERT_TRUE(UCSR0A & _BV(U2X0));
+  TEST_ASSERT_EQUAL(F_CPU / 8 / 250000U - 1, UBRR0);
+
+  // cnfBaud is 5 bytes on the line (END C7 00 01 END), 10 bits each:
+  // 200 us at 250000 baud, 434 us at 115200
+  Serial.flush();
+  unsigned long start = micros();
+  Ayab.receive(request, sizeof(request));
+  Serial.flush();
+  unsigned long elapsed = micros() - start;
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(150UL, elapsed);
+  TEST_ASSERT_LESS_THAN_UINT32(300UL, elapsed);
+#else
+  Ayab.receive(request, sizeof(request));
+#endif
+  TEST_ASSERT_FALSE(Ayab.is_baudrate_pending());
+  const uint8_t expected[] = {0xC7, 0x00, 0x01};
+  TEST_ASSERT_EQUAL(3, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, Ayab.get_transport().get_sent_packet(),
+                               3);
+
+  uint8_t request_default[] = {0x07, 0x00, 0x6e};
+  Ayab.receive(request_default, sizeof(request_default));
+  Ayab.receive(request_default, sizeof(request_default));
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+}
+
+void test_reqBaud_timeout_fallback() {
+  uint8_t request[] = {0x07, 0x01, 0x30};
+  Ayab.receive(request, sizeof(request));
+  TEST_ASSERT_TRUE(Ayab.is_baudrate_pending());
+
+  // No confirmation from the host
+  Ayab.update();
+  TEST_ASSERT_EQUAL_UINT32(250000U, Ayab.get_baudrate());
+  delay(BAUD_SWITCH_TIMEOUT_MS + 10);
+  Ayab.update();
+  TEST_ASSERT_FALSE(Ayab.is_baudrate_pending());
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+}
+
+void test_reqBaud_invalid() {
+  // Unsupported index
+  uint8_t unsupported[] = {0x07, 0x09, 0xf2};
+  Ayab.receive(unsupported, sizeof(unsupported));
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+
+  // Wrong CRC
+  uint8_t wrong_crc[] = {0x07, 0x01, 0xFF};
+  Ayab.receive(wrong_crc, sizeof(wrong_crc));
+  TEST_ASSERT_EQUAL_UINT32(SERIAL_BAUDRATE, Ayab.get_baudrate());
+  TEST_ASSERT_FALSE(Ayab.is_baudrate_pending());
+}
+
+void test_reqPing_response() {
+  // cnfPing echoes the sequence byte, followed by the receive and send
+  // timestamps; a bare ping is answered with sequence 0
+  KnittingProcess.reset();
+  const uint8_t* reply = Ayab.get_transport().get_sent_packet();
+  uint8_t ping[] = {0x08, 0x2A};
+  Ayab.receive(ping, sizeof(ping));
+  TEST_ASSERT_EQUAL(10, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0xC8, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x2A, reply[1]);
+  uint32_t receive_us = (static_cast<uint32_t>(reply[2]) << 24) |
+                        (static_cast<uint32_t>(reply[3]) << 16) |
+                        (static_cast<uint32_t>(reply[4]) << 8) | reply[5];
+  uint32_t send_us = (static_cast<uint32_t>(reply[6]) << 24) |
+                     (static_cast<uint32_t>(reply[7]) << 16) |
+                     (static_cast<uint32_t>(reply[8]) << 8) | reply[9];
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(receive_us, send_us);
+
+  uint8_t bare_ping[] = {0x08};
+  Ayab.receive(bare_ping, sizeof(bare_ping));
+  TEST_ASSERT_EQUAL(10, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0xC8, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x00, reply[1]);
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void test_reqPing_busy_loop() {
+  // The receive timestamp is when the first byte of the ping was read: the
+  // time the rest waited while the loop was busy counts as device time
+  KnittingProcess.reset();
+  const uint8_t* reply = Ayab.get_transport().get_sent_packet();
+  const uint8_t frame[] = {Slip::END, 0x08, 0x07, Slip::END};
+  Ayab.get_transport().inject(frame, sizeof(frame));
+  Ayab.poll_serial(2);  // END and the message id
+  delay(3);  // Carriage events, no serial input read
+  Ayab.poll_serial(UINT8_MAX);
+  TEST_ASSERT_EQUAL(10, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0xC8, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x07, reply[1]);
+  uint32_t receive_us = (static_cast<uint32_t>(reply[2]) << 24) |
+                        (static_cast<uint32_t>(reply[3]) << 16) |
+                        (static_cast<uint32_t>(reply[4]) << 8) | reply[5];
+  uint32_t send_us = (static_cast<uint32_t>(reply[6]) << 24) |
+                     (static_cast<uint32_t>(reply[7]) << 16) |
+                     (static_cast<uint32_t>(reply[8]) << 8) | reply[9];
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(3000, send_us - receive_us);
+}
+
 void run_module_ayab_tests() {
   RUN_TEST(test_CRC8_calculation);
   RUN_TEST(test_reqStart_valid_checksum);
@@ -252,4 +388,10 @@ void run_module_ayab_tests() {
   RUN_TEST(test_reqInit_during_active_knitting);
   RUN_TEST(test_empty_packet_ignored);
   RUN_TEST(test_reqInfo_response);
+  RUN_TEST(test_reqBaud_negotiation);
+  RUN_TEST(test_reqBaud_uart_at_new_rate);
+  RUN_TEST(test_reqBaud_timeout_fallback);
+  RUN_TEST(test_reqBaud_invalid);
+  RUN_TEST(test_reqPing_response);
+  RUN_TEST(test_reqPing_busy_loop);
 }
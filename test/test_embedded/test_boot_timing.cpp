@@ -0,0 +1,42 @@
+#include "test_boot_timing.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "boot_timing.h"
+#include "communication/ayab.h"
+#include "knitting.h"
+
+void test_boot_timing_setup_done() {
+  // Marked by setup() (test_main.cpp, as in the firmware); this module runs
+  // first, before any reqInit
+  TEST_ASSERT_GREATER_THAN_UINT32(0, BootTiming::get_setup_us());
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(micros(), BootTiming::get_setup_us());
+  TEST_ASSERT_EQUAL_UINT32(0, BootTiming::get_ready_us());
+}
+
+void test_boot_timing_ready_once() {
+  // Ready when the first reqInit is handled, then kept for the later sessions
+  KnittingProcess.reset();
+  uint8_t init_buffer[] = {static_cast<uint8_t>(AYAB_API::reqInit)};
+  unsigned long start = micros();
+  Ayab.receive(init_buffer, sizeof(init_buffer));
+  TEST_ASSERT_EQUAL(WaitingStart, KnittingProcess.get_knitting_state());
+  unsigned long ready = BootTiming::get_ready_us();
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(start, ready);
+  TEST_ASSERT_GREATER_THAN_UINT32(BootTiming::get_setup_us(), ready);
+
+  // reqInit is answered without blocking
+  TEST_ASSERT_LESS_THAN(50000UL, micros() - start);
+
+  delay(2);
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  TEST_ASSERT_EQUAL(ready, BootTiming::get_ready_us());
+  KnittingProcess.reset();
+}
+
+void run_module_boot_timing_tests() {
+  RUN_TEST(test_boot_timing_setup_done);
+  RUN_TEST(test_boot_timing_ready_once);
+}
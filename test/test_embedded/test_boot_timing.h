@@ -0,0 +1,6 @@
+#ifndef TEST_BOOT_TIMING_H
+#define TEST_BOOT_TIMING_H
+
+void run_module_boot_timing_tests();
+
+#endif
@@ -0,0 +1,104 @@
+#include "test_colour.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "test_helpers.h"
+
+static void start_colour_session(uint8_t flags) {
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, flags};
+  start_session(flags, Ayab.CRC8(start_buffer, 4));
+}
+
+void test_colour_passes_prefetched_together() {
+  // Two colours per row, one reqLine per row
+  start_colour_session(0x02 | (1 << COLOUR_PASSES_SHIFT));
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_colour_passes());
+  TEST_ASSERT_TRUE(KnittingProcess.uses_line_queue());
+
+  send_cnfLine(0, 0x00, 0x01, false, 0);
+  send_cnfLine(0, 0x00, 0x02, false, 1);
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_current_colour());
+  TEST_ASSERT_EQUAL_HEX8(0xFE, KnittingProcess.get_pattern().get_buffer()[0]);
+
+  // Second pass of the row: installed without any host round trip
+  knit_one_row();
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_current_colour());
+  TEST_ASSERT_EQUAL_HEX8(0xFD, KnittingProcess.get_pattern().get_buffer()[0]);
+
+  // Both passes knitted: waiting for all the passes of row 1
+  knit_one_row();
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS, KnittingProcess.get_line_credits());
+  send_cnfLine(1, 0x00, 0x03, false, 0);
+  TEST_ASSERT_EQUAL_HEX8(0xFC, KnittingProcess.get_pattern().get_buffer()[0]);
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_colour());
+}
+
+void test_colour_pass_out_of_order_dropped() {
+  start_colour_session(0x02 | (2 << COLOUR_PASSES_SHIFT));
+  TEST_ASSERT_EQUAL(3, KnittingProcess.get_colour_passes());
+
+  send_cnfLine(0, 0x00, 0x01, false, 1);  // colour 0 missing
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_expected_colour());
+  send_cnfLine(0, 0x00, 0x01, false, 0);
+  send_cnfLine(0, 0x00, 0x02, true, 1);  // corrupted: NACK for colour 1
+  TEST_ASSERT_EQUAL(1, Ayab.get_line_retransmits());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_colour());
+  send_cnfLine(0, 0x00, 0x02, false, 1);
+  send_cnfLine(0, 0x00, 0x03, false, 2);
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS - 3, KnittingProcess.get_line_credits());
+}
+
+void test_colour_with_batched_lines() {
+  // Batched: the passes of the next rows are pushed ahead too
+  start_colour_session(0x06 | (1 << COLOUR_PASSES_SHIFT));
+  for (uint8_t pass = 0; pass < LINE_QUEUE_SLOTS; pass++) {
+    send_cnfLine(pass / 2, 0x00, pass, false, pass % 2);
+  }
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_line_credits());
+  knit_one_row();
+  knit_one_row();
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_current_colour());
+  TEST_ASSERT_EQUAL_HEX8(0xFD, KnittingProcess.get_pattern().get_buffer()[0]);
+}
+
+void test_colour_last_line_on_last_pass() {
+  // The flag is per pass: on the last pass of the last row, every pass of
+  // the row is knitted, then the session ends
+  start_colour_session(0x02 | (1 << COLOUR_PASSES_SHIFT));
+  send_cnfLine(0, 0x00, 0x01, false, 0);
+  send_cnfLine(0, LAST_LINE_FLAG, 0x02, false, 1);
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_current_colour());
+  TEST_ASSERT_EQUAL_HEX8(0xFD, KnittingProcess.get_pattern().get_buffer()[0]);
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void test_colour_last_line_on_first_pass() {
+  // On an earlier pass, the session ends once that pass is knitted: the
+  // passes after it are never knitted
+  start_colour_session(0x02 | (1 << COLOUR_PASSES_SHIFT));
+  send_cnfLine(0, LAST_LINE_FLAG, 0x01, false, 0);
+  send_cnfLine(0, 0x00, 0x02, false, 1);
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  TEST_ASSERT_EQUAL_HEX8(0xFE, KnittingProcess.get_pattern().get_buffer()[0]);
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void run_module_colour_tests() {
+  RUN_TEST(test_colour_passes_prefetched_together);
+  RUN_TEST(test_colour_pass_out_of_order_dropped);
+  RUN_TEST(test_colour_with_batched_lines);
+  RUN_TEST(test_colour_last_line_on_last_pass);
+  RUN_TEST(test_colour_last_line_on_first_pass);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_COLOUR_H
+#define TEST_COLOUR_H
+
+void run_module_colour_tests();
+
+#endif
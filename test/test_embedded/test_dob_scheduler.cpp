@@ -0,0 +1,87 @@
+#include "test_dob_scheduler.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage.h"
+#include "machine/dob_scheduler.h"
+#include "test_helpers.h"
+
+void test_dob_schedule_and_flush() {
+  Carriage carriage;
+  carriage.set_DOB_state(LOW);
+
+  carriage.schedule_DOB_state(HIGH, 2000);
+#if defined(__AVR__)
+  // Written by the timer, not right away
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  TEST_ASSERT_TRUE(DobScheduler::is_pending());
+  delayMicroseconds(3000);
+#endif
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(PinsCorrespondance::DOB));
+  TEST_ASSERT_FALSE(DobScheduler::is_pending());
+
+  // A late write is applied by flush
+  carriage.schedule_DOB_state(LOW, 50000);
+  carriage.flush_DOB_state();
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  TEST_ASSERT_FALSE(DobScheduler::is_pending());
+
+  // An immediate write replaces the scheduled one
+  carriage.schedule_DOB_state(HIGH, 50000);
+  carriage.set_DOB_state(LOW);
+  TEST_ASSERT_FALSE(DobScheduler::is_pending());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+}
+
+void test_dob_timing_configuration() {
+  KnittingProcess.reset();
+  TEST_ASSERT_EQUAL(DobScheduler::is_supported(),
+                    KnittingProcess.configure_dob_timing(true, 64));
+  TEST_ASSERT_TRUE(KnittingProcess.configure_dob_timing(false, 0));
+
+  // Calibration is refused while knitting, and kept across sessions
+  start_session(0x02, 0x5b);
+  TEST_ASSERT_FALSE(KnittingProcess.configure_dob_timing(true, 64));
+  TEST_ASSERT_FALSE(KnittingProcess.is_dob_scheduling());
+  KnittingProcess.reset();
+}
+
+void test_dob_scheduled_ahead_of_needle() {
+#if defined(__AVR__)
+  KnittingProcess.reset();
+  // Half a period ahead of the expected edge
+  TEST_ASSERT_TRUE(KnittingProcess.configure_dob_timing(true, 128));
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x55);  // needles 84, 86, ... selected
+
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  bool previous_state = false;
+  for (uint8_t needle = 0; needle < 12; needle++) {
+    // 4 ms per needle
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    KnittingProcess.knitting_loop();
+    delayMicroseconds(1000);
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    KnittingProcess.knitting_loop();
+    bool state = digitalRead(PinsCorrespondance::DOB);
+    delayMicroseconds(3000);
+    if (needle > 4) {
+      // Alternate needles, the next state is written half a period early
+      TEST_ASSERT_NOT_EQUAL(previous_state, state);
+      TEST_ASSERT_EQUAL(!state, digitalRead(PinsCorrespondance::DOB));
+    }
+    previous_state = state;
+  }
+  KnittingProcess.reset();
+  KnittingProcess.configure_dob_timing(false, 0);
+#endif
+}
+
+void run_module_dob_scheduler_tests() {
+  RUN_TEST(test_dob_schedule_and_flush);
+  RUN_TEST(test_dob_timing_configuration);
+  RUN_TEST(test_dob_scheduled_ahead_of_needle);
+}
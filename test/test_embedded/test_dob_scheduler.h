@@ -0,0 +1,6 @@
+#ifndef TEST_DOB_SCHEDULER_H
+#define TEST_DOB_SCHEDULER_H
+
+void run_module_dob_scheduler_tests();
+
+#endif
@@ -0,0 +1,238 @@
+#include "test_event_queue.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage_events.h"
+#include "machine/carriage_sampler.h"
+#include "spsc_queue.h"
+#include "test_helpers.h"
+
+void test_spsc_queue_fifo() {
+  SpscQueue<uint8_t, 4> queue;
+  uint8_t item;
+  TEST_ASSERT_EQUAL(3, queue.capacity());
+  TEST_ASSERT_FALSE(queue.pop(item));
+
+  // Several times around the ring
+  for (uint8_t round = 0; round < 5; round++) {
+    TEST_ASSERT_TRUE(queue.push(round));
+    TEST_ASSERT_TRUE(queue.push(round + 10));
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL(round, item);
+    TEST_ASSERT_TRUE(queue.pop(item));
+    TEST_ASSERT_EQUAL(round + 10, item);
+    TEST_ASSERT_TRUE(queue.is_empty());
+  }
+}
+
+void test_spsc_queue_overflow() {
+  SpscQueue<uint8_t, 4> queue;
+  uint8_t item;
+  TEST_ASSERT_TRUE(queue.push(1));
+  TEST_ASSERT_TRUE(queue.push(2));
+  TEST_ASSERT_TRUE(queue.push(3));
+  TEST_ASSERT_FALSE(queue.push(4));
+  TEST_ASSERT_FALSE(queue.push(5));
+  TEST_ASSERT_EQUAL(2, queue.take_dropped());
+  TEST_ASSERT_EQUAL(0, queue.take_dropped());
+
+  // The items queued before the overflow are kept
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL(1, item);
+  TEST_ASSERT_TRUE(queue.push(6));
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL(2, item);
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL(3, item);
+  TEST_ASSERT_TRUE(queue.pop(item));
+  TEST_ASSERT_EQUAL(6, item);
+}
+
+void drain_carriage_events() {
+  CarriageEvent event;
+  while (CarriageEvents::pop(event)) {
+  }
+  CarriageEvents::take_lost_events();
+}
+
+void write_pin_and_record(int pin, int level) {
+  digitalWrite(pin, level);
+  CarriageEvents::poll();  // Boards without the pin change interrupt
+}
+
+void test_carriage_events_stress() {
+  // Producer: the sampler interrupt on AVR (asynchronous to this loop), or
+  // poll() elsewhere. Consumer: random bursts of pops.
+  KnittingProcess.reset();
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  TEST_ASSERT_TRUE(CarriageSampler::configure(SAMPLED_CCP, FILTER_INTEGRATOR,
+                                              2));
+  delayMicroseconds(SIGNAL_SAMPLE_PERIOD_US * 4);
+  CarriageEvents::poll();
+  drain_carriage_events();
+
+  const uint16_t toggles = 300;
+  uint16_t seed = 7;
+  uint16_t popped = 0;
+  uint16_t lost = 0;
+  bool level = false;
+  bool has_previous = false;
+  CarriageEvent previous = {0, 0};
+  CarriageEvent event;
+  for (uint16_t toggle = 0; toggle <= toggles; toggle++) {
+    if (toggle < toggles) {
+      level = !level;
+      digitalWrite(PinsCorrespondance::CCP, level);
+      // Held for 3 samples, longer than the filter
+      for (uint8_t i = 0; i < 3; i++) {
+        delayMicroseconds(SIGNAL_SAMPLE_PERIOD_US);
+        CarriageEvents::poll();
+      }
+    }
+    seed = seed * 25173U + 13849U;
+    uint8_t pops = toggle < toggles ? (seed >> 8) % 3 : 255;
+    uint8_t dropped = CarriageEvents::take_lost_events();
+    lost += dropped;
+    has_previous = has_previous && dropped == 0;
+    for (uint8_t i = 0; i < pops && CarriageEvents::pop(event); i++) {
+      popped++;
+      if (has_previous) {
+        // Every edge once, in order
+        TEST_ASSERT_NOT_EQUAL(previous.signals & CARRIAGE_SIGNAL_CCP,
+                              event.signals & CARRIAGE_SIGNAL_CCP);
+        TEST_ASSERT_TRUE(event.time_us - previous.time_us < 1000000UL);
+      }
+      previous = event;
+      has_previous = true;
+    }
+  }
+  TEST_ASSERT_EQUAL(toggles, popped + lost);
+
+  CarriageSampler::configure(SAMPLED_CCP, FILTER_INTEGRATOR, 0);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+}
+
+void test_late_loop_counts_every_needle() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+  write_pin_and_record(PinsCorrespondance::KSL, HIGH);
+  KnittingProcess.knitting_loop();
+
+  // Six needles pass while the loop is busy elsewhere
+  for (uint8_t needle = 0; needle < 6; needle++) {
+    write_pin_and_record(PinsCorrespondance::CCP, HIGH);
+    write_pin_and_record(PinsCorrespondance::CCP, LOW);
+  }
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_EQUAL(5, KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_lost_carriage_events());
+
+  // More edges than the queue holds: the loss is detected and the state
+  // machine resynchronises on the pins
+  for (uint8_t needle = 0; needle < CARRIAGE_EVENT_QUEUE_SLOTS; needle++) {
+    write_pin_and_record(PinsCorrespondance::CCP, HIGH);
+    write_pin_and_record(PinsCorrespondance::CCP, LOW);
+  }
+  write_pin_and_record(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_GREATER_THAN(0, KnittingProcess.get_lost_carriage_events());
+  // The rest of the row is not selected, the needle index is off
+  TEST_ASSERT_EQUAL(PHASE_ERROR, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  int needle_index = KnittingProcess.get_current_needle_index();
+  write_pin_and_record(PinsCorrespondance::CCP, LOW);
+  write_pin_and_record(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_EQUAL(needle_index + 1,
+                    KnittingProcess.get_current_needle_index());
+
+  KnittingProcess.reset();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+}
+
+uint8_t send_reqReferenceNeedles(uint8_t period, uint8_t offset) {
+  // @return The error code of cnfReferenceNeedles, 0xFF without it
+  uint8_t request[] = {0x13, period, offset, 0};
+  request[3] = Ayab.CRC8(request, 3);
+  Ayab.receive(request, sizeof(request));
+  const uint8_t* reply = Ayab.get_transport().get_sent_packet();
+  if (Ayab.get_transport().get_sent_size() != 2 || reply[0] != 0xD3) {
+    return 0xFF;
+  }
+  return reply[1];
+}
+
+void test_reference_needles_over_protocol() {
+  KnittingProcess.reset();
+  TEST_ASSERT_EQUAL_HEX8(0x0C, send_reqReferenceNeedles(24, 24));
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_reference_period());
+  TEST_ASSERT_EQUAL_HEX8(0x00, send_reqReferenceNeedles(24, 3));
+  TEST_ASSERT_EQUAL(24, KnittingProcess.get_reference_period());
+
+  // Refused while knitting
+  start_session(0x02, 0x5b);
+  TEST_ASSERT_EQUAL_HEX8(0x03, send_reqReferenceNeedles(0, 0));
+  TEST_ASSERT_EQUAL(24, KnittingProcess.get_reference_period());
+  KnittingProcess.reset();
+  TEST_ASSERT_EQUAL_HEX8(0x00, send_reqReferenceNeedles(0, 0));
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_reference_period());
+}
+
+void test_reference_needle_after_lost_edges() {
+  // Period 200: the reference nearest to the carriage is needle 10, outside
+  // the pattern. Period 2: a reference on every other needle. Set by the host.
+  const uint8_t periods[] = {200, 2};
+  const uint8_t offsets[] = {10, 0};
+  for (uint8_t i = 0; i < 2; i++) {
+    KnittingProcess.reset();
+    TEST_ASSERT_EQUAL_HEX8(0x00,
+                           send_reqReferenceNeedles(periods[i], offsets[i]));
+    start_session(0x02, 0x5b);
+    send_cnfLine(0, 0x00, 0x00);
+    write_pin_and_record(PinsCorrespondance::KSL, HIGH);
+    for (uint8_t needle = 0; needle <= CARRIAGE_EVENT_QUEUE_SLOTS; needle++) {
+      write_pin_and_record(PinsCorrespondance::CCP, HIGH);
+      write_pin_and_record(PinsCorrespondance::CCP, LOW);
+    }
+    KnittingProcess.knitting_loop();
+    TEST_ASSERT_EQUAL(PHASE_ERROR, KnittingProcess.get_phase());
+    int needle_index = KnittingProcess.get_current_needle_index();
+
+    write_pin_and_record(PinsCorrespondance::ND1, HIGH);
+    KnittingProcess.knitting_loop();
+    if (i == 0) {
+      // No needle of the row: the shifted count is not used
+      TEST_ASSERT_EQUAL(PHASE_ERROR, KnittingProcess.get_phase());
+      TEST_ASSERT_EQUAL(needle_index,
+                        KnittingProcess.get_current_needle_index());
+      TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+    } else {
+      TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+      TEST_ASSERT_EQUAL(KnittingProcess.get_carriage_position() - 84,
+                        KnittingProcess.get_current_needle_index());
+    }
+
+    KnittingProcess.reset();
+    digitalWrite(PinsCorrespondance::ND1, LOW);
+    digitalWrite(PinsCorrespondance::KSL, LOW);
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    KnittingProcess.knitting_loop();
+  }
+  send_reqReferenceNeedles(ND1_REFERENCE_PERIOD, ND1_REFERENCE_OFFSET);
+}
+
+void run_module_event_queue_tests() {
+  RUN_TEST(test_spsc_queue_fifo);
+  RUN_TEST(test_spsc_queue_overflow);
+  RUN_TEST(test_carriage_events_stress);
+  RUN_TEST(test_late_loop_counts_every_needle);
+  RUN_TEST(test_reference_needles_over_protocol);
+  RUN_TEST(test_reference_needle_after_lost_edges);
+}
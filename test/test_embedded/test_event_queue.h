@@ -0,0 +1,6 @@
+#ifndef TEST_EVENT_QUEUE_H
+#define TEST_EVENT_QUEUE_H
+
+void run_module_event_queue_tests();
+
+#endif
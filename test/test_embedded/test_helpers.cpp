@@ -0,0 +1,69 @@
+#include "test_helpers.h"
+
+#include <Arduino.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+
+void send_cnfLine(uint8_t line_number, uint8_t flags, uint8_t fill,
+                  bool corrupt_crc, uint8_t colour) {
+  uint8_t buffer[MAX_LINE_BUFFER_LEN + 5];
+  buffer[0] = static_cast<uint8_t>(AYAB_API::cnfLine);
+  buffer[1] = line_number;
+  buffer[2] = colour;
+  buffer[3] = flags;
+  for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+    buffer[i + 4] = fill;
+  }
+  buffer[MAX_LINE_BUFFER_LEN + 4] =
+      Ayab.CRC8(buffer, MAX_LINE_BUFFER_LEN + 4);
+  if (corrupt_crc) {
+    buffer[MAX_LINE_BUFFER_LEN + 4] ^= 0xFF;
+  }
+  Ayab.receive(buffer, sizeof(buffer));
+}
+
+void start_session(uint8_t flags, uint8_t crc) {
+  // reqStart: start=84, end=116, `flags` with its CRC
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, flags, crc};
+  Ayab.receive(start_buffer, sizeof(start_buffer));
+  KnittingProcess.knitting_loop();  // requests the first row
+}
+
+void knit_one_row() {
+  // Move the carriage through the pattern section and out of it
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  for (int i = 0; i < 4; i++) {
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    KnittingProcess.knitting_loop();
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    KnittingProcess.knitting_loop();
+  }
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();
+}
+
+void play_pin_trace(const char* trace) {
+  const int pins[] = {PinsCorrespondance::CCP, PinsCorrespondance::KSL,
+                      PinsCorrespondance::HOK, PinsCorrespondance::ND1};
+  while (*trace != '\0') {
+    for (uint8_t i = 0; i < 4 && *trace != '\0' && *trace != ' '; i++) {
+      digitalWrite(pins[i], *trace == '1' ? HIGH : LOW);
+      trace++;
+    }
+    KnittingProcess.knitting_loop();
+    while (*trace == ' ') {
+      trace++;
+    }
+  }
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <stdint.h>
+
+// Send a cnfLine packet, every data byte set to `fill`. The CRC is valid
+// unless `corrupt_crc` is set.
+void send_cnfLine(uint8_t line_number, uint8_t flags, uint8_t fill,
+                  bool corrupt_crc = false, uint8_t colour = 0);
+
+// Start a knitting session (needles 84-116) and request the first row
+void start_session(uint8_t flags, uint8_t crc);
+
+// Move the carriage through the pattern section and out of it
+void knit_one_row();
+
+// Play a pin trace, running the knitting loop after each step. Steps are
+// separated by spaces, each gives the levels of CCP, KSL, HOK and optionally
+// ND1 ("010": CCP LOW, KSL HIGH, HOK LOW, ND1 unchanged).
+void play_pin_trace(const char* trace);
+
+#endif
@@ -0,0 +1,86 @@
+#include "test_idle_sleep.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config.h"
+#include "machine/carriage_events.h"
+#include "machine/idle_sleep.h"
+
+bool has_work() { return true; }
+bool has_no_work() { return false; }
+
+void test_no_sleep_with_work() {
+  IdleSleep::clear_stats();
+  TEST_ASSERT_FALSE(IdleSleep::sleep(has_work));
+  TEST_ASSERT_EQUAL(0, IdleSleep::get_sleep_count());
+}
+
+void test_wake_on_timer_tick() {
+  IdleSleep::clear_stats();
+  Serial.flush();  // No UART interrupt while sleeping
+  unsigned long start_ms = millis();
+  TEST_ASSERT_EQUAL(IdleSleep::is_supported(), IdleSleep::sleep(has_no_work));
+  if (!IdleSleep::is_supported()) {
+    return;
+  }
+
+  // Woken up by the millis() tick, within a few instructions of its interrupt
+  while (millis() == start_ms) {
+    IdleSleep::sleep(has_no_work);
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(1, IdleSleep::get_sleep_count());
+  TEST_ASSERT_LESS_OR_EQUAL(20, IdleSleep::get_max_wake_latency_us());
+}
+
+void test_wake_on_carriage_edge() {
+  IdleSleep::clear_stats();
+  if (!IdleSleep::is_supported()) {
+    return;
+  }
+  Serial.flush();
+  CarriageEvents::begin();
+
+  // CCP is on OC0B: Timer0 drives it in hardware (fast PWM), rising at the
+  // overflow and falling when the counter matches OCR0B, while the CPU sleeps
+  analogWrite(PinsCorrespondance::CCP, 128);
+#if defined(__AVR__)
+  const uint8_t edges[] = {0, OCR0B};
+#else
+  const uint8_t edges[] = {0, 128};
+#endif
+  uint8_t max_latency_ticks = 0;
+  for (uint8_t i = 0; i < 20 && IdleSleep::get_edge_wake_count() < 4; i++) {
+    uint16_t wakes = IdleSleep::get_edge_wake_count();
+    IdleSleep::sleep(has_no_work);
+    if (IdleSleep::get_edge_wake_count() == wakes) {
+      continue;
+    }
+    // Timer0 ticks from the last edge to the entry of the interrupt
+    uint8_t ticks = IdleSleep::get_edge_wake_ticks();
+    uint8_t latency = ticks - edges[0];
+    if (static_cast<uint8_t>(ticks - edges[1]) < latency) {
+      latency = ticks - edges[1];
+    }
+    if (latency > max_latency_ticks) {
+      max_latency_ticks = latency;
+    }
+  }
+  digitalWrite(PinsCorrespondance::CCP, LOW);  // PWM off
+  pinMode(PinsCorrespondance::CCP, INPUT);
+  CarriageEvent event;
+  while (CarriageEvents::pop(event)) {
+  }
+  CarriageEvents::take_lost_events();
+
+  // Woken up by the pin change interrupt within a Timer0 tick (64 cycles, 4
+  // us) of the compare match, give or take the prescaler phase
+  TEST_ASSERT_GREATER_OR_EQUAL(1, IdleSleep::get_edge_wake_count());
+  TEST_ASSERT_LESS_OR_EQUAL(1, max_latency_ticks);
+}
+
+void run_module_idle_sleep_tests() {
+  RUN_TEST(test_no_sleep_with_work);
+  RUN_TEST(test_wake_on_timer_tick);
+  RUN_TEST(test_wake_on_carriage_edge);
+}
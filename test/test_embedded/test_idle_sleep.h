@@ -0,0 +1,6 @@
+#ifndef TEST_IDLE_SLEEP_H
+#define TEST_IDLE_SLEEP_H
+
+void run_module_idle_sleep_tests();
+
+#endif
@@ -128,9 +128,28 @@ void test_knitting_waiting_start_carriage_detection() {
   TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
 }
 
+void test_knitting_row_request_due() {
+  // The first row is asked for as soon as the session starts, without
+  // waiting for the housekeeping tick
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  TEST_ASSERT_FALSE(KnittingProcess.is_row_request_due());
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, 0x00, 0xe7};
+  Ayab.receive(start_buffer, sizeof(start_buffer));
+  TEST_ASSERT_TRUE(KnittingProcess.is_row_request_due());
+
+  KnittingProcess.request_rows();
+  TEST_ASSERT_EQUAL(PHASE_PREFETCH, KnittingProcess.get_phase());
+  TEST_ASSERT_FALSE(KnittingProcess.is_row_request_due());
+  const uint8_t* request = Ayab.get_transport().get_sent_packet();
+  TEST_ASSERT_EQUAL_HEX8(0x82, request[0]);
+  TEST_ASSERT_EQUAL(0, request[1]);
+}
+
 void run_module_knitting_tests() {
   RUN_TEST(test_knitting_state_transitions);
   RUN_TEST(test_knitting_needle_index_tracking);
   RUN_TEST(test_knitting_edge_cases);
   RUN_TEST(test_knitting_waiting_start_carriage_detection);
+  RUN_TEST(test_knitting_row_request_due);
 }
@@ -0,0 +1,184 @@
+#include "test_knitting_fsm.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config.h"
+#include "knitting.h"
+#include "knitting_fsm.h"
+#include "test_helpers.h"
+
+void step_pin(int pin, int level) {
+  digitalWrite(pin, level);
+  KnittingProcess.knitting_loop();
+}
+
+void test_fsm_row_cycle() {
+  KnittingProcess.reset();
+  TEST_ASSERT_EQUAL(PHASE_IDLE, KnittingProcess.get_phase());
+  start_session(0x02, 0x5b);
+  TEST_ASSERT_EQUAL(PHASE_PREFETCH, KnittingProcess.get_phase());
+  send_cnfLine(0, 0x00, 0xFF);
+  TEST_ASSERT_EQUAL(PHASE_ROW_READY, KnittingProcess.get_phase());
+
+  step_pin(PinsCorrespondance::KSL, HIGH);
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+  step_pin(PinsCorrespondance::CCP, HIGH);
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_current_needle_index());
+  step_pin(PinsCorrespondance::CCP, LOW);
+
+  // The row ends on the needle after KSL fell
+  step_pin(PinsCorrespondance::KSL, LOW);
+  TEST_ASSERT_EQUAL(PHASE_LEAVING_PATTERN, KnittingProcess.get_phase());
+  step_pin(PinsCorrespondance::CCP, HIGH);
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  send_cnfLine(1, 0x00, 0xFF);
+  TEST_ASSERT_EQUAL(PHASE_ROW_READY, KnittingProcess.get_phase());
+
+  // Last line: back to Idle
+  send_cnfLine(2, 0x01, 0x00);
+  TEST_ASSERT_EQUAL(PHASE_IDLE, KnittingProcess.get_phase());
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+}
+
+void test_fsm_stale_row() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+  knit_one_row();
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+
+  // Back in the pattern before the next row
+  step_pin(PinsCorrespondance::CCP, LOW);
+  step_pin(PinsCorrespondance::KSL, HIGH);
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_turnaround_stats().get_stale_rows());
+
+  // A row arriving mid-pass is used right away
+  send_cnfLine(1, 0x00, 0x00);
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+
+  KnittingProcess.reset();
+  step_pin(PinsCorrespondance::KSL, LOW);
+  step_pin(PinsCorrespondance::CCP, LOW);
+}
+
+void test_fsm_reverse_in_pattern() {
+  // DOB HIGH on needles 84-87, LOW on 88-91, ... (cnfLine is inverted)
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+
+  // Six needles to the right (84 to 89), on the first half of 89
+  play_pin_trace("010 110 010 110 010 110 010 110 010 110 010 110");
+  TEST_ASSERT_EQUAL(5, KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+
+  // Turn: 89 is needle 27 from the left end (116)
+  play_pin_trace("111");
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(27, KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_reversals());
+  play_pin_trace("011 111");  // 88
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  play_pin_trace("011 111");  // 87
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(PinsCorrespondance::DOB));
+
+  // Turn again on the second half of 87: its edge comes again
+  play_pin_trace("011 010");
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_current_needle_index());
+  play_pin_trace("110");  // 87
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(PinsCorrespondance::DOB));
+  play_pin_trace("010 110");  // 88
+  TEST_ASSERT_EQUAL(4, KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+
+  // The row ends normally, without a stale row
+  play_pin_trace("000 100");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_turnaround_stats().get_stale_rows());
+
+  KnittingProcess.reset();
+  play_pin_trace("000");
+}
+
+void test_fsm_reverse_at_cam_edge() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+
+  // Four needles to the right, then KSL falls
+  play_pin_trace("010 110 010 110 010 110 010 110 010 000");
+  TEST_ASSERT_EQUAL(PHASE_LEAVING_PATTERN, KnittingProcess.get_phase());
+
+  // Turns twice before the next needle, then goes on out of the pattern
+  play_pin_trace("001 000");
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_reversals());
+  play_pin_trace("100");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(CARRIAGE_OFF_PATTERN,
+                    KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(LOW, digitalRead(PinsCorrespondance::DOB));
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_line());
+
+  // The next row is counted from its first needle
+  send_cnfLine(1, 0x00, 0x0F);
+  TEST_ASSERT_EQUAL(PHASE_ROW_READY, KnittingProcess.get_phase());
+  play_pin_trace("000 010 110");
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_current_needle_index());
+
+  KnittingProcess.reset();
+  play_pin_trace("000");
+}
+
+void test_fsm_reference_needle() {
+  // A reference needle every 24 needles (none calibrated by default)
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_reference_period());
+  TEST_ASSERT_FALSE(KnittingProcess.configure_reference_needles(24, 24));
+  KnittingProcess.reset();
+  TEST_ASSERT_TRUE(KnittingProcess.configure_reference_needles(24, 0));
+
+  // First reference needle of the pattern (needles 84-116)
+  int reference = 96;
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);  // DOB HIGH on needles 84-87, 92-95, ...
+  TEST_ASSERT_EQUAL(CARRIAGE_POSITION_UNKNOWN,
+                    KnittingProcess.get_carriage_position());
+
+  // One edge missed: the count is a needle behind the carriage
+  play_pin_trace("0100");
+  for (int needle = 85; needle <= reference; needle++) {
+    play_pin_trace("110 010");
+  }
+  TEST_ASSERT_EQUAL(reference - 1, KnittingProcess.get_carriage_position());
+  TEST_ASSERT_EQUAL(reference - 85, KnittingProcess.get_current_needle_index());
+
+  // ND1 gives the needle back
+  play_pin_trace("0101");
+  TEST_ASSERT_EQUAL(reference, KnittingProcess.get_carriage_position());
+  TEST_ASSERT_EQUAL(reference - 84, KnittingProcess.get_current_needle_index());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_position_corrections());
+  play_pin_trace("1100 010");
+  TEST_ASSERT_EQUAL(reference + 1, KnittingProcess.get_carriage_position());
+  TEST_ASSERT_EQUAL(((reference + 1) & 7) >= 4,
+                    digitalRead(PinsCorrespondance::DOB));
+
+  // Outside the pattern the position is counted on, and reported
+  play_pin_trace("000 100 000 100");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(reference + 3, KnittingProcess.get_carriage_position());
+  TEST_ASSERT_FALSE(KnittingProcess.configure_reference_needles(0, 0));
+
+  KnittingProcess.reset();
+  play_pin_trace("0000");
+  KnittingProcess.configure_reference_needles(ND1_REFERENCE_PERIOD,
+                                              ND1_REFERENCE_OFFSET);
+}
+
+void run_module_knitting_fsm_tests() {
+  RUN_TEST(test_fsm_row_cycle);
+  RUN_TEST(test_fsm_stale_row);
+  RUN_TEST(test_fsm_reverse_in_pattern);
+  RUN_TEST(test_fsm_reverse_at_cam_edge);
+  RUN_TEST(test_fsm_reference_needle);
+}
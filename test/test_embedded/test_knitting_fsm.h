@@ -0,0 +1,6 @@
+#ifndef TEST_KNITTING_FSM_H
+#define TEST_KNITTING_FSM_H
+
+void run_module_knitting_fsm_tests();
+
+#endif
@@ -0,0 +1,93 @@
+#include "test_line_queue.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "line_queue.h"
+#include "test_helpers.h"
+
+void test_line_queue_push_pop() {
+  LineQueue queue;
+  uint8_t data[MAX_LINE_BUFFER_LEN] = {0xAA};
+
+  TEST_ASSERT_TRUE(queue.is_empty());
+  TEST_ASSERT_NULL(queue.front());
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS, queue.free_slots());
+
+  for (uint8_t i = 0; i < LINE_QUEUE_SLOTS; i++) {
+    TEST_ASSERT_TRUE(queue.push(i, false, data));
+  }
+  TEST_ASSERT_TRUE(queue.is_full());
+  TEST_ASSERT_FALSE(queue.push(LINE_QUEUE_SLOTS, false, data));
+
+  // Rows come out in order, and slots are reused after wrapping around
+  queue.pop();
+  TEST_ASSERT_EQUAL(1, queue.front()->line_number);
+  TEST_ASSERT_TRUE(queue.push(LINE_QUEUE_SLOTS, true, data));
+  for (uint8_t i = 1; i <= LINE_QUEUE_SLOTS; i++) {
+    TEST_ASSERT_EQUAL(i, queue.front()->line_number);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, queue.front()->data[0]);
+    queue.pop();
+  }
+  TEST_ASSERT_TRUE(queue.is_empty());
+
+  queue.pop();  // popping an empty queue is harmless
+  TEST_ASSERT_EQUAL(0, queue.size());
+}
+
+void test_batched_lines_credits() {
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+
+  // reqStart with the batched lines flag: start=84, end=116, flags=0x06
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, 0x06, 0x3a};
+  Ayab.receive(start_buffer, sizeof(start_buffer));
+  TEST_ASSERT_TRUE(KnittingProcess.is_batched());
+  size_t sent_count = Ayab.get_transport().get_sent_count();
+  KnittingProcess.knitting_loop();  // requests the first row
+
+  // The credits alone ask for the first row, no reqLine is sent
+  TEST_ASSERT_EQUAL(sent_count + 1, Ayab.get_transport().get_sent_count());
+  const uint8_t* credits = Ayab.get_transport().get_sent_packet();
+  TEST_ASSERT_EQUAL(3, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0x86, credits[0]);
+  TEST_ASSERT_EQUAL(0, credits[1]);
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS, credits[2]);
+
+  // The host pushes rows until the credits run out
+  for (uint8_t i = 0; i < LINE_QUEUE_SLOTS; i++) {
+    send_cnfLine(i, 0x00, i);
+  }
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_line_credits());
+  const uint8_t* first_row = KnittingProcess.get_pattern().get_buffer();
+  TEST_ASSERT_NOT_NULL(first_row);
+  TEST_ASSERT_EQUAL_HEX8(0xFF, first_row[0]);  // inverted fill 0x00
+
+  // A row beyond the credits is dropped
+  send_cnfLine(LINE_QUEUE_SLOTS, 0x00, 0x55);
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_line_credits());
+
+  // Finishing a row installs the next one without any host round trip
+  knit_one_row();
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_line_credits());
+  TEST_ASSERT_EQUAL_HEX8(0xFE, KnittingProcess.get_pattern().get_buffer()[0]);
+
+  // Last line flag is applied only when the row is installed
+  send_cnfLine(LINE_QUEUE_SLOTS, LAST_LINE_FLAG, 0x00);
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  for (uint8_t i = 0; i < LINE_QUEUE_SLOTS - 1; i++) {
+    knit_one_row();
+  }
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void run_module_line_queue_tests() {
+  RUN_TEST(test_line_queue_push_pop);
+  RUN_TEST(test_batched_lines_credits);
+}
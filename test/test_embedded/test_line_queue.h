@@ -0,0 +1,6 @@
+#ifndef TEST_LINE_QUEUE_H
+#define TEST_LINE_QUEUE_H
+
+void run_module_line_queue_tests();
+
+#endif
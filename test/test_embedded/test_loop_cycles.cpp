@@ -0,0 +1,132 @@
+#include "test_loop_cycles.h"
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "config.h"
+#include "knitting.h"
+#include "test_helpers.h"
+
+#if defined(__AVR__)
+#include "machine/hardware_timer.h"
+#endif
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+// Needles knitted per measured row, inside the 33 needles of the pattern
+const uint8_t MEASURED_NEEDLES = 32;
+const uint8_t MEASURED_ROWS = 8;
+
+// CPU cycles of a needle at the highest safe carriage speed
+const unsigned long NEEDLE_BUDGET_CYCLES =
+    F_CPU / MAX_SAFE_NEEDLES_PER_SECOND;
+
+#if defined(__AVR__)
+// Timer1 counts CPU cycles during the measurement (prescaler 1), the DOB
+// scheduler and the sampler get their prescaler back after it. No DOB write
+// is scheduled in these sessions.
+uint8_t saved_tccr1b;
+
+void start_cycle_counter() {
+  HardwareTimer::start();
+  saved_tccr1b = TCCR1B;
+  TCCR1B = _BV(CS10);
+}
+
+void stop_cycle_counter() { TCCR1B = saved_tccr1b; }
+
+uint16_t read_cycle_counter() { return TCNT1; }
+#else
+// No cycle counter: micros() converted, only to run the tests
+void start_cycle_counter() {}
+
+void stop_cycle_counter() {}
+
+uint16_t read_cycle_counter() {
+  return static_cast<uint16_t>(micros() * (F_CPU / 1000000UL));
+}
+#endif
+
+uint16_t counter_overhead() {
+  // Cycles of reading the counter twice, deducted from each measurement
+  uint16_t start = read_cycle_counter();
+  return read_cycle_counter() - start;
+}
+
+unsigned long timed_loop() {
+  // Cycles of one knitting_loop() call, at most 65535 (4 ms)
+  uint16_t overhead = counter_overhead();
+  uint16_t start = read_cycle_counter();
+  KnittingProcess.knitting_loop();
+  uint16_t cycles = read_cycle_counter() - start;
+  return cycles > overhead ? cycles - overhead : 0;
+}
+
+void report_cycles(const char* name, unsigned long cycles) {
+  // Printed in the test output (`pio test -e simavr`), to compare builds
+  char message[64];
+  snprintf(message, sizeof(message), "knitting_loop() %s: %lu cycles", name,
+           cycles);
+  TEST_MESSAGE(message);
+}
+
+unsigned long toggle_needles() {
+  // Cycles of the loop over MEASURED_NEEDLES CCP pulses, pin writes excluded
+  unsigned long cycles = 0;
+  for (uint8_t needle = 0; needle < MEASURED_NEEDLES; needle++) {
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    cycles += timed_loop();
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    cycles += timed_loop();
+  }
+  return cycles;
+}
+
+void test_loop_cycles_idle() {
+  // Nothing to do: carriage event queue, protocol and sleep checks only
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+  const unsigned int loops = 2 * MEASURED_NEEDLES * MEASURED_ROWS;
+  unsigned long total = 0;
+  start_cycle_counter();
+  for (unsigned int i = 0; i < loops; i++) {
+    total += timed_loop();
+  }
+  stop_cycle_counter();
+  unsigned long cycles = total / loops;
+  report_cycles("idle", cycles);
+  TEST_ASSERT_LESS_THAN(NEEDLE_BUDGET_CYCLES / 2, cycles);
+  KnittingProcess.reset();
+}
+
+void test_loop_cycles_needle() {
+  // A CCP edge in the pattern per iteration
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+  unsigned long total = 0;
+  for (uint8_t row = 0; row < MEASURED_ROWS; row++) {
+    play_pin_trace("010");
+    start_cycle_counter();
+    total += toggle_needles();
+    stop_cycle_counter();
+    TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, KnittingProcess.get_phase());
+    TEST_ASSERT_EQUAL(MEASURED_NEEDLES - 1,
+                      KnittingProcess.get_current_needle_index());
+    play_pin_trace("000 100 000");
+    TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+    send_cnfLine(row + 1, 0x00, 0x0F);
+  }
+  unsigned long cycles = total / (2 * MEASURED_NEEDLES * MEASURED_ROWS);
+  report_cycles("needle", cycles);
+  TEST_ASSERT_LESS_THAN(NEEDLE_BUDGET_CYCLES / 2, cycles);
+  KnittingProcess.reset();
+  play_pin_trace("000");
+}
+
+void run_module_loop_cycles_tests() {
+  RUN_TEST(test_loop_cycles_idle);
+  RUN_TEST(test_loop_cycles_needle);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_LOOP_CYCLES_H
+#define TEST_LOOP_CYCLES_H
+
+void run_module_loop_cycles_tests();
+
+#endif
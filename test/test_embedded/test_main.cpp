@@ -9,12 +9,33 @@
 #include <Arduino.h>
 #include <unity.h>
 
+#include "boot_timing.h"
 #include "config.h"
 #include "test_ayab.h"
+#include "test_boot_timing.h"
 #include "test_carriage.h"
+#include "test_colour.h"
+#include "test_dob_scheduler.h"
+#include "test_event_queue.h"
+#include "test_idle_sleep.h"
 #include "test_integration.h"
 #include "test_knitting.h"
+#include "test_knitting_fsm.h"
+#include "test_line_queue.h"
+#include "test_loop_cycles.h"
+#include "test_motif.h"
+#include "test_motif_store.h"
 #include "test_pattern.h"
+#include "test_retransmit.h"
+#include "test_row_check.h"
+#include "test_row_dictionary.h"
+#include "test_row_transform.h"
+#include "test_scheduler.h"
+#include "test_session_checkpoint.h"
+#include "test_signal_filter.h"
+#include "test_slip_link.h"
+#include "test_speed_estimator.h"
+#include "test_turnaround_stats.h"
 #include "test_version.h"
 
 void setup() {
@@ -38,14 +59,38 @@ void setup() {
   digitalWrite(PinsCorrespondance::HOK, LOW);
   digitalWrite(PinsCorrespondance::KSL, LOW);
   digitalWrite(PinsCorrespondance::SOLENOID_POWER, LOW);
+
+  // As at the end of the firmware setup(), checked by the boot timing tests
+  BootTiming::mark_setup_done();
 }
 
 void loop() {
+  // First: reqInit was not handled yet
+  RUN_MODULE(run_module_boot_timing_tests);
   RUN_MODULE(run_module_carriage_tests);
   RUN_MODULE(run_module_pattern_tests);
   RUN_MODULE(run_module_knitting_tests);
+  RUN_MODULE(run_module_knitting_fsm_tests);
   RUN_MODULE(run_module_version_tests);
   RUN_MODULE(run_module_ayab_tests);
+  RUN_MODULE(run_module_slip_link_tests);
+  RUN_MODULE(run_module_line_queue_tests);
+  RUN_MODULE(run_module_turnaround_stats_tests);
+  RUN_MODULE(run_module_retransmit_tests);
+  RUN_MODULE(run_module_motif_tests);
+  RUN_MODULE(run_module_motif_store_tests);
+  RUN_MODULE(run_module_session_checkpoint_tests);
+  RUN_MODULE(run_module_row_transform_tests);
+  RUN_MODULE(run_module_row_dictionary_tests);
+  RUN_MODULE(run_module_row_check_tests);
+  RUN_MODULE(run_module_colour_tests);
+  RUN_MODULE(run_module_speed_estimator_tests);
+  RUN_MODULE(run_module_dob_scheduler_tests);
+  RUN_MODULE(run_module_loop_cycles_tests);
+  RUN_MODULE(run_module_signal_filter_tests);
+  RUN_MODULE(run_module_event_queue_tests);
+  RUN_MODULE(run_module_scheduler_tests);
+  RUN_MODULE(run_module_idle_sleep_tests);
   RUN_MODULE(run_module_integration_tests);
 
   UNITY_END();
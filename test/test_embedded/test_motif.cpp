@@ -0,0 +1,180 @@
+#include "test_motif.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "motif.h"
+#include "test_helpers.h"
+
+// Kept off the stack (about 100 bytes on AVR), reset by each test
+static Motif motif;
+
+void test_motif_render_repeat() {
+  // 3 needles wide, 2 rows: row 0 selects column 0, row 1 columns 1 and 2
+  motif = Motif();
+  uint8_t tile[] = {0b001, 0b110};
+  TEST_ASSERT_TRUE(motif.configure(3, 2, 0, 0, 0, 0));
+  TEST_ASSERT_FALSE(motif.is_loaded());
+  TEST_ASSERT_TRUE(motif.load(0, tile, sizeof(tile)));
+  TEST_ASSERT_TRUE(motif.is_loaded());
+
+  uint8_t line[MAX_LINE_BUFFER_LEN];
+  motif.render_row(0, line);
+  // Needles 0, 3, 6 selected (inverted bits)
+  TEST_ASSERT_EQUAL_HEX8(0xB6, line[0]);
+  // Needle 198 is a multiple of 3
+  TEST_ASSERT_EQUAL(0, bitRead(line[24], 198 - 192));
+
+  motif.render_row(1, line);
+  TEST_ASSERT_EQUAL_HEX8(0x49, line[0]);
+  motif.render_row(2, line);  // repeats vertically
+  TEST_ASSERT_EQUAL_HEX8(0xB6, line[0]);
+}
+
+void test_motif_render_offset_and_mirror() {
+  motif = Motif();
+  uint8_t tile[] = {0b001, 0b110};
+
+  // Horizontal mirror: column 0 shows up on the last column of the repeat
+  motif.configure(3, 2, 0, 0, MOTIF_MIRROR_HORIZONTAL, 0);
+  motif.load(0, tile, sizeof(tile));
+  uint8_t line[MAX_LINE_BUFFER_LEN];
+  motif.render_row(0, line);
+  TEST_ASSERT_EQUAL_HEX8(0xDB, line[0]);
+
+  // Horizontal offset of one needle
+  motif.configure(3, 2, 1, 0, 0, 0);
+  motif.load(0, tile, sizeof(tile));
+  motif.render_row(0, line);
+  TEST_ASSERT_EQUAL_HEX8(0x6D, line[0]);
+
+  // Vertical mirror starts from the last tile row
+  motif.configure(3, 2, 0, 0, MOTIF_MIRROR_VERTICAL, 0);
+  motif.load(0, tile, sizeof(tile));
+  motif.render_row(0, line);
+  TEST_ASSERT_EQUAL_HEX8(0x49, line[0]);
+}
+
+void test_motif_invalid() {
+  motif = Motif();
+  uint8_t tile[4] = {0};
+
+  TEST_ASSERT_FALSE(motif.configure(0, 2, 0, 0, 0, 0));
+  TEST_ASSERT_FALSE(motif.configure(200, 8, 0, 0, 0, 0));  // 200 bytes
+  TEST_ASSERT_FALSE(motif.load(0, tile, 1));  // not configured
+
+  TEST_ASSERT_TRUE(motif.configure(16, 2, 0, 0, 0, 0));
+  TEST_ASSERT_FALSE(motif.load(2, tile, 2));  // out of order
+  TEST_ASSERT_TRUE(motif.load(0, tile, 2));
+  TEST_ASSERT_FALSE(motif.load(2, tile, 4));  // exceeds the tile
+  TEST_ASSERT_TRUE(motif.load(2, tile, 2));
+  TEST_ASSERT_TRUE(motif.is_loaded());
+}
+
+void send_motif(uint8_t width, uint8_t height, uint16_t rows,
+                const uint8_t* tile, uint8_t length) {
+  uint8_t header[] = {0x0A, width, height, 0, 0, 0, highByte(rows),
+                      lowByte(rows), 0};
+  header[8] = Ayab.CRC8(header, 8);
+  Ayab.receive(header, sizeof(header));
+
+  uint8_t data[4 + MOTIF_MAX_BYTES];
+  data[0] = 0x0B;
+  data[1] = 0;
+  data[2] = length;
+  memcpy(data + 3, tile, length);
+  data[3 + length] = Ayab.CRC8(data, 3 + length);
+  Ayab.receive(data, 4 + length);
+}
+
+void test_standalone_knitting() {
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+
+  // 8 needles wide checkerboard, 3 rows to knit
+  uint8_t tile[] = {0x55, 0xAA};
+  send_motif(8, 2, 3, tile, sizeof(tile));
+  TEST_ASSERT_TRUE(KnittingProcess.get_motif().is_loaded());
+
+  // reqStart with the standalone flag: start=84, end=116, flags=0x0A
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, 0x0A, 0x99};
+  Ayab.receive(start_buffer, sizeof(start_buffer));
+  TEST_ASSERT_TRUE(KnittingProcess.is_standalone());
+
+  // Rows are installed without any cnfLine
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_EQUAL_HEX8(0xAA, KnittingProcess.get_pattern().get_buffer()[0]);
+  send_cnfLine(0, 0x00, 0x00);  // ignored
+  TEST_ASSERT_EQUAL_HEX8(0xAA, KnittingProcess.get_pattern().get_buffer()[0]);
+
+  knit_one_row();
+  TEST_ASSERT_EQUAL_HEX8(0x55, KnittingProcess.get_pattern().get_buffer()[0]);
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+
+  // The motif is kept for the next job
+  TEST_ASSERT_TRUE(KnittingProcess.get_motif().is_loaded());
+}
+
+void test_standalone_requires_motif() {
+  KnittingProcess.reset();
+  KnittingProcess.get_motif().configure(8, 2, 0, 0, 0, 0);  // not uploaded
+  KnittingProcess.init();
+  TEST_ASSERT_FALSE(
+      KnittingProcess.start_knitting(84, 116, false, false, false, true));
+  TEST_ASSERT_EQUAL(WaitingStart, KnittingProcess.get_knitting_state());
+}
+
+// Two rows baked in flash: needles 0-7 selected, then needles 8-15
+const uint8_t baked_rows[2][MAX_LINE_BUFFER_LEN] PROGMEM = {
+    {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    {0xFF, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}};
+
+void test_flash_pattern_knitting() {
+  KnittingProcess.reset();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+
+  TEST_ASSERT_FALSE(KnittingProcess.start_flash_pattern(nullptr, 2, 0, 15));
+  TEST_ASSERT_TRUE(KnittingProcess.start_flash_pattern(&baked_rows[0][0], 2,
+                                                       0, 15));
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  TEST_ASSERT_TRUE(KnittingProcess.is_standalone());
+
+  // Rows are knitted in place from flash
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_TRUE(KnittingProcess.get_pattern().is_buffer_in_flash());
+  TEST_ASSERT_EQUAL_PTR(baked_rows[0],
+                        KnittingProcess.get_pattern().get_buffer());
+  send_cnfLine(0, 0x00, 0x00);  // ignored
+  TEST_ASSERT_EQUAL_PTR(baked_rows[0],
+                        KnittingProcess.get_pattern().get_buffer());
+
+  knit_one_row();
+  TEST_ASSERT_EQUAL_PTR(baked_rows[1],
+                        KnittingProcess.get_pattern().get_buffer());
+  knit_one_row();
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void run_module_motif_tests() {
+  RUN_TEST(test_motif_render_repeat);
+  RUN_TEST(test_motif_render_offset_and_mirror);
+  RUN_TEST(test_motif_invalid);
+  RUN_TEST(test_standalone_knitting);
+  RUN_TEST(test_standalone_requires_motif);
+  RUN_TEST(test_flash_pattern_knitting);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_MOTIF_H
+#define TEST_MOTIF_H
+
+void run_module_motif_tests();
+
+#endif
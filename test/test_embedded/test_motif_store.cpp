@@ -0,0 +1,47 @@
+#include "test_motif_store.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "motif.h"
+
+static void make_motif(Motif& motif, uint16_t rows) {
+  // 12 needles wide, 3 rows, content depending on `rows`
+  uint8_t tile[6];
+  for (uint8_t i = 0; i < sizeof(tile); i++) {
+    tile[i] = static_cast<uint8_t>(rows + i);
+  }
+  motif.configure(12, 3, 1, 2, MOTIF_MIRROR_HORIZONTAL, rows);
+  motif.load(0, tile, sizeof(tile));
+}
+
+void test_motif_slot_protocol() {
+  // Goes through the MCU EEPROM (emulated by simavr)
+  KnittingProcess.reset();
+  make_motif(KnittingProcess.get_motif(), 12);
+
+  uint8_t save[] = {0x0C, 0x03, 0x00};
+  save[2] = Ayab.CRC8(save, 2);
+  Ayab.receive(save, sizeof(save));
+
+  // Replace the motif in SRAM, then load the saved one back by slot
+  make_motif(KnittingProcess.get_motif(), 99);
+  uint8_t load[] = {0x0D, 0x03, 0x00};
+  load[2] = Ayab.CRC8(load, 2);
+  Ayab.receive(load, sizeof(load));
+  TEST_ASSERT_TRUE(KnittingProcess.get_motif().is_loaded());
+  TEST_ASSERT_EQUAL(12, KnittingProcess.get_motif().get_rows());
+
+  // Ready to knit without any upload
+  KnittingProcess.init();
+  TEST_ASSERT_TRUE(
+      KnittingProcess.start_knitting(84, 116, false, false, false, true));
+  KnittingProcess.reset();
+}
+
+void run_module_motif_store_tests() {
+  RUN_TEST(test_motif_slot_protocol);
+}
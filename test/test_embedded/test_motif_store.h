@@ -0,0 +1,6 @@
+#ifndef TEST_MOTIF_STORE_H
+#define TEST_MOTIF_STORE_H
+
+void run_module_motif_store_tests();
+
+#endif
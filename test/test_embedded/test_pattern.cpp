@@ -154,6 +154,29 @@ void test_pattern_edge_cases() {
   TEST_ASSERT_NULL(pattern.get_buffer());
 }
 
+// Row stored in program memory, as written by scripts/bake_pattern.py
+const uint8_t flash_row[] PROGMEM = {0xF0, 0x0F};
+
+void test_pattern_flash_buffer() {
+  Pattern pattern;
+  pattern.set_needle_range(4, 12);
+  pattern.set_flash_buffer(flash_row);
+  TEST_ASSERT_TRUE(pattern.is_buffer_in_flash());
+  TEST_ASSERT_EQUAL_PTR(flash_row, pattern.get_buffer());
+
+  TEST_ASSERT_TRUE(pattern.get_needle_state(0, TO_RIGHT));   // offset 4
+  TEST_ASSERT_TRUE(pattern.get_needle_state(3, TO_RIGHT));   // offset 7
+  TEST_ASSERT_TRUE(pattern.get_needle_state(4, TO_RIGHT));   // offset 8
+  TEST_ASSERT_FALSE(pattern.get_needle_state(0, TO_LEFT));   // offset 12
+  TEST_ASSERT_FALSE(pattern.read_bit_little_endian(3));
+
+  // An SRAM buffer replaces the flash one
+  uint8_t buffer[] = {0x00, 0x00};
+  pattern.set_buffer(buffer);
+  TEST_ASSERT_FALSE(pattern.is_buffer_in_flash());
+  TEST_ASSERT_FALSE(pattern.get_needle_state(0, TO_RIGHT));
+}
+
 void run_module_pattern_tests() {
   RUN_TEST(test_pattern_needle_index_to_right);
   RUN_TEST(test_pattern_needle_index_to_left);
@@ -162,4 +185,5 @@ void run_module_pattern_tests() {
   RUN_TEST(test_pattern_get_needle_state_to_left);
   RUN_TEST(test_pattern_integration_with_real_data);
   RUN_TEST(test_pattern_edge_cases);
+  RUN_TEST(test_pattern_flash_buffer);
 }
@@ -0,0 +1,97 @@
+#include "test_retransmit.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "test_helpers.h"
+
+// Number of rows knitted by the simulated host
+const uint8_t RETRANSMIT_TEST_ROWS = 24;
+
+void knit_with_crc_errors(uint8_t error_period, uint16_t* frames_sent) {
+  /*
+   * Simulated host answering every reqLine, with one frame out of
+   * `error_period` corrupted (0 for none). The host resends as soon as the
+   * firmware asks for the same line again.
+   *
+   * @param frames_sent Set to the number of cnfLine frames sent to knit all
+   * the rows.
+   */
+  start_session(0x02, 0x5b);
+  uint16_t frames = 0;
+  uint8_t row = 0;
+  while (row < RETRANSMIT_TEST_ROWS) {
+    frames++;
+    bool corrupt = error_period != 0 && frames % error_period == 0;
+    uint16_t retransmits_before = Ayab.get_line_retransmits();
+    send_cnfLine(row, 0x00, row, corrupt);
+
+    if (Ayab.get_line_retransmits() != retransmits_before) {
+      // NACK: the same line is requested again within one round trip
+      TEST_ASSERT_TRUE(corrupt);
+      TEST_ASSERT_EQUAL(row, KnittingProcess.get_expected_line());
+      continue;
+    }
+    TEST_ASSERT_EQUAL_HEX8(static_cast<uint8_t>(~row),
+                           KnittingProcess.get_pattern().get_buffer()[0]);
+    knit_one_row();
+    row++;
+  }
+  *frames_sent = frames;
+  TEST_ASSERT_EQUAL(frames - RETRANSMIT_TEST_ROWS,
+                    Ayab.get_line_retransmits());
+}
+
+void test_cnfLine_crc_error_keeps_current_row() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+  const uint8_t* row = KnittingProcess.get_pattern().get_buffer();
+
+  // A corrupted line must not overwrite the row being knitted
+  send_cnfLine(1, 0x00, 0x00, true);
+  TEST_ASSERT_EQUAL_HEX8(0xF0, row[0]);
+  TEST_ASSERT_EQUAL(1, Ayab.get_line_retransmits());
+}
+
+void test_retransmit_throughput_degrades_gracefully() {
+  // Error periods from no error to one frame out of two
+  const uint8_t error_periods[] = {0, 10, 4, 2};
+  for (uint8_t period : error_periods) {
+    uint16_t frames = 0;
+    knit_with_crc_errors(period, &frames);
+    // Each error costs exactly one extra frame (one round trip)
+    uint16_t max_frames =
+        period == 0 ? RETRANSMIT_TEST_ROWS
+                    : RETRANSMIT_TEST_ROWS * period / (period - 1) + 1;
+    TEST_ASSERT_LESS_OR_EQUAL(max_frames, frames);
+    TEST_ASSERT_GREATER_OR_EQUAL(RETRANSMIT_TEST_ROWS, frames);
+  }
+}
+
+void test_batched_retransmit_goes_back() {
+  // reqStart with the batched lines flag
+  start_session(0x06, 0x3a);
+  send_cnfLine(0, 0x00, 0x00);
+  send_cnfLine(1, 0x00, 0x01, true);
+  send_cnfLine(2, 0x00, 0x02);  // dropped, line 1 is missing
+
+  TEST_ASSERT_EQUAL(1, Ayab.get_line_retransmits());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS - 1, KnittingProcess.get_line_credits());
+
+  // The host goes back to the expected line
+  send_cnfLine(1, 0x00, 0x01);
+  send_cnfLine(2, 0x00, 0x02);
+  TEST_ASSERT_EQUAL(3, KnittingProcess.get_expected_line());
+  knit_one_row();
+  TEST_ASSERT_EQUAL_HEX8(0xFE, KnittingProcess.get_pattern().get_buffer()[0]);
+}
+
+void run_module_retransmit_tests() {
+  RUN_TEST(test_cnfLine_crc_error_keeps_current_row);
+  RUN_TEST(test_retransmit_throughput_degrades_gracefully);
+  RUN_TEST(test_batched_retransmit_goes_back);
+}
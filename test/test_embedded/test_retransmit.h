@@ -0,0 +1,6 @@
+#ifndef TEST_RETRANSMIT_H
+#define TEST_RETRANSMIT_H
+
+void run_module_retransmit_tests();
+
+#endif
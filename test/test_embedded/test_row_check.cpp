@@ -0,0 +1,116 @@
+#include "test_row_check.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage_events.h"
+#include "row_check.h"
+#include "test_helpers.h"
+
+void test_row_check_count_bits() {
+  TEST_ASSERT_EQUAL(0, RowCheck::count_bits(0x00));
+  TEST_ASSERT_EQUAL(1, RowCheck::count_bits(0x80));
+  TEST_ASSERT_EQUAL(4, RowCheck::count_bits(0x5A));
+  TEST_ASSERT_EQUAL(8, RowCheck::count_bits(0xFF));
+}
+
+void test_row_check_needle_range() {
+  uint8_t row[MAX_LINE_BUFFER_LEN] = {0};
+  row[1] = 0xFF;  // Needles 8-15
+  row[2] = 0x01;  // Needle 16
+
+  RowCheck check;
+  for (int needle = 10; needle <= 16; needle++) {
+    check.record(needle, true);
+  }
+  // Needles 8 and 9 not selected, needle 17 selected by mistake
+  check.record(17, true);
+  TEST_ASSERT_EQUAL(3, check.check_row(row, false, 8, 17));
+  TEST_ASSERT_EQUAL(1, check.get_rows_with_errors());
+
+  // Outside of the needle range nothing is compared
+  TEST_ASSERT_EQUAL(0, check.check_row(row, false, 10, 16));
+  check.record(200, true);  // Past the last needle, ignored
+
+  // A needle passed again keeps its last level
+  check.record(10, false);
+  TEST_ASSERT_EQUAL(1, check.check_row(row, false, 10, 16));
+  TEST_ASSERT_EQUAL(1, check.get_row_mismatches());
+  TEST_ASSERT_EQUAL(2, check.get_rows_with_errors());
+
+  check.start_row();
+  TEST_ASSERT_EQUAL(0, check.get_observed()[1]);
+  check.clear();
+  TEST_ASSERT_EQUAL(0, check.get_rows_with_errors());
+}
+
+void test_row_check_knitting() {
+  // DOB HIGH on needles 84-87, 92-95, ... (cnfLine is inverted)
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+
+  // The whole row to the right (84 to 116) and out of the pattern
+  play_pin_trace("010");
+  for (int needle = 84; needle <= 116; needle++) {
+    play_pin_trace("110 010");
+  }
+  play_pin_trace("000 100");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_row_check().get_row_mismatches());
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_row_check().get_rows_with_errors());
+
+  // Next row to the left, leaving the pattern after 8 needles (116 to 109):
+  // 13 of the 17 needles to select were not selected
+  send_cnfLine(1, 0x00, 0x0F);
+  play_pin_trace("001 011");
+  for (int needle = 116; needle >= 109; needle--) {
+    play_pin_trace("111 011");
+  }
+  play_pin_trace("001 101");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(13, KnittingProcess.get_row_check().get_row_mismatches());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_row_check().get_rows_with_errors());
+
+  KnittingProcess.reset();
+  play_pin_trace("000");
+}
+
+void test_row_check_late_write() {
+  // The level compared is the one DOB held at the next CCP edge, not the one
+  // just written: a needle written after the carriage reached the next one
+  // is reported.
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x0F);
+
+  play_pin_trace("010");
+  for (int needle = 84; needle <= 87; needle++) {
+    play_pin_trace("110 010");
+  }
+  // Needles 88 and 89 pass while the loop is busy: DOB still holds the level
+  // of needle 87 (HIGH) when the edge of needle 89 comes, 88 is LOW
+  for (int needle = 88; needle <= 89; needle++) {
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    CarriageEvents::poll();  // Boards without the pin change interrupt
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    CarriageEvents::poll();
+  }
+  KnittingProcess.knitting_loop();
+  for (int needle = 90; needle <= 116; needle++) {
+    play_pin_trace("110 010");
+  }
+  play_pin_trace("000 100");
+  TEST_ASSERT_EQUAL(PHASE_TURNAROUND, KnittingProcess.get_phase());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_row_check().get_row_mismatches());
+
+  KnittingProcess.reset();
+  play_pin_trace("000");
+}
+
+void run_module_row_check_tests() {
+  RUN_TEST(test_row_check_count_bits);
+  RUN_TEST(test_row_check_needle_range);
+  RUN_TEST(test_row_check_knitting);
+  RUN_TEST(test_row_check_late_write);
+}
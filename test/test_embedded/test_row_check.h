@@ -0,0 +1,6 @@
+#ifndef TEST_ROW_CHECK_H
+#define TEST_ROW_CHECK_H
+
+void run_module_row_check_tests();
+
+#endif
@@ -0,0 +1,82 @@
+#include "test_row_dictionary.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "row_dictionary.h"
+#include "test_helpers.h"
+
+void send_cnfLineRef(uint8_t line_number, uint8_t slot) {
+  uint8_t buffer[] = {static_cast<uint8_t>(AYAB_API::cnfLineRef), line_number,
+                      slot, 0};
+  buffer[3] = Ayab.CRC8(buffer, 3);
+  Ayab.receive(buffer, sizeof(buffer));
+}
+
+void test_row_dictionary_slots() {
+  RowDictionary dictionary;
+  uint8_t line[MAX_LINE_BUFFER_LEN];
+  memset(line, 0x5A, sizeof(line));
+
+  TEST_ASSERT_NULL(dictionary.get(0));
+  TEST_ASSERT_TRUE(dictionary.store(ROW_DICTIONARY_SLOTS - 1, line));
+  TEST_ASSERT_FALSE(dictionary.store(ROW_DICTIONARY_SLOTS, line));
+  line[0] = 0x00;  // the row is copied
+  TEST_ASSERT_EQUAL_HEX8(0x5A, dictionary.get(ROW_DICTIONARY_SLOTS - 1)[0]);
+  TEST_ASSERT_NULL(dictionary.get(0));
+  TEST_ASSERT_NULL(dictionary.get(ROW_DICTIONARY_SLOTS));
+
+  dictionary.clear();
+  TEST_ASSERT_NULL(dictionary.get(ROW_DICTIONARY_SLOTS - 1));
+}
+
+void test_cnfLineRef_knits_stored_row() {
+  start_session(0x02, 0x5b);
+  // Row 0 stored in slot 2 while being knitted
+  send_cnfLine(0, STORE_ROW_FLAG | (2 << STORE_ROW_SLOT_SHIFT), 0x0F);
+  knit_one_row();
+
+  send_cnfLineRef(1, 2);
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL_HEX8(0xF0, KnittingProcess.get_pattern().get_buffer()[0]);
+  TEST_ASSERT_EQUAL(0, Ayab.get_line_retransmits());
+
+  // Empty slot: the host is asked for the full row again
+  knit_one_row();
+  send_cnfLineRef(2, 1);
+  TEST_ASSERT_EQUAL(1, Ayab.get_line_retransmits());
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_expected_line());
+
+  // Last line flag
+  send_cnfLineRef(2, 2 | LINE_REF_LAST_LINE_FLAG);
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+}
+
+void test_dictionary_cleared_and_batched() {
+  // A new session starts with an empty dictionary
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, STORE_ROW_FLAG, 0x0F);
+  start_session(0x06, 0x3a);
+  send_cnfLineRef(0, 0);
+  TEST_ASSERT_EQUAL(1, Ayab.get_line_retransmits());
+
+  // Batched: references are queued like full rows, dropped rows are not
+  // stored
+  send_cnfLine(0, STORE_ROW_FLAG, 0x01);
+  send_cnfLine(2, STORE_ROW_FLAG | (1 << STORE_ROW_SLOT_SHIFT), 0x02);
+  send_cnfLineRef(1, 0);
+  send_cnfLineRef(2, 1);
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_expected_line());
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS - 2, KnittingProcess.get_line_credits());
+  knit_one_row();
+  TEST_ASSERT_EQUAL_HEX8(0xFE, KnittingProcess.get_pattern().get_buffer()[0]);
+}
+
+void run_module_row_dictionary_tests() {
+  RUN_TEST(test_row_dictionary_slots);
+  RUN_TEST(test_cnfLineRef_knits_stored_row);
+  RUN_TEST(test_dictionary_cleared_and_batched);
+}
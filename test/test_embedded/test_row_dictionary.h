@@ -0,0 +1,6 @@
+#ifndef TEST_ROW_DICTIONARY_H
+#define TEST_ROW_DICTIONARY_H
+
+void run_module_row_dictionary_tests();
+
+#endif
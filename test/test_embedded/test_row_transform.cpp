@@ -0,0 +1,149 @@
+#include "test_row_transform.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "row_transform.h"
+#include "test_helpers.h"
+
+bool needle_bit(const uint8_t* line, uint8_t needle) {
+  return bitRead(line[needle >> 3], needle & BIT_INDEX_MASK);
+}
+
+bool reference_transform(const uint8_t* line, uint8_t flags, uint8_t shift,
+                         uint8_t start, uint8_t end, uint8_t needle) {
+  /*
+   * Needle by needle definition of the transform, to check the byte-wise one.
+   */
+  uint8_t width = end - start + 1;
+  uint8_t p = needle - start;
+  p = (p + width - shift % width) % width;  // circular shift
+  if (flags & TRANSFORM_MIRROR) {
+    p = width - 1 - p;
+  }
+  if (flags & TRANSFORM_DOUBLE_WIDTH) {
+    p >>= 1;
+  }
+  return needle_bit(line, start + p) != bool(flags & TRANSFORM_INVERT);
+}
+
+void test_row_transform_identity() {
+  RowTransform transform;
+  TEST_ASSERT_TRUE(transform.is_identity());
+  TEST_ASSERT_EQUAL(1, transform.get_row_repeat());
+  TEST_ASSERT_TRUE(transform.configure(0, 3, 0));
+  TEST_ASSERT_TRUE(transform.is_identity());  // repeat is not a row change
+
+  TEST_ASSERT_FALSE(transform.configure(0x80, 1, 0));  // unknown flag
+  TEST_ASSERT_FALSE(transform.configure(0, 0, 0));     // no pass
+  TEST_ASSERT_EQUAL(3, transform.get_row_repeat());
+}
+
+void test_row_transform_basic() {
+  RowTransform transform;
+  uint8_t line[MAX_LINE_BUFFER_LEN];
+  uint8_t output[MAX_LINE_BUFFER_LEN];
+  memset(line, 0xFF, sizeof(line));
+  line[1] = 0xFE;  // needle 8 selected, range 8-15
+
+  transform.configure(TRANSFORM_MIRROR, 1, 0);
+  transform.apply(line, false, 8, 15, output);
+  TEST_ASSERT_EQUAL_HEX8(0x7F, output[1]);
+
+  transform.configure(TRANSFORM_INVERT, 1, 0);
+  transform.apply(line, false, 8, 15, output);
+  TEST_ASSERT_EQUAL_HEX8(0x01, output[1]);
+
+  transform.configure(TRANSFORM_DOUBLE_WIDTH, 1, 0);
+  transform.apply(line, false, 8, 15, output);
+  TEST_ASSERT_EQUAL_HEX8(0xFC, output[1]);
+
+  transform.configure(0, 1, 3);
+  transform.apply(line, false, 8, 15, output);
+  TEST_ASSERT_EQUAL_HEX8(0xF7, output[1]);
+  transform.configure(0, 1, 11);  // modulo the range width
+  transform.apply(line, false, 8, 15, output);
+  TEST_ASSERT_EQUAL_HEX8(0xF7, output[1]);
+}
+
+void test_row_transform_matches_reference() {
+  // Pseudo random row, every flag combination, unaligned ranges
+  uint8_t line[MAX_LINE_BUFFER_LEN];
+  uint8_t output[MAX_LINE_BUFFER_LEN];
+  uint8_t seed = 0x5A;
+  for (uint8_t i = 0; i < MAX_LINE_BUFFER_LEN; i++) {
+    seed = seed * 37 + 11;
+    line[i] = seed;
+  }
+  const uint8_t ranges[][2] = {{0, 199}, {3, 60}, {84, 116}, {150, 150}};
+  const uint8_t shifts[] = {0, 1, 9, 57};
+
+  RowTransform transform;
+  for (const auto& range : ranges) {
+    for (uint8_t flags = 0; flags <= TRANSFORM_FLAGS_MASK; flags++) {
+      for (uint8_t shift : shifts) {
+        transform.configure(flags, 1, shift);
+        transform.apply(line, false, range[0], range[1], output);
+        for (uint8_t needle = range[0]; needle <= range[1]; needle++) {
+          bool expected = reference_transform(line, flags, shift, range[0],
+                                              range[1], needle);
+          if (needle_bit(output, needle) != expected) {
+            TEST_FAIL_MESSAGE("Byte-wise transform differs from reference");
+          }
+        }
+      }
+    }
+  }
+}
+
+void test_row_repeat_and_transform_while_knitting() {
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+
+  // reqTransform: invert, each row knitted twice
+  uint8_t transform_buffer[] = {0x0E, TRANSFORM_INVERT, 2, 0, 0};
+  transform_buffer[4] = Ayab.CRC8(transform_buffer, 4);
+  Ayab.receive(transform_buffer, sizeof(transform_buffer));
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_row_transform().get_row_repeat());
+
+  // reqStart: start=84, end=116, flags=0x06 (batched lines)
+  uint8_t start_buffer[] = {0x01, 0x54, 0x74, 0x06, 0x3a};
+  Ayab.receive(start_buffer, sizeof(start_buffer));
+  KnittingProcess.knitting_loop();  // requests the first row
+
+  // Not allowed once knitting
+  uint8_t late_buffer[] = {0x0E, 0, 1, 0, 0};
+  late_buffer[4] = Ayab.CRC8(late_buffer, 4);
+  Ayab.receive(late_buffer, sizeof(late_buffer));
+  TEST_ASSERT_EQUAL(2, KnittingProcess.get_row_transform().get_row_repeat());
+
+  send_cnfLine(0, 0x00, 0xFF);  // every needle selected by the host
+  // Needle 84 is bit 4 of byte 10, colour inverted: not selected (bit set)
+  TEST_ASSERT_EQUAL(1, bitRead(KnittingProcess.get_pattern().get_buffer()[10],
+                               4));
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS - 1, KnittingProcess.get_line_credits());
+
+  knit_one_row();  // first pass, the row keeps its slot
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS - 1, KnittingProcess.get_line_credits());
+  knit_one_row();  // second pass, the row is released
+  TEST_ASSERT_EQUAL(LINE_QUEUE_SLOTS, KnittingProcess.get_line_credits());
+
+  // reqInit starts a new session without transform
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  TEST_ASSERT_TRUE(KnittingProcess.get_row_transform().is_identity());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_row_transform().get_row_repeat());
+}
+
+void run_module_row_transform_tests() {
+  RUN_TEST(test_row_transform_identity);
+  RUN_TEST(test_row_transform_basic);
+  RUN_TEST(test_row_transform_matches_reference);
+  RUN_TEST(test_row_repeat_and_transform_while_knitting);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_ROW_TRANSFORM_H
+#define TEST_ROW_TRANSFORM_H
+
+void run_module_row_transform_tests();
+
+#endif
@@ -0,0 +1,93 @@
+#include "test_scheduler.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage_events.h"
+#include "scheduler.h"
+#include "test_helpers.h"
+
+bool urgent_pending = false;
+bool normal_pending = false;
+uint8_t last_task = 0;
+
+void urgent_task() {
+  urgent_pending = false;
+  last_task = 1;
+}
+void normal_task() {
+  normal_pending = false;
+  last_task = 2;
+}
+void slack_task() { last_task = 3; }
+void slow_task() { delayMicroseconds(500); }
+bool is_urgent_pending() { return urgent_pending; }
+bool is_normal_pending() { return normal_pending; }
+
+void test_scheduler_priorities() {
+  Scheduler scheduler;
+  TEST_ASSERT_FALSE(scheduler.run_once());  // No task
+
+  // Added out of order, run by priority
+  scheduler.add_task(slack_task, nullptr, 2, 100);
+  scheduler.add_task(normal_task, is_normal_pending, 1, 100);
+  scheduler.add_task(urgent_task, is_urgent_pending, 0, 100);
+  TEST_ASSERT_EQUAL(3, scheduler.get_task_count());
+  TEST_ASSERT_EQUAL(0, scheduler.get_task(0).priority);
+
+  urgent_pending = true;
+  normal_pending = true;
+  TEST_ASSERT_TRUE(scheduler.run_once());
+  TEST_ASSERT_EQUAL(1, last_task);
+  TEST_ASSERT_TRUE(scheduler.run_once());
+  TEST_ASSERT_EQUAL(2, last_task);
+
+  // The slack time task only runs when nothing else is pending
+  TEST_ASSERT_FALSE(scheduler.has_pending_task());
+  TEST_ASSERT_TRUE(scheduler.run_once());
+  TEST_ASSERT_EQUAL(3, last_task);
+  urgent_pending = true;
+  TEST_ASSERT_TRUE(scheduler.has_pending_task());
+  scheduler.run_once();
+  TEST_ASSERT_EQUAL(1, last_task);
+}
+
+void test_scheduler_budget() {
+  Scheduler scheduler;
+  TEST_ASSERT_TRUE(scheduler.add_task(slow_task, nullptr, 0, 100));
+  scheduler.run_once();
+  TEST_ASSERT_EQUAL(1, scheduler.get_task(0).overruns);
+  TEST_ASSERT_GREATER_OR_EQUAL(500, scheduler.get_task(0).max_run_us);
+
+  for (uint8_t i = 1; i < SCHEDULER_MAX_TASKS; i++) {
+    TEST_ASSERT_TRUE(scheduler.add_task(slack_task, nullptr, 1, 100));
+  }
+  TEST_ASSERT_FALSE(scheduler.add_task(slack_task, nullptr, 1, 100));
+}
+
+void test_edge_latency_measured() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_max_edge_latency_us());
+
+  // The edge waits 2 ms for the carriage task
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  CarriageEvents::poll();
+  delayMicroseconds(2000);
+  TEST_ASSERT_TRUE(CarriageEvents::is_pending());
+  TEST_ASSERT_TRUE(KnittingProcess.service_carriage_events());
+  TEST_ASSERT_GREATER_OR_EQUAL(2000, KnittingProcess.get_max_edge_latency_us());
+  TEST_ASSERT_FALSE(KnittingProcess.service_carriage_events());
+
+  KnittingProcess.reset();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  KnittingProcess.knitting_loop();
+}
+
+void run_module_scheduler_tests() {
+  RUN_TEST(test_scheduler_priorities);
+  RUN_TEST(test_scheduler_budget);
+  RUN_TEST(test_edge_latency_measured);
+}
@@ -0,0 +1,59 @@
+#include "test_session_checkpoint.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "session_checkpoint.h"
+#include "test_helpers.h"
+
+void test_checkpoint_resume_session() {
+  // reqStart flags 0x02: beeper
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0xFF);
+  knit_one_row();
+  for (uint8_t i = 0; i < 2 * CHECKPOINT_WRITE_STEPS; i++) {
+    KnittingProcess.housekeeping();
+  }
+  TEST_ASSERT_FALSE(KnittingProcess.is_checkpoint_pending());
+  CheckpointRecord record;
+  TEST_ASSERT_TRUE(KnittingProcess.load_checkpoint(record));
+  TEST_ASSERT_EQUAL(84, record.start_needle);
+  TEST_ASSERT_EQUAL(116, record.end_needle);
+  TEST_ASSERT_EQUAL(0x02, record.flags);
+  TEST_ASSERT_EQUAL(1, record.line);
+
+  // Reset, then the host resumes the session: line 1 is requested first
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  uint8_t resume[] = {static_cast<uint8_t>(AYAB_API::reqResume),
+                      RESUME_SESSION, 0};
+  resume[2] = Ayab.CRC8(resume, 2);
+  Ayab.receive(resume, sizeof(resume));
+  TEST_ASSERT_EQUAL(Knitting, KnittingProcess.get_knitting_state());
+  TEST_ASSERT_EQUAL(84, KnittingProcess.get_start_needle());
+  TEST_ASSERT_EQUAL(1, KnittingProcess.get_expected_line());
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_EQUAL(PHASE_PREFETCH, KnittingProcess.get_phase());
+  send_cnfLine(1, 0x00, 0xFF);
+  TEST_ASSERT_EQUAL(PHASE_ROW_READY, KnittingProcess.get_phase());
+
+  // Resuming needs reqInit first
+  Ayab.receive(resume, sizeof(resume));
+  TEST_ASSERT_EQUAL(PHASE_ROW_READY, KnittingProcess.get_phase());
+
+  // The last line ends the session
+  send_cnfLine(2, 0x01, 0x00);
+  for (uint8_t i = 0; i < 2 * CHECKPOINT_WRITE_STEPS; i++) {
+    KnittingProcess.housekeeping();
+  }
+  TEST_ASSERT_FALSE(KnittingProcess.load_checkpoint(record));
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+}
+
+void run_module_session_checkpoint_tests() {
+  RUN_TEST(test_checkpoint_resume_session);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SESSION_CHECKPOINT_H
+#define TEST_SESSION_CHECKPOINT_H
+
+void run_module_session_checkpoint_tests();
+
+#endif
@@ -0,0 +1,201 @@
+#include "test_signal_filter.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage_sampler.h"
+#include "machine/signal_filter.h"
+#include "test_helpers.h"
+
+void test_integrator_filter() {
+  SignalFilter filter;
+  TEST_ASSERT_TRUE(filter.configure(FILTER_INTEGRATOR, 4));
+  filter.reset(LOW);
+  TEST_ASSERT_EQUAL(4, filter.get_latency_samples());
+
+  // A burst shorter than the depth is rejected
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_FALSE(filter.sample(HIGH));
+  }
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_FALSE(filter.sample(LOW));
+  }
+  TEST_ASSERT_EQUAL(1, filter.get_rejected_glitches());
+
+  // A clean edge goes through after `depth` samples
+  for (uint8_t i = 0; i < 3; i++) {
+    TEST_ASSERT_FALSE(filter.sample(HIGH));
+  }
+  TEST_ASSERT_TRUE(filter.sample(HIGH));
+  TEST_ASSERT_EQUAL(1, filter.get_rejected_glitches());
+
+  // A one sample dropout while HIGH
+  TEST_ASSERT_TRUE(filter.sample(LOW));
+  TEST_ASSERT_TRUE(filter.sample(HIGH));
+  TEST_ASSERT_EQUAL(2, filter.get_rejected_glitches());
+}
+
+void test_majority_filter() {
+  SignalFilter filter;
+  TEST_ASSERT_TRUE(filter.configure(FILTER_MAJORITY, 5));
+  filter.reset(LOW);
+  TEST_ASSERT_EQUAL(3, filter.get_latency_samples());
+
+  // Two samples out of five are outvoted
+  TEST_ASSERT_FALSE(filter.sample(HIGH));
+  TEST_ASSERT_FALSE(filter.sample(HIGH));
+  for (uint8_t i = 0; i < 5; i++) {
+    TEST_ASSERT_FALSE(filter.sample(LOW));
+  }
+  TEST_ASSERT_EQUAL(1, filter.get_rejected_glitches());
+
+  TEST_ASSERT_FALSE(filter.sample(HIGH));
+  TEST_ASSERT_FALSE(filter.sample(HIGH));
+  TEST_ASSERT_TRUE(filter.sample(HIGH));
+}
+
+void test_filter_configuration() {
+  SignalFilter filter;
+  TEST_ASSERT_FALSE(filter.configure(FILTER_MAJORITY, 4));  // even window
+  TEST_ASSERT_FALSE(filter.configure(FILTER_MAJORITY, 9));
+  TEST_ASSERT_FALSE(filter.configure(FILTER_INTEGRATOR, 16));
+  TEST_ASSERT_FALSE(filter.configure(2, 3));
+
+  // Depth 1 passes the samples through
+  TEST_ASSERT_TRUE(filter.configure(FILTER_INTEGRATOR, 1));
+  TEST_ASSERT_FALSE(filter.is_filtering());
+  TEST_ASSERT_EQUAL(0, filter.get_latency_samples());
+  TEST_ASSERT_TRUE(filter.sample(HIGH));
+  TEST_ASSERT_FALSE(filter.sample(LOW));
+}
+
+// Simulated CCP line: 20 needles of 40 samples (4 ms at 100 us, the highest
+// safe speed) with 1 or 2 sample glitches injected away from the edges
+const uint8_t SIMULATED_NEEDLES = 20;
+const uint8_t SAMPLES_PER_NEEDLE = 40;
+
+bool simulated_ccp(uint16_t sample, uint16_t& seed) {
+  uint8_t phase = sample % SAMPLES_PER_NEEDLE;
+  bool level = phase < SAMPLES_PER_NEEDLE / 2;
+  seed = seed * 25173U + 13849U;
+  uint8_t slot = phase % 10;
+  // One glitch position every 10 samples, in the middle of the levels
+  if ((slot == 4 || slot == 5) && phase > 5 && phase < 35 &&
+      (seed >> 13) < 5) {
+    return !level;
+  }
+  return level;
+}
+
+void check_simulated_ccp(uint8_t mode, uint8_t depth) {
+  SignalFilter filter;
+  filter.configure(mode, depth);
+  filter.reset(LOW);
+  uint16_t seed = 1;
+  bool raw_previous = false;
+  bool filtered_previous = false;
+  uint8_t raw_edges = 0;
+  uint8_t filtered_edges = 0;
+
+  for (uint16_t sample = 0; sample < SIMULATED_NEEDLES * SAMPLES_PER_NEEDLE;
+       sample++) {
+    bool raw = simulated_ccp(sample, seed);
+    bool filtered = filter.sample(raw);
+    raw_edges += raw && !raw_previous;
+    if (filtered && !filtered_previous) {
+      // Delayed by the latency of the filter from the real edge
+      TEST_ASSERT_EQUAL(filter.get_latency_samples() - 1,
+                        sample % SAMPLES_PER_NEEDLE);
+      filtered_edges++;
+    }
+    raw_previous = raw;
+    filtered_previous = filtered;
+  }
+  TEST_ASSERT_GREATER_THAN(SIMULATED_NEEDLES, raw_edges);
+  TEST_ASSERT_EQUAL(SIMULATED_NEEDLES, filtered_edges);
+  TEST_ASSERT_GREATER_THAN(0, filter.get_rejected_glitches());
+}
+
+void test_filter_simulated_glitches() {
+  check_simulated_ccp(FILTER_INTEGRATOR, 3);
+  check_simulated_ccp(FILTER_MAJORITY, 5);
+}
+
+void send_signal_filter(uint8_t ccp, uint8_t ksl, uint8_t hok) {
+  uint8_t buffer[] = {0x10, ccp, ksl, hok, 0};
+  buffer[4] = Ayab.CRC8(buffer, 4);
+  Ayab.receive(buffer, sizeof(buffer));
+}
+
+void settle_filters() {
+  // Long enough for the filters to follow the pins, sampled by the timer or
+  // by each loop
+  for (uint8_t i = 0; i <= SIGNAL_FILTER_MAX_DEPTH; i++) {
+    delayMicroseconds(SIGNAL_SAMPLE_PERIOD_US);
+    KnittingProcess.knitting_loop();
+  }
+}
+
+void ccp_glitch() {
+  // One or two samples long, whatever samples the pin
+  digitalWrite(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();
+  delayMicroseconds(SIGNAL_SAMPLE_PERIOD_US * 3 / 2);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  settle_filters();
+}
+
+void test_filtered_knitting() {
+  KnittingProcess.reset();
+  // CCP integrator over 3 samples, KSL and HOK unfiltered
+  send_signal_filter(0x03, 0x00, 0x00);
+  TEST_ASSERT_TRUE(CarriageSampler::is_enabled());
+  TEST_ASSERT_EQUAL(3, CarriageSampler::get_latency_samples(SAMPLED_CCP));
+
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  settle_filters();
+
+  for (uint8_t needle = 0; needle < 5; needle++) {
+    ccp_glitch();
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    settle_filters();
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    settle_filters();
+    // Only the real needles are counted
+    TEST_ASSERT_EQUAL(needle, KnittingProcess.get_current_needle_index());
+  }
+  TEST_ASSERT_EQUAL(5, CarriageSampler::get_rejected_glitches(SAMPLED_CCP));
+
+  // Refused while knitting, and an invalid filter changes nothing
+  send_signal_filter(0x00, 0x00, 0x00);
+  TEST_ASSERT_TRUE(CarriageSampler::is_enabled());
+  KnittingProcess.reset();
+  send_signal_filter(0x84, 0x00, 0x00);
+  TEST_ASSERT_EQUAL(3, CarriageSampler::get_latency_samples(SAMPLED_CCP));
+
+  // Without the filter, the same glitch is a needle
+  send_signal_filter(0x00, 0x00, 0x00);
+  TEST_ASSERT_FALSE(CarriageSampler::is_enabled());
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  KnittingProcess.knitting_loop();
+  ccp_glitch();
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_current_needle_index());
+  KnittingProcess.reset();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+}
+
+void run_module_signal_filter_tests() {
+  RUN_TEST(test_integrator_filter);
+  RUN_TEST(test_majority_filter);
+  RUN_TEST(test_filter_configuration);
+  RUN_TEST(test_filter_simulated_glitches);
+  RUN_TEST(test_filtered_knitting);
+}
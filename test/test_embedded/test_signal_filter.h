@@ -0,0 +1,6 @@
+#ifndef TEST_SIGNAL_FILTER_H
+#define TEST_SIGNAL_FILTER_H
+
+void run_module_signal_filter_tests();
+
+#endif
@@ -0,0 +1,123 @@
+#include "test_slip_link.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/slip_link.h"
+#include "communication/transport.h"
+
+const size_t LOOPBACK_SIZE = 64;
+
+// Transport writing into its own input, to check the framing both ways
+class LoopbackTransport : public Transport<LoopbackTransport> {
+ private:
+  uint8_t bytes[LOOPBACK_SIZE];
+  size_t head = 0;
+  size_t tail = 0;
+
+ public:
+  using Transport<LoopbackTransport>::write;
+
+  void begin(uint32_t baudrate) { this->head = this->tail = 0; }
+  int available() { return this->tail - this->head; }
+  int read() {
+    return this->head < this->tail ? this->bytes[this->head++] : -1;
+  }
+  void write(uint8_t byte) {
+    if (this->tail < LOOPBACK_SIZE) {
+      this->bytes[this->tail++] = byte;
+    }
+  }
+  void flush() {}
+  size_t get_size() const { return this->tail; }
+  uint8_t get(size_t index) const { return this->bytes[index]; }
+};
+
+uint8_t received[LOOPBACK_SIZE];
+size_t received_size = 0;
+uint8_t received_packets = 0;
+
+unsigned long received_start_us = 0;
+
+void record_packet(const uint8_t* buffer, size_t size, unsigned long start_us) {
+  memcpy(received, buffer, size);
+  received_size = size;
+  received_start_us = start_us;
+  received_packets++;
+}
+
+typedef SlipLink<LoopbackTransport, 8, record_packet> TestLink;
+
+void reset_received() {
+  received_size = 0;
+  received_packets = 0;
+}
+
+void test_slip_link_round_trip() {
+  TestLink link;
+  reset_received();
+  const uint8_t packet[] = {0x01, Slip::END, 0x02, Slip::ESC, Slip::ESC_END};
+  link.send(packet, sizeof(packet));
+
+  // END, 0x01, ESC ESC_END, 0x02, ESC ESC_ESC, ESC_END, END
+  const uint8_t encoded[] = {Slip::END,     0x01,      Slip::ESC,
+                             Slip::ESC_END, 0x02,      Slip::ESC,
+                             Slip::ESC_ESC, Slip::ESC_END, Slip::END};
+  LoopbackTransport& transport = link.get_transport();
+  TEST_ASSERT_EQUAL(sizeof(encoded), transport.get_size());
+  for (size_t i = 0; i < sizeof(encoded); i++) {
+    TEST_ASSERT_EQUAL_HEX8(encoded[i], transport.get(i));
+  }
+
+  link.update(UINT8_MAX, 0);
+  // The leading END gives an empty packet, ignored by the AYAB handler
+  TEST_ASSERT_EQUAL(2, received_packets);
+  TEST_ASSERT_EQUAL(sizeof(packet), received_size);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, received, sizeof(packet));
+  TEST_ASSERT_FALSE(transport.has_input());
+
+  // Empty packets are not sent
+  link.send(packet, 0);
+  TEST_ASSERT_EQUAL(sizeof(encoded), transport.get_size());
+}
+
+void test_slip_link_budget() {
+  TestLink link;
+  reset_received();
+  const uint8_t packet[] = {0x11, 0x22, 0x33};
+  link.send(packet, sizeof(packet));
+
+  // A packet completed over several calls, no more bytes read than allowed,
+  // with the time of the call that read its first byte
+  link.update(3, 100);
+  TEST_ASSERT_EQUAL(1, received_packets);
+  TEST_ASSERT_TRUE(link.get_transport().has_input());
+  link.update(1, 200);
+  TEST_ASSERT_EQUAL(1, received_packets);
+  link.update(1, 300);
+  TEST_ASSERT_EQUAL(2, received_packets);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, received, sizeof(packet));
+  TEST_ASSERT_EQUAL_UINT32(100, received_start_us);
+  TEST_ASSERT_FALSE(link.get_transport().has_input());
+}
+
+void test_slip_link_overflow() {
+  TestLink link;
+  reset_received();
+  const uint8_t packet[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  link.send(packet, sizeof(packet));
+  link.update(UINT8_MAX, 0);
+
+  // Truncated to the buffer, the next packet is received whole
+  TEST_ASSERT_EQUAL(8, received_size);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(packet, received, 8);
+  link.send(packet, 2);
+  link.update(UINT8_MAX, 0);
+  TEST_ASSERT_EQUAL(2, received_size);
+}
+
+void run_module_slip_link_tests() {
+  RUN_TEST(test_slip_link_round_trip);
+  RUN_TEST(test_slip_link_budget);
+  RUN_TEST(test_slip_link_overflow);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_SLIP_LINK_H
+#define TEST_SLIP_LINK_H
+
+void run_module_slip_link_tests();
+
+#endif
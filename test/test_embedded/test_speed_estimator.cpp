@@ -0,0 +1,146 @@
+#include "test_speed_estimator.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "machine/speed_estimator.h"
+#include "test_helpers.h"
+
+void test_speed_constant_period() {
+  SpeedEstimator estimator;
+  TEST_ASSERT_FALSE(estimator.is_valid());
+  TEST_ASSERT_EQUAL(0, estimator.get_needles_per_second());
+
+  unsigned long time = 1000;
+  estimator.record_edge(time);
+  TEST_ASSERT_FALSE(estimator.is_valid());  // one edge is not a period
+  for (int i = 0; i < 20; i++) {
+    time += 4000;  // 4 ms per needle
+    estimator.record_edge(time);
+  }
+  TEST_ASSERT_TRUE(estimator.is_valid());
+  TEST_ASSERT_EQUAL(250, estimator.get_needles_per_second());
+}
+
+void test_speed_moving_average() {
+  SpeedEstimator estimator;
+  unsigned long time = 0;
+  estimator.record_edge(time);
+  for (int i = 0; i < 20; i++) {
+    time += 10000;  // 100 needles per second
+    estimator.record_edge(time);
+  }
+
+  // A single short period (noise) barely moves the average
+  time += 2000;
+  estimator.record_edge(time);
+  TEST_ASSERT_LESS_THAN(115, estimator.get_needles_per_second());
+
+  // A sustained change is followed within a few tens of needles
+  for (int i = 0; i < 40; i++) {
+    time += 5000;
+    estimator.record_edge(time);
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL(195, estimator.get_needles_per_second());
+  TEST_ASSERT_LESS_OR_EQUAL(200, estimator.get_needles_per_second());
+
+  // The carriage stops: the estimate restarts
+  time += SPEED_STOPPED_PERIOD_US + 1;
+  estimator.record_edge(time);
+  TEST_ASSERT_FALSE(estimator.is_valid());
+  time += 8000;
+  estimator.record_edge(time);
+  TEST_ASSERT_EQUAL(125, estimator.get_needles_per_second());
+  TEST_ASSERT_GREATER_OR_EQUAL(195, estimator.get_max_needles_per_second());
+}
+
+void test_speed_threshold_period() {
+  // Comparing periods gives the same result as comparing the speeds
+  const unsigned long periods[] = {4444, 4445};
+  for (uint8_t i = 0; i < 2; i++) {
+    SpeedEstimator estimator;
+    unsigned long time = 0;
+    for (int edge = 0; edge < 20; edge++) {
+      estimator.record_edge(time);
+      time += periods[i];
+    }
+    uint16_t speed = estimator.get_needles_per_second();
+    TEST_ASSERT_EQUAL(i == 0 ? 225 : 224, speed);
+    TEST_ASSERT_EQUAL(speed >= 225,
+                      estimator.reaches(SpeedEstimator::period_of(225)));
+    TEST_ASSERT_EQUAL(speed, estimator.get_max_needles_per_second());
+  }
+  TEST_ASSERT_FALSE(SpeedEstimator().reaches(SpeedEstimator::period_of(1)));
+}
+
+void knit_needles(uint8_t count, unsigned int period_us) {
+  // CCP pulses in the pattern section, `period_us` apart
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  for (uint8_t i = 0; i < count; i++) {
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    KnittingProcess.knitting_loop();
+    delayMicroseconds(period_us);
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    KnittingProcess.knitting_loop();
+  }
+}
+
+void test_overspeed_warning() {
+  start_session(0x02, 0x5b);
+  send_cnfLine(0, 0x00, 0x00);
+
+  // 200 needles per second: below the warning speed
+  knit_needles(16, 5000);
+  TEST_ASSERT_FALSE(KnittingProcess.has_overspeed_warning());
+
+  // 400 needles per second: warned once for the row
+  knit_needles(16, 2500);
+  TEST_ASSERT_GREATER_THAN(MAX_SAFE_NEEDLES_PER_SECOND,
+                           KnittingProcess.get_speed_estimator()
+                               .get_needles_per_second());
+  TEST_ASSERT_TRUE(KnittingProcess.has_overspeed_warning());
+
+  // Leaving the pattern section re-arms the warning for the next row
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_FALSE(KnittingProcess.has_overspeed_warning());
+}
+
+void test_state_reported_after_row_request() {
+  // Continuous reporting: the row ends with reqLine, then indState
+  start_session(0x01, 0xb9);
+  send_cnfLine(0, 0x00, 0x00);
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  for (int i = 0; i < 4; i++) {
+    digitalWrite(PinsCorrespondance::CCP, LOW);
+    KnittingProcess.knitting_loop();
+    digitalWrite(PinsCorrespondance::CCP, HIGH);
+    KnittingProcess.knitting_loop();
+  }
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  KnittingProcess.knitting_loop();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  KnittingProcess.knitting_loop();
+
+  size_t sent_count = Ayab.get_transport().get_sent_count();
+  digitalWrite(PinsCorrespondance::CCP, HIGH);
+  KnittingProcess.knitting_loop();  // end of the row
+  TEST_ASSERT_EQUAL(sent_count + 2, Ayab.get_transport().get_sent_count());
+  TEST_ASSERT_EQUAL(12, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0x84, Ayab.get_transport().get_sent_packet()[0]);
+}
+
+void run_module_speed_estimator_tests() {
+  RUN_TEST(test_speed_constant_period);
+  RUN_TEST(test_speed_moving_average);
+  RUN_TEST(test_speed_threshold_period);
+  RUN_TEST(test_overspeed_warning);
+  RUN_TEST(test_state_reported_after_row_request);
+}
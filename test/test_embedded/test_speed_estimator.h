@@ -0,0 +1,6 @@
+#ifndef TEST_SPEED_ESTIMATOR_H
+#define TEST_SPEED_ESTIMATOR_H
+
+void run_module_speed_estimator_tests();
+
+#endif
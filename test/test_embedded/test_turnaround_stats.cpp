@@ -0,0 +1,129 @@
+#include "test_turnaround_stats.h"
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include "boot_timing.h"
+#include "communication/ayab.h"
+#include "config.h"
+#include "knitting.h"
+#include "machine/carriage_sampler.h"
+#include "test_helpers.h"
+#include "turnaround_stats.h"
+
+uint32_t read_big_endian(const uint8_t* bytes, uint8_t size) {
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < size; i++) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+void test_turnaround_histogram_bins() {
+  TEST_ASSERT_EQUAL(0, TurnaroundStats::histogram_bin(0));
+  TEST_ASSERT_EQUAL(0, TurnaroundStats::histogram_bin(999));
+  TEST_ASSERT_EQUAL(1, TurnaroundStats::histogram_bin(1000));
+  TEST_ASSERT_EQUAL(2, TurnaroundStats::histogram_bin(2500));
+  TEST_ASSERT_EQUAL(5, TurnaroundStats::histogram_bin(20000));
+  TEST_ASSERT_EQUAL(TURNAROUND_HISTOGRAM_BINS - 1,
+                    TurnaroundStats::histogram_bin(5000000));
+}
+
+void test_turnaround_min_avg_max() {
+  TurnaroundStats stats;
+  TEST_ASSERT_EQUAL(0, stats.get_count());
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_min_us());
+  TEST_ASSERT_EQUAL_UINT32(0, stats.get_average_us());
+
+  stats.record(1000);
+  stats.record(3000);
+  stats.record(500);
+  stats.record_stale_row();
+  TEST_ASSERT_EQUAL(3, stats.get_count());
+  TEST_ASSERT_EQUAL_UINT32(500, stats.get_min_us());
+  TEST_ASSERT_EQUAL_UINT32(1500, stats.get_average_us());
+  TEST_ASSERT_EQUAL_UINT32(3000, stats.get_max_us());
+  TEST_ASSERT_EQUAL(1, stats.get_stale_rows());
+  TEST_ASSERT_EQUAL(1, stats.get_histogram(0));
+  TEST_ASSERT_EQUAL(1, stats.get_histogram(1));
+  TEST_ASSERT_EQUAL(1, stats.get_histogram(2));
+
+  stats.clear();
+  TEST_ASSERT_EQUAL(0, stats.get_count());
+  TEST_ASSERT_EQUAL(0, stats.get_stale_rows());
+}
+
+void test_turnaround_measured_per_row() {
+  KnittingProcess.reset();
+  KnittingProcess.init();
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+  digitalWrite(PinsCorrespondance::CCP, LOW);
+  digitalWrite(PinsCorrespondance::HOK, LOW);
+  KnittingProcess.start_knitting(84, 116, false, false);
+  KnittingProcess.knitting_loop();  // requests the first row
+  send_cnfLine(0, 0x00, 0x00);
+
+  // The first row is not a turnaround
+  TEST_ASSERT_EQUAL(0, KnittingProcess.get_turnaround_stats().get_count());
+
+  // Host answers 20 ms after the carriage left the pattern section
+  knit_one_row();
+  delay(20);
+  send_cnfLine(1, 0x00, 0x00);
+  const TurnaroundStats& stats = KnittingProcess.get_turnaround_stats();
+  TEST_ASSERT_EQUAL(1, stats.get_count());
+  TEST_ASSERT_GREATER_OR_EQUAL(20000, stats.get_min_us());
+  TEST_ASSERT_EQUAL(1, stats.get_histogram(5));
+  TEST_ASSERT_EQUAL(0, stats.get_stale_rows());
+
+  // The carriage comes back into the pattern before the next row arrives
+  knit_one_row();
+  digitalWrite(PinsCorrespondance::KSL, HIGH);
+  KnittingProcess.knitting_loop();
+  TEST_ASSERT_EQUAL(1, stats.get_stale_rows());
+  send_cnfLine(2, 0x00, 0x00);
+  TEST_ASSERT_EQUAL(2, stats.get_count());
+  digitalWrite(PinsCorrespondance::KSL, LOW);
+
+  // Statistics are kept after the end of the knitting, for the report
+  send_cnfLine(3, LAST_LINE_FLAG, 0x00);
+  TEST_ASSERT_EQUAL(Idle, KnittingProcess.get_knitting_state());
+  TEST_ASSERT_EQUAL(2, stats.get_count());
+
+  // The report, as sent on the link
+  uint8_t request[] = {0x09};
+  Ayab.receive(request, sizeof(request));
+  const uint8_t* report = Ayab.get_transport().get_sent_packet();
+  TEST_ASSERT_EQUAL(61, Ayab.get_transport().get_sent_size());
+  TEST_ASSERT_EQUAL_HEX8(0xC9, report[0]);
+  TEST_ASSERT_EQUAL(2, read_big_endian(report + 1, 2));
+  TEST_ASSERT_EQUAL_UINT32(stats.get_min_us(), read_big_endian(report + 3, 4));
+  TEST_ASSERT_EQUAL(stats.get_histogram(5), read_big_endian(report + 27, 2));
+  TEST_ASSERT_EQUAL(Ayab.get_line_retransmits(),
+                    read_big_endian(report + 33, 2));
+  for (uint8_t signal = 0; signal < SAMPLED_SIGNAL_COUNT; signal++) {
+    TEST_ASSERT_EQUAL(CarriageSampler::get_rejected_glitches(
+                          static_cast<SampledSignal>(signal)),
+                      read_big_endian(report + 35 + 2 * signal, 2));
+  }
+  TEST_ASSERT_EQUAL(KnittingProcess.get_lost_carriage_events(),
+                    read_big_endian(report + 41, 2));
+  TEST_ASSERT_EQUAL_UINT32(KnittingProcess.get_max_edge_latency_us(),
+                           read_big_endian(report + 43, 4));
+  TEST_ASSERT_EQUAL(KnittingProcess.get_reversals(),
+                    read_big_endian(report + 47, 2));
+  TEST_ASSERT_EQUAL(KnittingProcess.get_position_corrections(),
+                    read_big_endian(report + 49, 2));
+  TEST_ASSERT_EQUAL(KnittingProcess.get_row_check().get_rows_with_errors(),
+                    read_big_endian(report + 51, 2));
+  TEST_ASSERT_EQUAL_UINT32(BootTiming::get_setup_us(),
+                           read_big_endian(report + 53, 4));
+  TEST_ASSERT_EQUAL_UINT32(BootTiming::get_ready_us(),
+                           read_big_endian(report + 57, 4));
+}
+
+void run_module_turnaround_stats_tests() {
+  RUN_TEST(test_turnaround_histogram_bins);
+  RUN_TEST(test_turnaround_min_avg_max);
+  RUN_TEST(test_turnaround_measured_per_row);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_TURNAROUND_STATS_H
+#define TEST_TURNAROUND_STATS_H
+
+void run_module_turnaround_stats_tests();
+
+#endif
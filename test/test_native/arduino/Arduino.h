@@ -0,0 +1,49 @@
+/**
+ * @file Arduino.h
+ * @brief The part of the Arduino core the library uses, for the host tests
+ * (env:native, see arduino_shim.cpp).
+ *
+ * The pins are plain variables: a test writes an input pin with
+ * digitalWrite() as the carriage would drive it. The clock is the one of the
+ * host. There is no interrupt, the library polls instead.
+ */
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w) ((uint8_t)((w)&0xff))
+
+#define noInterrupts()
+#define interrupts()
+
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+#endif
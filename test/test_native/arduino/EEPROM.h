@@ -0,0 +1,21 @@
+/**
+ * @file EEPROM.h
+ * @brief EEPROM of the Arduino core for the host tests (env:native), in RAM.
+ */
+#ifndef EEPROM_SHIM_H
+#define EEPROM_SHIM_H
+
+#include <stdint.h>
+
+const uint16_t EEPROM_SHIM_SIZE = 1024;  // ATmega328P
+
+struct EEPROMClass {
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length() { return EEPROM_SHIM_SIZE; }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
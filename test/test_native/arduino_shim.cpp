@@ -0,0 +1,78 @@
+// Arduino core functions of arduino/Arduino.h and arduino/EEPROM.h, on the
+// host (env:native)
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+const uint8_t PIN_COUNT = 20;  // D0-D13, A0-A5
+uint8_t pin_levels[PIN_COUNT];
+
+// Erased like a new EEPROM
+struct ErasedEeprom {
+  uint8_t bytes[EEPROM_SHIM_SIZE];
+  ErasedEeprom() { memset(bytes, 0xFF, sizeof(bytes)); }
+} eeprom;
+
+const std::chrono::steady_clock::time_point start_time =
+    std::chrono::steady_clock::now();
+}  // namespace
+
+EEPROMClass EEPROM;
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin, (void)mode; }
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin < PIN_COUNT) {
+    pin_levels[pin] = value != LOW ? HIGH : LOW;
+  }
+}
+
+int digitalRead(uint8_t pin) { return pin < PIN_COUNT ? pin_levels[pin] : LOW; }
+
+void analogWrite(uint8_t pin, int value) {
+  digitalWrite(pin, value > 0 ? HIGH : LOW);
+}
+
+unsigned long micros() {
+  return static_cast<unsigned long>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - start_time)
+          .count());
+}
+
+unsigned long millis() { return micros() / 1000; }
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  (void)pin, (void)frequency, (void)duration;
+}
+
+void noTone(uint8_t pin) { (void)pin; }
+
+uint8_t EEPROMClass::read(int address) {
+  return address >= 0 && address < EEPROM_SHIM_SIZE ? eeprom.bytes[address]
+                                                    : 0xFF;
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  if (address >= 0 && address < EEPROM_SHIM_SIZE) {
+    eeprom.bytes[address] = value;
+  }
+}
+
+void EEPROMClass::update(int address, uint8_t value) {
+  if (this->read(address) != value) {
+    this->write(address, value);
+  }
+}
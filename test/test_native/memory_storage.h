@@ -0,0 +1,62 @@
+#ifndef MEMORY_STORAGE_H
+#define MEMORY_STORAGE_H
+
+#include <stdint.h>
+
+#include "storage.h"
+
+/**
+ * RAM simulation of the EEPROM for the tests.
+ *
+ * Starts erased (0xFF) like a new EEPROM, counts the committed records per
+ * block to check the wear levelling, counts the reads, and can simulate a
+ * power loss by ignoring every write after a given number of writes.
+ */
+template <uint16_t SIZE, uint16_t BLOCK_SIZE>
+class MemoryStorage : public Storage {
+ private:
+  uint8_t data[SIZE];
+  uint16_t commits[SIZE / BLOCK_SIZE];
+  uint16_t writes;
+  mutable uint16_t reads;
+  int16_t remaining_writes;  // negative: no power loss planned
+
+ public:
+  MemoryStorage() : writes(0), reads(0), remaining_writes(-1) {
+    for (uint16_t i = 0; i < SIZE; i++) {
+      data[i] = 0xFF;
+    }
+    for (uint16_t i = 0; i < SIZE / BLOCK_SIZE; i++) {
+      commits[i] = 0;
+    }
+  }
+
+  uint8_t read(uint16_t address) const override {
+    reads++;
+    return data[address];
+  }
+
+  void update(uint16_t address, uint8_t value) override {
+    if (data[address] == value || remaining_writes == 0) {
+      return;
+    }
+    if (remaining_writes > 0) {
+      remaining_writes--;
+    }
+    writes++;
+    data[address] = value;
+    if (address % BLOCK_SIZE == 0 && value == 0xA5) {
+      commits[address / BLOCK_SIZE]++;
+    }
+  }
+
+  // Simulate a power loss after `count` more writes
+  void power_loss_after(int16_t count) { remaining_writes = count; }
+  void power_on() { remaining_writes = -1; }
+  void corrupt(uint16_t address) { data[address] ^= 0xFF; }
+  uint16_t get_writes() const { return writes; }
+  uint16_t get_reads() const { return reads; }
+  uint16_t get_commits(uint16_t block) const { return commits[block]; }
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "test_knitting_fsm_table.h"
+
+#include <stdint.h>
+
+#include "knitting_fsm.h"
+#include "unity.h"
+
+// Every (phase, event) pair of the transition table, read through the
+// pgm_read_byte of the Arduino shim. The knitting process driven by the pins
+// is tested on the boards (test_embedded/test_knitting_fsm.cpp).
+
+static bool is_carriage_event(uint8_t event) {
+  return event != EVENT_INIT && event != EVENT_START;
+}
+
+void test_fsm_every_transition() {
+  for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+    for (uint8_t event = 0; event < EVENT_COUNT; event++) {
+      KnittingTransition transition =
+          KnittingFsm::transition(static_cast<KnittingPhase>(phase),
+                                  static_cast<KnittingEvent>(event));
+      TEST_ASSERT_LESS_THAN(PHASE_COUNT, transition.next);
+      TEST_ASSERT_LESS_THAN(ACTION_COUNT, transition.action);
+
+      // Only the host messages change the KnittingState (and reset())
+      if (is_carriage_event(event)) {
+        TEST_ASSERT_EQUAL(
+            knitting_state_of(static_cast<KnittingPhase>(phase)),
+            knitting_state_of(transition.next));
+      }
+      // STEP is only dispatched in STARTING, see process_carriage_state()
+      if (event == EVENT_STEP && phase != PHASE_STARTING) {
+        TEST_ASSERT_EQUAL(phase, transition.next);
+        TEST_ASSERT_EQUAL(ACTION_NONE, transition.action);
+      }
+      // Needles are selected on their edge in the pattern only
+      if (transition.action == ACTION_KNIT_NEEDLE) {
+        TEST_ASSERT_EQUAL(EVENT_NEEDLE_IN_PATTERN, event);
+        TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, transition.next);
+      }
+    }
+  }
+
+  // The hot path of KnittingProcess_::process_carriage_state()
+  KnittingTransition needle =
+      KnittingFsm::transition(PHASE_IN_PATTERN, EVENT_NEEDLE_IN_PATTERN);
+  TEST_ASSERT_EQUAL(PHASE_IN_PATTERN, needle.next);
+  TEST_ASSERT_EQUAL(ACTION_KNIT_NEEDLE, needle.action);
+}
+
+void test_fsm_no_dead_end() {
+  // Every phase is reachable from Idle
+  bool reached[PHASE_COUNT] = {true};
+  for (uint8_t pass = 0; pass < PHASE_COUNT; pass++) {
+    for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+      for (uint8_t event = 0; reached[phase] && event < EVENT_COUNT;
+           event++) {
+        reached[KnittingFsm::transition(static_cast<KnittingPhase>(phase),
+                                        static_cast<KnittingEvent>(event))
+                    .next] = true;
+      }
+    }
+  }
+  for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+    TEST_ASSERT_TRUE_MESSAGE(reached[phase], "phase not reachable");
+  }
+
+  // And every knitting phase gets to the next row
+  for (uint8_t start = PHASE_STARTING; start < PHASE_COUNT; start++) {
+    bool from_start[PHASE_COUNT] = {false};
+    from_start[start] = true;
+    for (uint8_t pass = 0; pass < PHASE_COUNT; pass++) {
+      for (uint8_t phase = 0; phase < PHASE_COUNT; phase++) {
+        for (uint8_t event = 0; from_start[phase] && event < EVENT_COUNT;
+             event++) {
+          from_start[KnittingFsm::transition(
+                         static_cast<KnittingPhase>(phase),
+                         static_cast<KnittingEvent>(event))
+                         .next] = true;
+        }
+      }
+    }
+    TEST_ASSERT_TRUE_MESSAGE(from_start[PHASE_ROW_READY], "dead end");
+  }
+}
+
+void run_module_knitting_fsm_table_tests() {
+  RUN_TEST(test_fsm_every_transition);
+  RUN_TEST(test_fsm_no_dead_end);
+}
@@ -0,0 +1,6 @@
+#ifndef TEST_KNITTING_FSM_TABLE_H
+#define TEST_KNITTING_FSM_TABLE_H
+
+void run_module_knitting_fsm_table_tests();
+
+#endif
@@ -0,0 +1,133 @@
+#include "test_motif_store.h"
+
+#include <stdint.h>
+
+#include "config.h"
+#include "memory_storage.h"
+#include "motif.h"
+#include "motif_store.h"
+#include "unity.h"
+
+const uint8_t TEST_RECORDS = 3;
+typedef MemoryStorage<TEST_RECORDS * MOTIF_RECORD_SIZE, MOTIF_RECORD_SIZE>
+    TestStorage;
+
+// Kept off the stack like on the boards, reset by each test
+static TestStorage storage;
+static Motif motif;
+static Motif loaded;
+
+static void make_motif(Motif& target, uint16_t rows) {
+  // 12 needles wide, 3 rows, content depending on `rows`
+  uint8_t tile[6];
+  for (uint8_t i = 0; i < sizeof(tile); i++) {
+    tile[i] = static_cast<uint8_t>(rows + i);
+  }
+  target.configure(12, 3, 1, 2, MOTIF_MIRROR_HORIZONTAL, rows);
+  target.load(0, tile, sizeof(tile));
+}
+
+void test_motif_store_round_trip() {
+  storage = TestStorage();
+  MotifStore store(storage, 0, TEST_RECORDS);
+  motif = Motif();
+  make_motif(motif, 40);
+
+  TEST_ASSERT_FALSE(store.contains(0));
+  TEST_ASSERT_TRUE(store.save(0, motif));
+  TEST_ASSERT_TRUE(store.contains(0));
+
+  TEST_ASSERT_TRUE(store.load(0, loaded));
+  TEST_ASSERT_TRUE(loaded.is_loaded());
+  TEST_ASSERT_EQUAL(12, loaded.get_width());
+  TEST_ASSERT_EQUAL(3, loaded.get_height());
+  TEST_ASSERT_EQUAL(1, loaded.get_x_offset());
+  TEST_ASSERT_EQUAL(2, loaded.get_y_offset());
+  TEST_ASSERT_EQUAL(MOTIF_MIRROR_HORIZONTAL, loaded.get_flags());
+  TEST_ASSERT_EQUAL(40, loaded.get_rows());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(motif.get_tile(), loaded.get_tile(), 6);
+
+  // Other slots are independent, invalid slots are refused
+  TEST_ASSERT_FALSE(store.load(1, loaded));
+  loaded = Motif();
+  loaded.configure(8, 1, 0, 0, 0, 0);  // No tile loaded
+  TEST_ASSERT_FALSE(store.save(1, loaded));
+  TEST_ASSERT_FALSE(store.save(MOTIF_STORE_SLOTS, motif));
+}
+
+void test_motif_store_wear_levelling() {
+  storage = TestStorage();
+  MotifStore store(storage, 0, TEST_RECORDS);
+  motif = Motif();
+
+  // Saving the same slot again and again rotates over every record
+  for (uint16_t i = 0; i < 30; i++) {
+    make_motif(motif, i);
+    TEST_ASSERT_TRUE(store.save(0, motif));
+  }
+  for (uint8_t block = 0; block < TEST_RECORDS; block++) {
+    TEST_ASSERT_EQUAL(10, storage.get_commits(block));
+  }
+
+  loaded = Motif();
+  store.load(0, loaded);
+  TEST_ASSERT_EQUAL(29, loaded.get_rows());
+}
+
+void test_motif_store_power_loss() {
+  storage = TestStorage();
+  MotifStore store(storage, 0, TEST_RECORDS);
+  motif = Motif();
+  loaded = Motif();
+
+  make_motif(motif, 1);
+  store.save(0, motif);
+  uint16_t writes_before = storage.get_writes();
+  make_motif(motif, 2);
+  store.save(0, motif);
+  uint16_t save_writes = storage.get_writes() - writes_before;
+
+  // Power lost in the middle of a save: the previous version is kept
+  make_motif(motif, 3);
+  storage.power_loss_after(5);
+  store.save(0, motif);
+  storage.power_on();
+  TEST_ASSERT_TRUE(store.load(0, loaded));
+  TEST_ASSERT_EQUAL(2, loaded.get_rows());
+
+  // Power lost after the commit, before the previous version is dropped:
+  // the newest version wins
+  make_motif(motif, 4);
+  storage.power_loss_after(save_writes - 1);
+  store.save(0, motif);
+  storage.power_on();
+  TEST_ASSERT_TRUE(store.load(0, loaded));
+  TEST_ASSERT_EQUAL(4, loaded.get_rows());
+
+  // The store keeps working afterwards
+  make_motif(motif, 5);
+  TEST_ASSERT_TRUE(store.save(0, motif));
+  TEST_ASSERT_TRUE(store.load(0, loaded));
+  TEST_ASSERT_EQUAL(5, loaded.get_rows());
+}
+
+void test_motif_store_corruption() {
+  storage = TestStorage();
+  MotifStore store(storage, 0, TEST_RECORDS);
+  motif = Motif();
+  loaded = Motif();
+
+  make_motif(motif, 7);
+  store.save(0, motif);
+  // Flip a tile byte of the only record: the checksum no longer matches
+  storage.corrupt(MOTIF_RECORD_HEADER + 2);
+  TEST_ASSERT_FALSE(store.contains(0));
+  TEST_ASSERT_FALSE(store.load(0, loaded));
+}
+
+void run_module_motif_store_tests() {
+  RUN_TEST(test_motif_store_round_trip);
+  RUN_TEST(test_motif_store_wear_levelling);
+  RUN_TEST(test_motif_store_power_loss);
+  RUN_TEST(test_motif_store_corruption);
+}
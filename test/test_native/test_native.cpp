@@ -0,0 +1,30 @@
+// Host tests (env:native): the library built against the Arduino shim of
+// arduino/, the protocol on a socketpair
+
+#define RUN_MODULE(run_function) \
+  extern void run_function();    \
+  run_function();
+
+#include <unity.h>
+
+#include "test_knitting_fsm_table.h"
+#include "test_motif_store.h"
+#include "test_protocol.h"
+#include "test_session_checkpoint.h"
+#include "test_spsc_queue.h"
+#include "test_transport.h"
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+int main(int argc, char** argv) {
+  UNITY_BEGIN();
+  RUN_MODULE(run_module_transport_tests);
+  RUN_MODULE(run_module_spsc_queue_tests);
+  RUN_MODULE(run_module_protocol_tests);
+  RUN_MODULE(run_module_knitting_fsm_table_tests);
+  RUN_MODULE(run_module_motif_store_tests);
+  RUN_MODULE(run_module_session_checkpoint_tests);
+  return UNITY_END();
+}
@@ -0,0 +1,133 @@
+#include "test_protocol.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "communication/ayab.h"
+#include "knitting.h"
+#include "unity.h"
+
+// The AYAB handler of the library on one end of a socketpair, the test as the
+// host on the other end
+int host_fd = -1;
+
+void write_frame(const uint8_t* packet, size_t size) {
+  // SLIP encoded, as the host software sends it
+  uint8_t frame[2 * MAX_MSG_BUFFER_LEN + 2];
+  size_t length = 0;
+  frame[length++] = Slip::END;
+  for (size_t i = 0; i < size; i++) {
+    if (packet[i] == Slip::END) {
+      frame[length++] = Slip::ESC;
+      frame[length++] = Slip::ESC_END;
+    } else if (packet[i] == Slip::ESC) {
+      frame[length++] = Slip::ESC;
+      frame[length++] = Slip::ESC_ESC;
+    } else {
+      frame[length++] = packet[i];
+    }
+  }
+  frame[length++] = Slip::END;
+  TEST_ASSERT_EQUAL(length, write(host_fd, frame, length));
+}
+
+size_t read_reply(uint8_t* reply) {
+  // The first packet sent back, decoded; 0 if there is none
+  uint8_t frame[2 * MAX_MSG_BUFFER_LEN + 2];
+  ssize_t length = recv(host_fd, frame, sizeof(frame), MSG_DONTWAIT);
+  size_t size = 0;
+  bool is_escaped = false;
+  for (ssize_t i = 0; i < length; i++) {
+    uint8_t byte = frame[i];
+    if (byte == Slip::END) {
+      if (size > 0) {
+        return size;
+      }
+    } else if (byte == Slip::ESC) {
+      is_escaped = true;
+    } else if (size < MAX_MSG_BUFFER_LEN) {
+      if (is_escaped) {
+        byte = byte == Slip::ESC_END ? Slip::END : Slip::ESC;
+        is_escaped = false;
+      }
+      reply[size++] = byte;
+    }
+  }
+  return 0;
+}
+
+size_t exchange(const uint8_t* request, size_t size, uint8_t* reply) {
+  write_frame(request, size);
+  Ayab.update();
+  return read_reply(reply);
+}
+
+uint32_t read_big_endian(const uint8_t* bytes) {
+  return (static_cast<uint32_t>(bytes[0]) << 24) |
+         (static_cast<uint32_t>(bytes[1]) << 16) |
+         (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+void test_protocol_reqInfo() {
+  TEST_ASSERT_TRUE(host_fd >= 0);
+  uint8_t reply[MAX_MSG_BUFFER_LEN];
+  const uint8_t request[] = {0x03};
+  TEST_ASSERT_EQUAL(22, exchange(request, sizeof(request), reply));
+  TEST_ASSERT_EQUAL_HEX8(0xC3, reply[0]);
+  TEST_ASSERT_EQUAL(API_VERSION, reply[1]);
+}
+
+void test_protocol_reqInit_reqStart() {
+  uint8_t reply[MAX_MSG_BUFFER_LEN];
+  const uint8_t init[] = {0x05};
+  TEST_ASSERT_EQUAL(2, exchange(init, sizeof(init), reply));
+  TEST_ASSERT_EQUAL_HEX8(0xC5, reply[0]);
+  TEST_ASSERT_EQUAL(0, reply[1]);
+
+  // A request with a wrong checksum is rejected, the knitting does not start
+  uint8_t start[] = {0x01, 0x02, 0x5b, 0x00, 0x00};
+  start[4] = Ayab.CRC8(start, 4) ^ 0xFF;
+  TEST_ASSERT_EQUAL(2, exchange(start, sizeof(start), reply));
+  TEST_ASSERT_EQUAL_HEX8(0xC1, reply[0]);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(ErrorCode::CHECKSUM_ERROR), reply[1]);
+  TEST_ASSERT_EQUAL(WaitingStart, KnittingProcess.get_knitting_state());
+}
+
+void test_protocol_reqPing_split() {
+  // A ping whose bytes arrive 2 ms apart, with a sequence that is escaped
+  uint8_t reply[MAX_MSG_BUFFER_LEN];
+  const uint8_t head[] = {Slip::END, 0x08};
+  const uint8_t tail[] = {Slip::ESC, Slip::ESC_END, Slip::END};
+  TEST_ASSERT_EQUAL(sizeof(head), write(host_fd, head, sizeof(head)));
+  Ayab.update();
+  TEST_ASSERT_EQUAL(0, read_reply(reply));
+  delay(2);
+  TEST_ASSERT_EQUAL(sizeof(tail), write(host_fd, tail, sizeof(tail)));
+  Ayab.update();
+  TEST_ASSERT_EQUAL(10, read_reply(reply));
+  TEST_ASSERT_EQUAL_HEX8(0xC8, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(Slip::END, reply[1]);
+  uint32_t receive_us = read_big_endian(reply + 2);
+  uint32_t send_us = read_big_endian(reply + 6);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(2000, send_us - receive_us);
+}
+
+void run_module_protocol_tests() {
+  int fds[2] = {-1, -1};
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0) {
+    host_fd = fds[0];
+    Ayab.get_transport().attach(fds[1]);
+  }
+  Ayab.init();  // Attached: no pseudo terminal opened
+  KnittingProcess.reset();
+
+  RUN_TEST(test_protocol_reqInfo);
+  RUN_TEST(test_protocol_reqInit_reqStart);
+  RUN_TEST(test_protocol_reqPing_split);
+
+  KnittingProcess.reset();
+  close(fds[0]);
+  close(fds[1]);
+  host_fd = -1;
+}
@@ -0,0 +1 @@
+void run_module_protocol_tests();
@@ -0,0 +1,146 @@
+#include "test_session_checkpoint.h"
+
+#include <stdint.h>
+
+#include "config.h"
+#include "memory_storage.h"
+#include "session_checkpoint.h"
+#include "unity.h"
+
+const uint8_t TEST_CHECKPOINT_RECORDS = 4;
+typedef MemoryStorage<TEST_CHECKPOINT_RECORDS * CHECKPOINT_RECORD_SIZE,
+                      CHECKPOINT_RECORD_SIZE>
+    TestCheckpointStorage;
+
+static uint8_t flush_checkpoint(SessionCheckpoint& checkpoint) {
+  // Run the write to the end, return the number of steps it took
+  uint8_t steps = 0;
+  while (checkpoint.service()) {
+    steps++;
+  }
+  return steps;
+}
+
+void test_checkpoint_round_trip() {
+  TestCheckpointStorage storage;
+  SessionCheckpoint checkpoint(storage, 0, TEST_CHECKPOINT_RECORDS);
+  CheckpointRecord record;
+  TEST_ASSERT_FALSE(checkpoint.load(record));
+
+  checkpoint.save(CheckpointRecord{84, 116, 0x06, 12});
+  TEST_ASSERT_TRUE(checkpoint.is_pending());
+  TEST_ASSERT_FALSE(checkpoint.load(record));  // Not committed yet
+  TEST_ASSERT_EQUAL(CHECKPOINT_WRITE_STEPS, flush_checkpoint(checkpoint));
+  TEST_ASSERT_FALSE(checkpoint.is_pending());
+
+  TEST_ASSERT_TRUE(checkpoint.load(record));
+  TEST_ASSERT_EQUAL(84, record.start_needle);
+  TEST_ASSERT_EQUAL(116, record.end_needle);
+  TEST_ASSERT_EQUAL(0x06, record.flags);
+  TEST_ASSERT_EQUAL(12, record.line);
+
+  // Nothing is written when the progress did not change (row repeats)
+  checkpoint.save(CheckpointRecord{84, 116, 0x06, 12});
+  TEST_ASSERT_FALSE(checkpoint.is_pending());
+
+  // A finished session is not offered any more
+  checkpoint.end_session();
+  flush_checkpoint(checkpoint);
+  TEST_ASSERT_FALSE(checkpoint.load(record));
+  checkpoint.save(CheckpointRecord{0, 199, 0x00, 0});
+  flush_checkpoint(checkpoint);
+  TEST_ASSERT_TRUE(checkpoint.load(record));
+  TEST_ASSERT_EQUAL(199, record.end_needle);
+}
+
+void test_checkpoint_wear_levelling() {
+  TestCheckpointStorage storage;
+  SessionCheckpoint checkpoint(storage, 0, TEST_CHECKPOINT_RECORDS);
+  for (uint16_t line = 0; line < 300; line++) {
+    uint16_t writes = storage.get_writes();
+    checkpoint.save(
+        CheckpointRecord{84, 116, 0x00, static_cast<uint8_t>(line)});
+    flush_checkpoint(checkpoint);
+    TEST_ASSERT_LESS_OR_EQUAL(CHECKPOINT_WRITE_STEPS,
+                              storage.get_writes() - writes);
+  }
+  for (uint8_t block = 0; block < TEST_CHECKPOINT_RECORDS; block++) {
+    TEST_ASSERT_EQUAL(75, storage.get_commits(block));
+  }
+  CheckpointRecord record;
+  TEST_ASSERT_TRUE(checkpoint.load(record));
+  TEST_ASSERT_EQUAL(299 & 0xFF, record.line);
+}
+
+void test_checkpoint_power_loss() {
+  // Reset in the middle of a checkpoint: the previous one is kept
+  for (int16_t writes = 0; writes < CHECKPOINT_WRITE_STEPS; writes++) {
+    TestCheckpointStorage storage;
+    SessionCheckpoint checkpoint(storage, 0, TEST_CHECKPOINT_RECORDS);
+    checkpoint.save(CheckpointRecord{84, 116, 0x00, 1});
+    flush_checkpoint(checkpoint);
+    storage.power_loss_after(writes);
+    checkpoint.save(CheckpointRecord{84, 116, 0x00, 2});
+    flush_checkpoint(checkpoint);
+    storage.power_on();
+
+    SessionCheckpoint rebooted(storage, 0, TEST_CHECKPOINT_RECORDS);
+    CheckpointRecord record;
+    TEST_ASSERT_TRUE(rebooted.load(record));
+    TEST_ASSERT_EQUAL(1, record.line);
+  }
+
+  // A corrupted record is ignored
+  TestCheckpointStorage storage;
+  SessionCheckpoint checkpoint(storage, 0, TEST_CHECKPOINT_RECORDS);
+  checkpoint.save(CheckpointRecord{84, 116, 0x00, 1});
+  flush_checkpoint(checkpoint);
+  checkpoint.save(CheckpointRecord{84, 116, 0x00, 2});
+  flush_checkpoint(checkpoint);
+  storage.corrupt(CHECKPOINT_RECORD_SIZE + 5);  // Line of the second record
+  SessionCheckpoint rebooted(storage, 0, TEST_CHECKPOINT_RECORDS);
+  CheckpointRecord record;
+  TEST_ASSERT_TRUE(rebooted.load(record));
+  TEST_ASSERT_EQUAL(1, record.line);
+}
+
+void test_checkpoint_scan_once() {
+  // The records are read once, saving at the end of a row reads nothing
+  TestCheckpointStorage storage;
+  SessionCheckpoint checkpoint(storage, 0, TEST_CHECKPOINT_RECORDS);
+  CheckpointRecord record;
+  TEST_ASSERT_FALSE(checkpoint.load(record));
+  uint16_t reads = storage.get_reads();
+  TEST_ASSERT_GREATER_THAN(0, reads);
+  for (uint8_t line = 0; line < 10; line++) {
+    checkpoint.save(CheckpointRecord{84, 116, 0x00, line});
+    flush_checkpoint(checkpoint);
+  }
+  TEST_ASSERT_TRUE(checkpoint.load(record));
+  TEST_ASSERT_EQUAL(9, record.line);
+  TEST_ASSERT_EQUAL(reads, storage.get_reads());
+
+  // Found again after a reset
+  SessionCheckpoint rebooted(storage, 0, TEST_CHECKPOINT_RECORDS);
+  TEST_ASSERT_TRUE(rebooted.load(record));
+  TEST_ASSERT_EQUAL(9, record.line);
+
+  // A single record is overwritten in place
+  MemoryStorage<CHECKPOINT_RECORD_SIZE, CHECKPOINT_RECORD_SIZE> single;
+  SessionCheckpoint one(single, 0, 1);
+  one.save(CheckpointRecord{84, 116, 0x00, 1});
+  flush_checkpoint(one);
+  one.save(CheckpointRecord{84, 116, 0x00, 2});
+  one.service();
+  TEST_ASSERT_FALSE(one.load(record));
+  flush_checkpoint(one);
+  TEST_ASSERT_TRUE(one.load(record));
+  TEST_ASSERT_EQUAL(2, record.line);
+}
+
+void run_module_session_checkpoint_tests() {
+  RUN_TEST(test_checkpoint_round_trip);
+  RUN_TEST(test_checkpoint_wear_levelling);
+  RUN_TEST(test_checkpoint_power_loss);
+  RUN_TEST(test_checkpoint_scan_once);
+}
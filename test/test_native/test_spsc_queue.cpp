@@ -0,0 +1,79 @@
+#include "test_spsc_queue.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+#include "spsc_queue.h"
+#include "unity.h"
+
+struct StressItem {
+  uint32_t sequence;
+  uint32_t check;  // ~sequence, a torn slot does not match
+};
+
+void test_spsc_queue_threads() {
+  // Producer and consumer on two threads, as the pin interrupt and the loop:
+  // every item is popped once, in order and whole, or counted as dropped
+  const uint32_t items = 200000;
+  static SpscQueue<StressItem, 16> queue;
+  std::atomic<bool> producer_done(false);
+  uint32_t producer_drops = 0;
+
+  std::thread producer([&]() {
+    uint32_t seed = 7;
+    for (uint32_t sequence = 0; sequence < items; sequence++) {
+      if (!queue.push(StressItem{sequence, ~sequence})) {
+        producer_drops++;
+      }
+      // Edges in bursts: random pauses, and a yield now and then so that
+      // the threads also interleave on a single core
+      seed = seed * 1103515245U + 12345U;
+      for (volatile uint32_t spin = (seed >> 16) & 0xFF; spin > 0; spin--) {
+      }
+      if ((seed >> 28) == 0) {
+        std::this_thread::yield();
+      }
+    }
+    producer_done.store(true, std::memory_order_release);
+  });
+
+  uint32_t popped = 0;
+  uint32_t gaps = 0;
+  uint32_t torn = 0;
+  uint32_t out_of_order = 0;
+  uint8_t dropped = 0;  // Wraps like the counter of the queue
+  int64_t previous = -1;
+  StressItem item;
+  for (;;) {
+    bool done = producer_done.load(std::memory_order_acquire);
+    while (queue.pop(item)) {
+      popped++;
+      if (item.check != ~item.sequence) {
+        torn++;
+      }
+      if (static_cast<int64_t>(item.sequence) <= previous) {
+        out_of_order++;
+      } else {
+        gaps += item.sequence - previous - 1;
+      }
+      previous = item.sequence;
+    }
+    dropped += queue.take_dropped();
+    if (done) {
+      break;
+    }
+  }
+  producer.join();
+  gaps += items - 1 - previous;
+
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+  TEST_ASSERT_EQUAL(items, popped + producer_drops);
+  TEST_ASSERT_EQUAL(producer_drops, gaps);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(producer_drops), dropped);
+  TEST_ASSERT_TRUE(queue.is_empty());
+}
+
+void run_module_spsc_queue_tests() { RUN_TEST(test_spsc_queue_threads); }
@@ -0,0 +1,6 @@
+#ifndef TEST_SPSC_QUEUE_H
+#define TEST_SPSC_QUEUE_H
+
+void run_module_spsc_queue_tests();
+
+#endif
@@ -0,0 +1,64 @@
+#include "test_transport.h"
+
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "communication/slip_link.h"
+#include "communication/transport.h"
+#include "unity.h"
+
+uint8_t transport_packet[16];
+size_t transport_packet_size = 0;
+
+void record_transport_packet(const uint8_t* buffer, size_t size,
+                             unsigned long start_us) {
+  if (size > 0) {
+    memcpy(transport_packet, buffer, size);
+    transport_packet_size = size;
+  }
+}
+
+void test_transport_socketpair() {
+  // Host on one end of the socketpair, the firmware link on the other
+  int fds[2];
+  TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  SlipLink<PtyTransport, 16, record_transport_packet> link;
+  link.get_transport().attach(fds[1]);
+  TEST_ASSERT_FALSE(link.get_transport().has_input());
+  TEST_ASSERT_EQUAL(-1, link.get_transport().read());
+
+  const uint8_t request[] = {0xC0, 0x08, 0xDB, 0xDC, 0xC0};
+  TEST_ASSERT_EQUAL(sizeof(request), write(fds[0], request, sizeof(request)));
+  TEST_ASSERT_TRUE(link.get_transport().has_input());
+  link.update(UINT8_MAX, 0);
+  TEST_ASSERT_EQUAL(2, transport_packet_size);
+  TEST_ASSERT_EQUAL_HEX8(0x08, transport_packet[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xC0, transport_packet[1]);
+
+  const uint8_t reply[] = {0xC8, 0xDB};
+  link.send(reply, sizeof(reply));
+  uint8_t encoded[8];
+  TEST_ASSERT_EQUAL(5, read(fds[0], encoded, sizeof(encoded)));
+  TEST_ASSERT_EQUAL_HEX8(0xC0, encoded[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xC8, encoded[1]);
+  TEST_ASSERT_EQUAL_HEX8(0xDB, encoded[2]);
+  TEST_ASSERT_EQUAL_HEX8(0xDD, encoded[3]);
+  TEST_ASSERT_EQUAL_HEX8(0xC0, encoded[4]);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_transport_pty() {
+  // begin() opens a pseudo terminal the host software can connect to
+  PtyTransport transport;
+  transport.begin(115200);
+  const char* name = transport.get_pty_name();
+  TEST_ASSERT_NOT_NULL(name);
+  TEST_ASSERT_FALSE(transport.has_input());
+}
+
+void run_module_transport_tests() {
+  RUN_TEST(test_transport_socketpair);
+  RUN_TEST(test_transport_pty);
+}
@@ -0,0 +1 @@
+void run_module_transport_tests();